@@ -0,0 +1,38 @@
+# Prints footprint table of parsing configurations, run by the microjson_footprint target.
+# Code is text of executable above the baseline, static RAM is data and bss above the baseline,
+# storage is size of the parse result and heap is bytes requested while parsing.
+
+string(REPLACE "," ";" CONFIGURATIONS "${CONFIGURATIONS}")
+string(REPLACE "," ";" EXECUTABLES "${EXECUTABLES}")
+
+set(report "| Configuration | Code, bytes | Static RAM, bytes | Result storage, bytes | Heap while parsing, bytes |\n")
+string(APPEND report "|---|---|---|---|---|\n")
+set(index 0)
+foreach(configuration ${CONFIGURATIONS})
+    list(GET EXECUTABLES ${index} executable)
+    math(EXPR index "${index} + 1")
+
+    execute_process(COMMAND ${SIZE_PROGRAM} ${executable} OUTPUT_VARIABLE sizes RESULT_VARIABLE result)
+    if(NOT result EQUAL 0 OR NOT sizes MATCHES "\n *([0-9]+)[ \t]+([0-9]+)[ \t]+([0-9]+)")
+        message(FATAL_ERROR "${SIZE_PROGRAM} failed for ${executable}")
+    endif()
+    set(text ${CMAKE_MATCH_1})
+    math(EXPR ram "${CMAKE_MATCH_2} + ${CMAKE_MATCH_3}")
+
+    execute_process(COMMAND ${executable} OUTPUT_VARIABLE usage RESULT_VARIABLE result)
+    if(NOT result EQUAL 0 OR NOT usage MATCHES "^([0-9]+) ([0-9]+)")
+        message(FATAL_ERROR "${executable} failed to parse the document")
+    endif()
+    set(storage ${CMAKE_MATCH_1})
+    set(heap ${CMAKE_MATCH_2})
+
+    if(configuration STREQUAL "baseline")
+        set(baseText ${text})
+        set(baseRam ${ram})
+    else()
+        math(EXPR text "${text} - ${baseText}")
+        math(EXPR ram "${ram} - ${baseRam}")
+        string(APPEND report "| ${configuration} | ${text} | ${ram} | ${storage} | ${heap} |\n")
+    endif()
+endforeach()
+message("${report}")
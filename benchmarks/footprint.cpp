@@ -0,0 +1,68 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjson.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+//Parses a small document in one of the configurations reported by microjson_footprint. Prints
+//size of the result storage and heap bytes requested while parsing.
+namespace {
+size_t heapBytes = 0;
+
+const char Document[] = "{\"id\":42,\"name\":\"sensor\",\"enabled\":true,\"values\":[1,2,3],\"config\":{\"rate\":10}}";
+}
+
+void *operator new(size_t size) {
+    heapBytes += size;
+    return malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void *memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    free(memory);
+}
+
+int main()
+{
+#if defined(MICROJSON_FOOTPRINT_BASELINE)
+    const size_t storage = 0;
+    const bool parsed = Document[0] == '{';
+#elif defined(MICROJSON_FOOTPRINT_FIXED)
+    microjson::JsonFixedObject<16> object;
+    const size_t storage = sizeof(object);
+    const bool parsed = microjson::parseJsonObject(Document, sizeof(Document) - 1, object) == microjson::JsonNoError && object.size == 5;
+#else
+    microjson::JsonObject object = microjson::parseJsonObject(Document, sizeof(Document) - 1);
+    const size_t storage = sizeof(object);
+    const bool parsed = object.size() == 5;
+#endif
+    printf("%zu %zu\n", storage, heapBytes);
+    return parsed ? 0 : 1;
+}
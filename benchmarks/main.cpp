@@ -0,0 +1,485 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjson.h"
+#include "microjsoncache.h"
+#include "microjsonstream.h"
+#include "microjsoningest.h"
+#include "microjsonincremental.h"
+#include "microjsonimage.h"
+#include "microjsoncolumns.h"
+#include "microjsondiff.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace {
+size_t sink = 0;
+
+void appendMessagePackHeader(std::vector<uint8_t> &out, uint8_t type, uint32_t size) {
+    out.push_back(type);
+    for (int i = 3; i >= 0; --i) {
+        out.push_back(uint8_t(size >> (i * 8)));
+    }
+}
+
+void encodeValue(const microjson::JsonValue &value, std::vector<uint8_t> &out);
+
+//Reference parse-then-encode path, every nested level is parsed into DOM before encoding
+void encodeObject(const microjson::JsonObject &obj, std::vector<uint8_t> &out) {
+    appendMessagePackHeader(out, 0xdf, uint32_t(obj.size()));
+    for (const auto &property : obj) {
+        appendMessagePackHeader(out, 0xdb, uint32_t(property.first.size()));
+        out.insert(out.end(), property.first.begin(), property.first.end());
+        encodeValue(property.second, out);
+    }
+}
+
+void encodeValue(const microjson::JsonValue &value, std::vector<uint8_t> &out) {
+    switch (value.type) {
+    case microjson::JsonStringType:
+        appendMessagePackHeader(out, 0xdb, uint32_t(value.value.size()));
+        out.insert(out.end(), value.value.begin(), value.value.end());
+        break;
+    case microjson::JsonNumberType: {
+        double number = strtod(value.value.c_str(), nullptr);
+        uint64_t bits;
+        memcpy(&bits, &number, sizeof(bits));
+        out.push_back(0xcb);
+        for (int i = 7; i >= 0; --i) {
+            out.push_back(uint8_t(bits >> (i * 8)));
+        }
+        break;
+    }
+    case microjson::JsonBoolType:
+        out.push_back(value.value[0] == 't' ? 0xc3 : 0xc2);
+        break;
+    case microjson::JsonArrayType: {
+        microjson::JsonArray arr = microjson::parseJsonArray(value.value.data(), value.value.size());
+        appendMessagePackHeader(out, 0xdd, uint32_t(arr.size()));
+        for (const auto &element : arr) {
+            encodeValue(element, out);
+        }
+        break;
+    }
+    case microjson::JsonObjectType:
+        if (value.value == "null") {
+            out.push_back(0xc0);
+        } else {
+            encodeObject(microjson::parseJsonObject(value.value.data(), value.value.size()), out);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+template<typename F>
+void benchmark(const char *name, size_t iterations, size_t bytes, F f) {
+    auto begin = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        sink += f();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+    std::cout << name << ": " << ns / iterations << " ns/op, "
+              << (bytes * iterations) / (ns / 1e9) / (1024 * 1024) << " MiB/s" << std::endl;
+}
+}
+
+int main(int, char *[]) {
+#ifdef MICROJSON_HEADER_ONLY
+    std::cout << "header-only build" << std::endl;
+#else
+    std::cout << "library build" << std::endl;
+#endif
+    const size_t iterations = 1000000;
+
+    const char *smallObject = "{\"id\":12345,\"name\":\"sensor\",\"active\":true,\"value\":-12.5,\"tags\":[\"a\",\"b\"]}";
+    const size_t smallObjectSize = strlen(smallObject);
+    benchmark("small object", iterations, smallObjectSize, [&]() {
+        return microjson::parseJsonObject(smallObject, smallObjectSize).size();
+    });
+
+    const char *smallArray = "[1,2,3,\"four\",5.5,false,{\"seven\":7}]";
+    const size_t smallArraySize = strlen(smallArray);
+    benchmark("small array", iterations, smallArraySize, [&]() {
+        return microjson::parseJsonArray(smallArray, smallArraySize).size();
+    });
+
+    benchmark("small object fixed", iterations, smallObjectSize, [&]() {
+        microjson::JsonFixedObject<8> obj;
+        microjson::parseJsonObject(smallObject, smallObjectSize, obj);
+        return obj.size;
+    });
+
+    std::string numbers = "[";
+    for (int i = 0; i < 100000; ++i) {
+        numbers += std::to_string(i * 0.25 - 1000) + ",";
+    }
+    numbers.back() = ']';
+    benchmark("number array", 100, numbers.size(), [&]() {
+        return microjson::parseJsonArray(numbers.data(), numbers.size()).size();
+    });
+
+    benchmark("number array typed", 100, numbers.size(), [&]() {
+        std::vector<double> values;
+        microjson::parseJsonNumberArray(numbers.data(), numbers.size(), values);
+        return values.size();
+    });
+
+    std::string config = "{";
+    std::vector<std::string> configKeys;
+    for (int i = 0; i < 200; ++i) {
+        configKeys.push_back("config.option" + std::to_string(i));
+        config += "\"" + configKeys.back() + "\":" + std::to_string(i) + ",";
+    }
+    config.back() = '}';
+    const microjson::JsonObject configObject = microjson::parseJsonObject(config.data(), config.size());
+    const microjson::JsonFrozenObject configFrozen = microjson::freeze(configObject);
+    benchmark("config lookup JsonObject", iterations, 0, [&]() {
+        static size_t i = 0;
+        return configObject.find(configKeys[++i % configKeys.size()])->second.value.size();
+    });
+    benchmark("config lookup frozen", iterations, 0, [&]() {
+        static size_t i = 0;
+        return configFrozen.find(configKeys[++i % configKeys.size()])->value.size();
+    });
+
+    microjson::JsonParseCache cache;
+    benchmark("small object cached", iterations, smallObjectSize, [&]() {
+        return cache.parseJsonObject(smallObject, smallObjectSize)->size();
+    });
+
+    std::vector<std::string> catalog;
+    for (int i = 0; i < 100000; ++i) {
+        catalog.push_back("{\"id\":" + std::to_string(i) + ",\"status\":\"status-" + std::to_string(i % 4)
+                          + "\",\"meta\":{\"source\":\"catalog-service\",\"schema\":\"v" + std::to_string(i % 3) + "\"}}");
+    }
+    microjson::JsonInternStore internStore;
+    std::vector<std::shared_ptr<const microjson::JsonInternedObject>> interned;
+    benchmark("records interned", 1, 0, [&]() {
+        for (const auto &record : catalog) {
+            interned.push_back(internStore.parseJsonObject(record.data(), record.size()));
+        }
+        return interned.size();
+    });
+    const microjson::JsonInternStats internStats = internStore.stats();
+    std::cout << "records interned: " << internStats.storedBytes / 1024 << " KiB, as JsonObject "
+              << internStats.plainBytes / 1024 << " KiB" << std::endl;
+
+    std::string catalogLines;
+    for (const auto &record : catalog) {
+        catalogLines += record + "\n";
+    }
+    const std::vector<microjson::JsonColumnField> catalogFields = {{"id", microjson::JsonColumnInt64},
+                                                                   {"status", microjson::JsonColumnString}};
+    benchmark("records parse rows", 3, catalogLines.size(), [&]() {
+        std::vector<int64_t> ids;
+        std::vector<std::string> statuses;
+        size_t begin = 0;
+        for (size_t end = catalogLines.find('\n'); end != std::string::npos; begin = end + 1, end = catalogLines.find('\n', begin)) {
+            microjson::JsonObject row = microjson::parseJsonObject(catalogLines.data() + begin, end - begin);
+            ids.push_back(std::stoll(row["id"].value));
+            statuses.push_back(row["status"].value);
+        }
+        return ids.size();
+    });
+
+    std::vector<microjson::JsonColumn> catalogColumns;
+    benchmark("records shred columns", 3, catalogLines.size(), [&]() {
+        microjson::shredJsonRows(catalogLines.data(), catalogLines.size(), catalogFields, catalogColumns);
+        return catalogColumns[0].size();
+    });
+
+    std::string snapshot1 = "[";
+    for (const auto &record : catalog) {
+        snapshot1 += record + ",";
+    }
+    snapshot1.back() = ']';
+    std::string snapshot2 = snapshot1;
+    snapshot2.replace(snapshot2.find("\"status-", snapshot2.size() / 3), 9, "\"changed-");
+    snapshot2.replace(snapshot2.find("\"v2\"", snapshot2.size() / 2), 4, "\"v9\"");
+    benchmark("records snapshot compare objects", 3, snapshot1.size() + snapshot2.size(), [&]() {
+        const microjson::JsonArray rows1 = microjson::parseJsonArray(snapshot1.data(), snapshot1.size());
+        const microjson::JsonArray rows2 = microjson::parseJsonArray(snapshot2.data(), snapshot2.size());
+        size_t changed = 0;
+        for (size_t i = 0; i < rows1.size(); ++i) {
+            const microjson::JsonObject row1 = microjson::parseJsonObject(rows1[i].value.data(), rows1[i].value.size());
+            microjson::JsonObject row2 = microjson::parseJsonObject(rows2[i].value.data(), rows2[i].value.size());
+            for (const auto &member : row1) {
+                const microjson::JsonValue &value = row2[member.first];
+                if (member.second.type != microjson::JsonObjectType) {
+                    changed += value.value != member.second.value ? 1 : 0;
+                    continue;
+                }
+                microjson::JsonObject nested1 = microjson::parseJsonObject(member.second.value.data(), member.second.value.size());
+                microjson::JsonObject nested2 = microjson::parseJsonObject(value.value.data(), value.value.size());
+                for (const auto &nested : nested1) {
+                    changed += nested2[nested.first].value != nested.second.value ? 1 : 0;
+                }
+            }
+        }
+        return changed;
+    });
+    std::vector<microjson::JsonDiffChange> snapshotChanges;
+    benchmark("records snapshot diff", 3, snapshot1.size() + snapshot2.size(), [&]() {
+        microjson::diffJson(snapshot1.data(), snapshot1.size(), snapshot2.data(), snapshot2.size(), snapshotChanges);
+        return snapshotChanges.size();
+    });
+
+    std::string million = "[";
+    for (int i = 0; i < 1000000; ++i) {
+        million += std::to_string(i % 1000) + ",";
+    }
+    million.back() = ']';
+    microjson::JsonArray millionValues = microjson::parseJsonArray(million.data(), million.size());
+    microjson::JsonCompactArray millionCompact = microjson::parseJsonCompactArray(million.data(), million.size());
+    std::cout << "million numbers: JsonValue " << sizeof(microjson::JsonValue) * millionValues.size() / 1024
+              << " KiB, JsonCompactValue " << sizeof(microjson::JsonCompactValue) * millionCompact.size() / 1024
+              << " KiB" << std::endl;
+    benchmark("million numbers iterate JsonValue", 10, million.size(), [&]() {
+        double sum = 0;
+        for (const auto &value : millionValues) {
+            sum += strtod(value.value.c_str(), nullptr);
+        }
+        return size_t(sum);
+    });
+    benchmark("million numbers iterate compact", 10, million.size(), [&]() {
+        double sum = 0;
+        for (size_t i = 0; i < millionCompact.size(); ++i) {
+            sum += millionCompact[i].toDouble();
+        }
+        return size_t(sum);
+    });
+
+    const char *document = "{\"id\":12345,\"name\":\"sensor \\\"north\\\"\",\"active\":true,\"value\":-12.5,"
+                           "\"tags\":[\"a\",\"b\",\"c\"],\"position\":{\"x\":1.25,\"y\":-3.5,\"z\":100},"
+                           "\"readings\":[1,2,3,4,5,6,7,8,9,10],\"meta\":{\"owner\":\"ops\",\"revision\":42,\"parent\":null}}";
+    const size_t documentSize = strlen(document);
+    std::vector<uint8_t> encoded;
+    benchmark("parse then encode MessagePack", iterations / 10, documentSize, [&]() {
+        encoded.clear();
+        encodeObject(microjson::parseJsonObject(document, documentSize), encoded);
+        return encoded.size();
+    });
+
+    benchmark("transcode MessagePack", iterations / 10, documentSize, [&]() {
+        encoded.clear();
+        microjson::jsonToMessagePack(document, documentSize, encoded);
+        return encoded.size();
+    });
+
+    benchmark("transcode CBOR", iterations / 10, documentSize, [&]() {
+        encoded.clear();
+        microjson::jsonToCbor(document, documentSize, encoded);
+        return encoded.size();
+    });
+
+    benchmark("parse document", iterations / 10, documentSize, [&]() {
+        return microjson::parseJsonObject(document, documentSize).size();
+    });
+
+    benchmark("validate document", iterations / 10, documentSize, [&]() {
+        return size_t(microjson::isValidJson(document, documentSize));
+    });
+
+    std::string prettyDocument;
+    microjson::prettifyJson(document, documentSize, prettyDocument);
+    std::vector<char> formatted(prettyDocument.size() * 2);
+    benchmark("minify document", iterations / 10, prettyDocument.size(), [&]() {
+        return microjson::minifyJson(prettyDocument.data(), prettyDocument.size(), formatted.data(), formatted.size());
+    });
+
+    benchmark("prettify document", iterations / 10, documentSize, [&]() {
+        return microjson::prettifyJson(document, documentSize, formatted.data(), formatted.size());
+    });
+
+    std::string documentImage;
+    microjson::buildJsonImage(document, documentSize, documentImage);
+    benchmark("load document image", iterations / 10, documentSize, [&]() {
+        microjson::JsonImage image;
+        image.load(documentImage.data(), documentImage.size());
+        return image.root().size();
+    });
+
+    std::string edited = "[";
+    for (int i = 0; i < 20000; ++i) {
+        edited += std::string(document) + ",";
+    }
+    edited.back() = ']';
+    microjson::JsonIncrementalDocument incremental(edited);
+    const size_t editOffset = edited.find("sensor", edited.size() / 2);
+    benchmark("edit then re-parse document", 10, edited.size(), [&]() {
+        edited[editOffset] = edited[editOffset] == 's' ? 'S' : 's';
+        return microjson::parseJsonArray(edited.data(), edited.size()).size();
+    });
+    benchmark("edit incremental document", 10000, edited.size(), [&]() {
+        incremental.edit(editOffset, 1, incremental.text()[editOffset] == 's' ? "S" : "s");
+        return incremental.lastScanSize();
+    });
+    //Inserted and removed byte shifts all following elements
+    const size_t resizeOffset = edited.find("sensor");
+    bool inserted = false;
+    benchmark("resize incremental document", 10000, edited.size(), [&]() {
+        inserted = !inserted;
+        incremental.edit(resizeOffset, inserted ? 0 : 1, inserted ? "x" : "");
+        return incremental.lastScanSize();
+    });
+
+    benchmark("validate number array", 100, numbers.size(), [&]() {
+        return size_t(microjson::isValidJson(numbers.data(), numbers.size()));
+    });
+
+    FILE *records = tmpfile();
+    std::string record;
+    size_t recordsSize = 1;
+    fputc('[', records);
+    for (int i = 0; i < 200000; ++i) {
+        record = (i > 0 ? "," : "") + std::string(document);
+        fwrite(record.data(), 1, record.size(), records);
+        recordsSize += record.size();
+    }
+    fputc(']', records);
+    ++recordsSize;
+
+    benchmark("array file read whole", 3, recordsSize, [&]() {
+        std::string content(recordsSize, '\0');
+        rewind(records);
+        content.resize(fread(&content[0], 1, recordsSize, records));
+        size_t count = 0;
+        for (const auto &value : microjson::parseJsonArray(content.data(), content.size())) {
+            count += microjson::parseJsonObject(value.value.data(), value.value.size()).size();
+        }
+        return count;
+    });
+
+    size_t windowCapacity = 0;
+    benchmark("array file stream", 3, recordsSize, [&]() {
+        rewind(records);
+        microjson::JsonArrayStream stream(records);
+        size_t count = 0;
+        while (stream.next()) {
+            count += stream.object().size();
+        }
+        windowCapacity = stream.windowCapacity();
+        return count;
+    });
+    std::cout << "array file " << recordsSize / 1024 << " KiB, stream window " << windowCapacity / 1024 << " KiB" << std::endl;
+
+#ifdef MICROJSON_HAS_ZLIB
+    char gzipPath[] = "/tmp/microjson_benchmarkXXXXXX";
+    gzFile gzipRecords = gzdopen(mkstemp(gzipPath), "wb");
+    std::string content(recordsSize, '\0');
+    rewind(records);
+    content.resize(fread(&content[0], 1, recordsSize, records));
+    gzwrite(gzipRecords, content.data(), unsigned(content.size()));
+    gzclose(gzipRecords);
+
+    benchmark("gzip array decompress then parse", 3, recordsSize, [&]() {
+        gzFile input = gzopen(gzipPath, "rb");
+        std::string decompressed;
+        char buffer[64 * 1024];
+        int readSize = 0;
+        while ((readSize = gzread(input, buffer, sizeof(buffer))) > 0) {
+            decompressed.append(buffer, size_t(readSize));
+        }
+        gzclose(input);
+        size_t count = 0;
+        for (const auto &value : microjson::parseJsonArray(decompressed.data(), decompressed.size())) {
+            count += microjson::parseJsonObject(value.value.data(), value.value.size()).size();
+        }
+        return count;
+    });
+
+    benchmark("gzip array pipelined stream", 3, recordsSize, [&]() {
+        microjson::JsonArrayStream stream(gzipPath);
+        size_t count = 0;
+        while (stream.next()) {
+            count += stream.object().size();
+        }
+        return count;
+    });
+    unlink(gzipPath);
+#endif
+    fclose(records);
+
+    char ingestDirectory[] = "/tmp/microjson_ingestXXXXXX";
+    std::vector<std::string> paths;
+    if (mkdtemp(ingestDirectory) != nullptr) {
+        for (int i = 0; i < 20000; ++i) {
+            paths.push_back(std::string(ingestDirectory) + "/" + std::to_string(i) + ".json");
+            FILE *file = fopen(paths.back().c_str(), "wb");
+            fwrite(document, 1, documentSize, file);
+            fclose(file);
+        }
+    }
+
+    auto filesPerSecond = [&](const char *name, std::function<size_t()> f) {
+        auto begin = std::chrono::steady_clock::now();
+        sink += f();
+        auto end = std::chrono::steady_clock::now();
+        std::cout << name << ": " << paths.size() / std::chrono::duration<double>(end - begin).count() << " files/s" << std::endl;
+    };
+    filesPerSecond("ingest sequential loop", [&]() {
+        size_t count = 0;
+        std::vector<char> buffer(64 * 1024);
+        for (const auto &path : paths) {
+            FILE *file = fopen(path.c_str(), "rb");
+            const size_t size = fread(buffer.data(), 1, buffer.size(), file);
+            fclose(file);
+            count += microjson::parseJsonObject(buffer.data(), size).size();
+        }
+        return count;
+    });
+    microjson::JsonIngestOptions ingestOptions;
+    std::vector<microjson::JsonObject> ingested;
+    std::vector<microjson::JsonError> ingestErrors;
+    ingestOptions.backend = microjson::JsonIngestThreadPool;
+    filesPerSecond("ingest thread pool", [&]() {
+        microjson::ingestJsonFiles(paths, ingested, ingestErrors, ingestOptions);
+        return ingested.size();
+    });
+    ingestOptions.backend = microjson::JsonIngestIoUring;
+    microjson::JsonIngestBackend usedBackend = microjson::JsonIngestAuto;
+    filesPerSecond("ingest io_uring", [&]() {
+        usedBackend = microjson::ingestJsonFiles(paths, ingested, ingestErrors, ingestOptions);
+        return ingested.size();
+    });
+    if (usedBackend != microjson::JsonIngestIoUring) {
+        std::cout << "io_uring is not available, thread pool was used" << std::endl;
+    }
+    for (const auto &path : paths) {
+        unlink(path.c_str());
+    }
+    rmdir(ingestDirectory);
+
+    return sink == 0;
+}
@@ -24,21 +24,48 @@
  */
 
 #include "microjson.h"
+#include "microjsondetail.h"
 
-#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <locale.h>
+#ifdef __APPLE__
+    #include <xlocale.h>
+#endif
+
+#include <algorithm>
+#include <type_traits>
+
+#ifdef MICROJSON_NO_LOGGING
+    #include <ostream>
+#else
+    #include <iostream>
+#endif
+
+//Type checks disabled output, the while (false) of the macros below keeps its operands unevaluated,
+//so disabled output neither formats nor allocates and needs no static streams
+struct microjsonNull {
+    template<typename T>
+    const microjsonNull &operator<<(const T &) const { return *this; }
+    const microjsonNull &operator<<(std::ostream &(*)(std::ostream &)) const { return *this; }
+};
 
-#ifdef MICROJSON_DEBUG
+#if defined(MICROJSON_DEBUG) && !defined(MICROJSON_NO_LOGGING)
     #define microjsonDebug std::cout
 #else
-    struct microjsonNull : public std::ostream {
-        class nullBuffer : public std::streambuf {};
-        microjsonNull() : std::ostream(new nullBuffer) {}
-    };
-    static microjsonNull nullout;
-    #define microjsonDebug nullout
+    #define microjsonDebug while (false) microjsonNull()
 #endif
 
-namespace {
+#ifdef MICROJSON_NO_LOGGING
+    #define microjsonError while (false) microjsonNull()
+#else
+    #define microjsonError std::cerr
+#endif
+
+namespace microjson {
+namespace detail {
 
 template<const char expectedBeginByte>
 void lookForBoundaries(const char *buffer, size_t size, size_t &begin, size_t &end) {
@@ -52,7 +79,7 @@ void lookForBoundaries(const char *buffer, size_t size, size_t &begin, size_t &e
             if (beginByte == expectedBeginByte) {
                 begin = i;
             } else if (beginByte != '\n' && beginByte != ' ' && beginByte != '\r' && beginByte != '\t') {
-                std::cerr << "Unexpected begin byte" << beginByte << std::endl;
+                microjsonError << "Unexpected begin byte" << beginByte << std::endl;
                 break;
             }
         }
@@ -61,7 +88,7 @@ void lookForBoundaries(const char *buffer, size_t size, size_t &begin, size_t &e
             if (endByte == expectedEndByte) {
                 end = size - i - 1;
             } else if (endByte != '\n' && endByte != ' ' && endByte != '\r' && endByte != '\t') {
-                std::cerr << "Unexpected end byte" << endByte << std::endl;
+                microjsonError << "Unexpected end byte" << endByte << std::endl;
                 break;
             }
         }
@@ -72,7 +99,7 @@ void lookForBoundaries(const char *buffer, size_t size, size_t &begin, size_t &e
     }
 }
 
-void lookForName(const char *buffer, size_t size, size_t &i, microjson::JsonProperty &property) {
+inline void lookForName(const char *buffer, size_t size, size_t &i, microjson::JsonProperty &property) {
     property.nameBegin = SIZE_MAX;
     property.nameEnd = SIZE_MAX;
     bool beginFound = false;
@@ -89,7 +116,7 @@ void lookForName(const char *buffer, size_t size, size_t &i, microjson::JsonProp
                 property.nameBegin = i + 1;
                 beginFound = true;
             } else {
-                std::cerr << "Not found name begin, unexpected" << std::endl;
+                microjsonError << "Not found name begin, unexpected" << std::endl;
                 break;
             }
         } else if(byte == '"') {
@@ -105,7 +132,7 @@ void lookForName(const char *buffer, size_t size, size_t &i, microjson::JsonProp
     ++i;
 }
 
-bool lookForSeparator(const char* buffer, size_t size, size_t &i) {
+inline bool lookForSeparator(const char* buffer, size_t size, size_t &i) {
     bool found = false;
     for(; i < size; ++i) {
         const char byte = buffer[i];
@@ -123,14 +150,21 @@ bool lookForSeparator(const char* buffer, size_t size, size_t &i) {
     return found;
 }
 
-void lookForValue(const char *buffer, size_t size, size_t &i, microjson::JsonProperty &property) {
+enum ValueEndMarker {
+    NoEndMarker,
+    StringEndMarker,
+    NumberEndMarker,
+    ObjectEndMarker,
+    ArrayEndMarker,
+    LiteralEndMarker
+};
+
+inline void lookForValue(const char *buffer, size_t size, size_t &i, microjson::JsonProperty &property) {
     int valueBracesCounter = -1;
     int valueBracketsCounter = -1;
-    int trueCounter = 3;
-    int falseCounter = 4;
-    int nullCounter = 3;
+    int literalCounter = 0;
 
-    std::function<bool(void)> valueEndMarker;
+    ValueEndMarker valueEndMarker = NoEndMarker;
     bool beginFound = false;
     bool stringScope = false;
 
@@ -146,9 +180,7 @@ void lookForValue(const char *buffer, size_t size, size_t &i, microjson::JsonPro
             }
             switch (byte) {
             case '"':
-                valueEndMarker = [&](){
-                    return buffer[i] == '"' && buffer[i - 1] != '\\';
-                };
+                valueEndMarker = StringEndMarker;
                 property.type = microjson::JsonStringType;
                 break;
             case '-':
@@ -162,90 +194,37 @@ void lookForValue(const char *buffer, size_t size, size_t &i, microjson::JsonPro
             case '7':
             case '8':
             case '9':
-                valueEndMarker = [&buffer, &i](){
-                    if (buffer[i] != '+'
-                            && buffer[i] != '-'
-                            && buffer[i] != '0'
-                            && buffer[i] != '1'
-                            && buffer[i] != '2'
-                            && buffer[i] != '3'
-                            && buffer[i] != '4'
-                            && buffer[i] != '5'
-                            && buffer[i] != '6'
-                            && buffer[i] != '7'
-                            && buffer[i] != '8'
-                            && buffer[i] != '9'
-                            && buffer[i] != 'e'
-                            && buffer[i] != '.') {
-                        i--;
-                        return true;
-                    }
-                    return false;
-                };
+                valueEndMarker = NumberEndMarker;
                 property.type = microjson::JsonNumberType;
                 break;
             case '{':
                 valueBracesCounter++;
-                valueEndMarker = [&stringScope, &byte, &valueBracesCounter](){
-                    if (!stringScope) {
-                        switch (byte) {
-                        case '}':
-                            --valueBracesCounter;
-                            break;
-                        case '{':
-                            ++valueBracesCounter;
-                            break;
-                        default:
-                            break;
-                        }
-                    }
-                    return valueBracesCounter < 0;
-                };
+                valueEndMarker = ObjectEndMarker;
                 property.type = microjson::JsonObjectType;
                 break;
             case 't':
-                valueEndMarker = [&trueCounter](){
-                    --trueCounter;
-                    return trueCounter == 0;
-                };
+                literalCounter = 3;
+                valueEndMarker = LiteralEndMarker;
                 property.type = microjson::JsonBoolType;
                 break;
             case 'f':
-                valueEndMarker = [&falseCounter](){
-                    --falseCounter;
-                    return falseCounter == 0;
-                };
+                literalCounter = 4;
+                valueEndMarker = LiteralEndMarker;
                 property.type = microjson::JsonBoolType;
                 break;
             case 'n':
-                valueEndMarker = [&nullCounter](){
-                    --nullCounter;
-                    return nullCounter == 0;
-                };
+                literalCounter = 3;
+                valueEndMarker = LiteralEndMarker;
                 property.type = microjson::JsonObjectType;
                 break;
             case '[':
                 valueBracketsCounter++;
-                valueEndMarker = [&stringScope, &byte, &valueBracketsCounter](){
-                    if(!stringScope) {
-                        switch(byte) {
-                        case ']':
-                            --valueBracketsCounter;
-                            break;
-                        case '[':
-                            ++valueBracketsCounter;
-                            break;
-                        default:
-                            break;
-                        }
-                    }
-                    return valueBracketsCounter < 0;
-                };
+                valueEndMarker = ArrayEndMarker;
                 property.type = microjson::JsonArrayType;
                 break;
             }
 
-            if (valueEndMarker) {
+            if (valueEndMarker != NoEndMarker) {
                 microjsonDebug << "Found value begin" << std::endl;
                 property.valueBegin = i;
                 beginFound = true;
@@ -257,7 +236,45 @@ void lookForValue(const char *buffer, size_t size, size_t &i, microjson::JsonPro
                 stringScope = !stringScope;
             }
 
-            if (valueEndMarker()) {
+            bool endFound = false;
+            switch (valueEndMarker) {
+            case StringEndMarker:
+                endFound = byte == '"' && buffer[i - 1] != '\\';
+                break;
+            case NumberEndMarker:
+                if (byte != '+' && byte != '-' && byte != 'e' && byte != '.' && (byte < '0' || byte > '9')) {
+                    i--;
+                    endFound = true;
+                }
+                break;
+            case ObjectEndMarker:
+                if (!stringScope) {
+                    if (byte == '}') {
+                        --valueBracesCounter;
+                    } else if (byte == '{') {
+                        ++valueBracesCounter;
+                    }
+                }
+                endFound = valueBracesCounter < 0;
+                break;
+            case ArrayEndMarker:
+                if (!stringScope) {
+                    if (byte == ']') {
+                        --valueBracketsCounter;
+                    } else if (byte == '[') {
+                        ++valueBracketsCounter;
+                    }
+                }
+                endFound = valueBracketsCounter < 0;
+                break;
+            case LiteralEndMarker:
+                endFound = --literalCounter == 0;
+                break;
+            case NoEndMarker:
+                break;
+            }
+
+            if (endFound) {
                 microjsonDebug << "Found value end" << std::endl;
                 property.valueEnd = i;
                 break;
@@ -276,7 +293,7 @@ void lookForValue(const char *buffer, size_t size, size_t &i, microjson::JsonPro
     }
 }
 
-void findSeparator(const char *buffer, size_t size, size_t &i, const char expectedEndByte) {
+inline void findSeparator(const char *buffer, size_t size, size_t &i, const char expectedEndByte) {
     while (++i < size) {
         if(!microjson::skipWhiteSpace(buffer[i])) {
             break;
@@ -295,6 +312,50 @@ void findSeparator(const char *buffer, size_t size, size_t &i, const char expect
     }
 }
 
+template<typename Visitor>
+void scanProjection(const char *buffer, size_t size, const microjson::JsonProjection &projection, Visitor visit) {
+    if (buffer == nullptr || size == 0 || size == SIZE_MAX || projection.size() == 0) {
+        return;
+    }
+
+    size_t objectBeginPosition = SIZE_MAX;
+    size_t objectEndPosition = SIZE_MAX;
+    lookForBoundaries<'{'>(buffer, size, objectBeginPosition, objectEndPosition);
+    if (objectBeginPosition == SIZE_MAX || objectEndPosition == SIZE_MAX) {
+        return;
+    }
+
+    buffer += objectBeginPosition + 1;//Skip '{'
+    size = objectEndPosition - objectBeginPosition;//Do not skip '}'
+
+    microjson::JsonProperty property;
+    size_t i = 0;
+    while (i < size) {
+        lookForName(buffer, size, i, property);
+        if (property.nameBegin == SIZE_MAX || property.nameEnd == SIZE_MAX) {
+            break;
+        }
+
+        if (!lookForSeparator(buffer, size, i)) {
+            microjsonError << "Separator not found" << std::endl;
+            break;
+        }
+
+        const size_t index = projection.indexOf(buffer + property.nameBegin, property.nameSize());
+        if (index == SIZE_MAX) {
+            if (!skipValue(buffer, size, i)) {
+                break;
+            }
+        } else {
+            lookForValue(buffer, size, i, property);
+            if (property.check() && !visit(buffer, index, property)) {
+                break;
+            }
+        }
+        findSeparator(buffer, size, i, '}');
+    }
+}
+
 using Extractor = bool(*)(const char *, size_t, size_t &, const char, microjson::JsonProperty &);
 
 template<typename R,
@@ -333,65 +394,2691 @@ R parseJsonCommon(const char *buffer, size_t size) {
     return returnValue;
 }
 
-void appendProperty(const char* buffer, microjson::JsonObject &obj, const microjson::JsonProperty &property){
-    std::string name((buffer + property.nameBegin), property.nameSize());
-    std::string value;
-    if(property.valueSize() > 0) {
-        value = std::string((buffer + property.valueBegin), property.valueSize());
+//Visits properties with offsets relative to the original buffer, scanning stops once visitor
+//returns false
+template<const char expectedBeginByte, Extractor extract, typename Visitor>
+microjson::JsonError scanJsonCommon(const char *buffer, size_t size, Visitor visit) {
+    if (buffer == nullptr || size == 0 || size == SIZE_MAX) {
+        return microjson::JsonSyntaxError;
     }
-    microjsonDebug << "name: " << name << " value: " << value << std::endl;
-    obj[name] = { value, property.type };
-};
 
-void appendValue(const char* buffer, microjson::JsonArray &values, const microjson::JsonProperty &property){
-    std::string value = std::string((buffer + property.valueBegin), property.valueSize());
-    microjsonDebug << "value: " << value << std::endl;
-    values.push_back({value, property.type});
-};
+    size_t objectBeginPosition = SIZE_MAX;
+    size_t objectEndPosition = SIZE_MAX;
+
+    lookForBoundaries<expectedBeginByte>(buffer, size, objectBeginPosition, objectEndPosition);
+    if (objectBeginPosition == SIZE_MAX || objectEndPosition == SIZE_MAX) {
+        return microjson::JsonSyntaxError;
+    }
+
+    const size_t offset = objectBeginPosition + 1;//Skip '{'
+    buffer += offset;
+    size = objectEndPosition - objectBeginPosition;//Do not skip '}'
+
+    size_t nextPosition = 0;
+    for (; nextPosition < size && microjson::skipWhiteSpace(buffer[nextPosition]); ++nextPosition);
+    if (nextPosition == size - 1) {
+        return microjson::JsonNoError;//Empty object
+    }
+
+    microjson::JsonProperty property;
+    while (nextPosition < size) {
+        if (!extract(buffer, size, nextPosition, expectedBeginByte + 2, property)) {
+            return microjson::JsonSyntaxError;
+        }
+
+        if (property.nameBegin != SIZE_MAX) {
+            property.nameBegin += offset;
+            property.nameEnd += offset;
+        }
+        property.valueBegin += offset;
+        property.valueEnd += offset;
+
+        if (!visit(property)) {
+            return microjson::JsonNoError;
+        }
+    }
 
+    return nextPosition == SIZE_MAX ? microjson::JsonSyntaxError : microjson::JsonNoError;
 }
 
-bool microjson::extractValue(const char *buffer, size_t size, size_t &i, const char expectedEndByte, microjson::JsonProperty &property) {
-    if (size == 0) {
-        i = SIZE_MAX;
+template<const char expectedBeginByte, Extractor extract>
+microjson::JsonError parseJsonFixedCommon(const char *buffer, size_t size, microjson::JsonProperty *properties, size_t capacity, size_t &count) {
+    count = 0;
+    bool overflow = false;
+    const microjson::JsonError error = scanJsonCommon<expectedBeginByte, extract>(buffer, size,
+                                                                                  [properties, capacity, &count, &overflow](const microjson::JsonProperty &property) {
+        if (count == capacity) {
+            overflow = true;
+            return false;
+        }
+        properties[count++] = property;
+        return true;
+    });
+    return overflow ? microjson::JsonOverflowError : error;
+}
+
+inline bool isDigit(const char byte) {
+    return byte >= '0' && byte <= '9';
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+//SWAR digit parsing: checks and converts 8 ASCII digits loaded as a single little-endian word
+inline bool isEightDigits(uint64_t word) {
+    return ((word & 0xF0F0F0F0F0F0F0F0ull) |
+            (((word + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+inline uint64_t parseEightDigits(uint64_t word) {
+    word -= 0x3030303030303030ull;
+    word = (word * 10) + (word >> 8);
+    word = (((word & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) +
+            (((word >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+    return word;
+}
+#endif
+
+//Reads up to 19 significant digits into value, digits counts all the consumed digits
+inline void readDigits(const char *&p, const char *end, uint64_t &value, int &digits) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - p >= 8 && digits + 8 <= 19) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        if (!isEightDigits(word)) {
+            break;
+        }
+        value = value * 100000000 + parseEightDigits(word);
+        digits += 8;
+        p += 8;
+    }
+#endif
+    for (; p < end && isDigit(*p); ++p, ++digits) {
+        if (digits < 19) {
+            value = value * 10 + (*p - '0');
+        }
+    }
+}
+
+inline bool parseNumber(const char *&p, const char *end, int64_t &out) {
+    const bool negative = p < end && *p == '-';
+    if (negative) {
+        ++p;
+    }
+
+    if (p == end || !isDigit(*p) || (*p == '0' && p + 1 < end && isDigit(p[1]))) {
         return false;
     }
-    lookForValue(buffer, size, i, property);
-    findSeparator(buffer, size, i, expectedEndByte);
 
-    return property.checkValue();
+    uint64_t value = 0;
+    int digits = 0;
+    readDigits(p, end, value, digits);
+    if (digits > 19 || (p < end && (*p == '.' || *p == 'e' || *p == 'E'))) {
+        return false;
+    }
+
+    if (negative) {
+        if (value > uint64_t(INT64_MAX) + 1) {
+            return false;
+        }
+        out = value == uint64_t(INT64_MAX) + 1 ? INT64_MIN : -int64_t(value);
+    } else {
+        if (value > uint64_t(INT64_MAX)) {
+            return false;
+        }
+        out = int64_t(value);
+    }
+    return true;
 }
 
-bool microjson::extractProperty(const char *buffer, size_t size, size_t &i, const char expectedEndByte, microjson::JsonProperty &property) {
-    if (size == 0) {
-        i = SIZE_MAX;
-        return false;
+//strtod in the C locale, so '.' is the decimal point whatever locale the application has set
+inline double strtodC(const char *text) {
+#if defined(_WIN32)
+    static const _locale_t locale = _create_locale(LC_NUMERIC, "C");
+    if (locale != nullptr) {
+        return _strtod_l(text, nullptr, locale);
+    }
+#elif defined(__unix__) || defined(__APPLE__)
+    static const locale_t locale = newlocale(LC_NUMERIC_MASK, "C", locale_t(0));
+    if (locale != locale_t(0)) {
+        return strtod_l(text, nullptr, locale);
     }
+#endif
+    return strtod(text, nullptr);
+}
 
-    lookForName(buffer, size, i, property);
-    if(property.nameBegin == SIZE_MAX && property.nameEnd == SIZE_MAX) {
-        std::cerr << "Name not found" << std::endl;
+inline bool parseNumber(const char *&p, const char *end, double &out) {
+    static const double powersOf10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char *begin = p;
+    const bool negative = p < end && *p == '-';
+    if (negative) {
+        ++p;
+    }
+
+    if (p == end || !isDigit(*p) || (*p == '0' && p + 1 < end && isDigit(p[1]))) {
         return false;
     }
 
-    microjsonDebug << "Found name: " << std::string(buffer + property.nameBegin, property.nameSize()) << std::endl;
+    uint64_t mantissa = 0;
+    int digits = 0;
+    readDigits(p, end, mantissa, digits);
+    int exponent = digits > 19 ? digits - 19 : 0;
+
+    if (p < end && *p == '.') {
+        ++p;
+        if (p == end || !isDigit(*p)) {
+            return false;
+        }
+        const int integerDigits = digits;
+        readDigits(p, end, mantissa, digits);
+        exponent -= (digits > 19 ? 19 : digits) - (integerDigits > 19 ? 19 : integerDigits);
+    }
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        const bool negativeExponent = p < end && *p == '-';
+        if (p < end && (*p == '-' || *p == '+')) {
+            ++p;
+        }
+        if (p == end || !isDigit(*p)) {
+            return false;
+        }
+        int explicitExponent = 0;
+        for (; p < end && isDigit(*p); ++p) {
+            if (explicitExponent < 100000) {
+                explicitExponent = explicitExponent * 10 + (*p - '0');
+            }
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    if (digits <= 19 && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        double value = double(mantissa);
+        value = exponent < 0 ? value / powersOf10[-exponent] : value * powersOf10[exponent];
+        out = negative ? -value : value;
+        return true;
+    }
+
+    //Slow path, value can't be represented exactly by fast conversion
+    char localBuffer[64];
+    const size_t length = p - begin;
+    std::string heapBuffer;
+    char *text = localBuffer;
+    if (length >= sizeof(localBuffer)) {
+        heapBuffer.assign(begin, length);
+        text = &heapBuffer[0];
+    } else {
+        memcpy(localBuffer, begin, length);
+        localBuffer[length] = '\0';
+    }
+    out = strtodC(text);
+    return true;
+}
+
+inline const char *skipWhiteSpaces(const char *p, const char *end) {
+    for (; p < end && microjson::skipWhiteSpace(*p); ++p);
+    return p;
+}
 
-    if(!lookForSeparator(buffer, size, i)) {
-        std::cerr << "Separator not found" << std::endl;
+//Walks the array elements and stores numbers using store, tuples are expected when tupleSize > 0
+template<typename T, typename Store>
+bool parseNumberArrayCommon(const char *buffer, size_t size, size_t tupleSize, Store store) {
+    if (buffer == nullptr || size == 0 || size == SIZE_MAX) {
         return false;
     }
 
-    lookForValue(buffer, size, i, property);
-    microjsonDebug << "Found value: " << std::string(buffer + property.valueBegin, property.valueSize()) << std::endl;
-    findSeparator(buffer, size, i, expectedEndByte);
+    size_t arrayBeginPosition = SIZE_MAX;
+    size_t arrayEndPosition = SIZE_MAX;
+    lookForBoundaries<'['>(buffer, size, arrayBeginPosition, arrayEndPosition);
+    if (arrayBeginPosition == SIZE_MAX || arrayEndPosition == SIZE_MAX) {
+        return false;
+    }
 
-    return property.check();
+    const char *p = skipWhiteSpaces(buffer + arrayBeginPosition + 1, buffer + arrayEndPosition);
+    const char *end = buffer + arrayEndPosition;
+    if (p == end) {
+        return true;
+    }
+
+    while (true) {
+        if (tupleSize > 0) {
+            if (*p != '[') {
+                return false;
+            }
+            p = skipWhiteSpaces(p + 1, end);
+            for (size_t i = 0; i < tupleSize; ++i) {
+                T value;
+                if (!parseNumber(p, end, value) || !store(value)) {
+                    return false;
+                }
+                p = skipWhiteSpaces(p, end);
+                if (p == end || *p != (i + 1 == tupleSize ? ']' : ',')) {
+                    return false;
+                }
+                p = skipWhiteSpaces(p + 1, end);
+            }
+        } else {
+            T value;
+            if (!parseNumber(p, end, value) || !store(value)) {
+                return false;
+            }
+            p = skipWhiteSpaces(p, end);
+        }
+
+        if (p == end) {
+            return true;
+        }
+
+        if (*p != ',') {
+            return false;
+        }
+        p = skipWhiteSpaces(p + 1, end);
+        if (p == end) {
+            return false;
+        }
+    }
 }
 
-microjson::JsonObject microjson::parseJsonObject(const char *buffer, size_t size) {
-    return parseJsonCommon<JsonObject, '{', extractProperty, appendProperty>(buffer, size);
+template<typename T>
+bool parseNumberArrayToVector(const char *buffer, size_t size, size_t tupleSize, std::vector<T> &out) {
+    const size_t originalSize = out.size();
+    if (parseNumberArrayCommon<T>(buffer, size, tupleSize, [&out](T value) {
+        out.push_back(value);
+        return true;
+    })) {
+        return true;
+    }
+    out.resize(originalSize);
+    return false;
 }
 
-microjson::JsonArray microjson::parseJsonArray(const char *buffer, size_t size) {
-    return parseJsonCommon<JsonArray, '[', extractValue, appendValue>(buffer, size);
+template<typename T>
+size_t parseNumberArrayToBuffer(const char *buffer, size_t size, size_t tupleSize, T *out, size_t capacity) {
+    size_t count = 0;
+    if (parseNumberArrayCommon<T>(buffer, size, tupleSize, [out, capacity, &count](T value) {
+        if (count == capacity) {
+            return false;
+        }
+        out[count++] = value;
+        return true;
+    })) {
+        return count;
+    }
+    return SIZE_MAX;
+}
+
+//Appends unescaped string, returns false on malformed escape sequence
+inline bool unescapeString(const char *buffer, size_t size, std::string &out) {
+    out.reserve(out.size() + size);
+    for (size_t i = 0; i < size; ++i) {
+        const char byte = buffer[i];
+        if (byte != '\\') {
+            out.push_back(byte);
+            continue;
+        }
+
+        if (++i == size) {
+            return false;
+        }
+
+        switch (buffer[i]) {
+        case '"': out.push_back('"'); break;
+        case '\\': out.push_back('\\'); break;
+        case '/': out.push_back('/'); break;
+        case 'b': out.push_back('\b'); break;
+        case 'f': out.push_back('\f'); break;
+        case 'n': out.push_back('\n'); break;
+        case 'r': out.push_back('\r'); break;
+        case 't': out.push_back('\t'); break;
+        case 'u': {
+            auto readHex = [&buffer, size](size_t at, uint32_t &code) {
+                if (at + 4 > size) {
+                    return false;
+                }
+                code = 0;
+                for (size_t j = at; j < at + 4; ++j) {
+                    const char hex = buffer[j];
+                    code <<= 4;
+                    if (hex >= '0' && hex <= '9') {
+                        code |= hex - '0';
+                    } else if (hex >= 'a' && hex <= 'f') {
+                        code |= hex - 'a' + 10;
+                    } else if (hex >= 'A' && hex <= 'F') {
+                        code |= hex - 'A' + 10;
+                    } else {
+                        return false;
+                    }
+                }
+                return true;
+            };
+
+            uint32_t code = 0;
+            if (!readHex(i + 1, code)) {
+                return false;
+            }
+            i += 4;
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                uint32_t low = 0;
+                if (i + 2 >= size || buffer[i + 1] != '\\' || buffer[i + 2] != 'u' || !readHex(i + 3, low)
+                        || low < 0xDC00 || low > 0xDFFF) {
+                    return false;
+                }
+                i += 6;
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            } else if (code >= 0xDC00 && code <= 0xDFFF) {
+                return false;
+            }
+
+            if (code < 0x80) {
+                out.push_back(char(code));
+            } else if (code < 0x800) {
+                out.push_back(char(0xC0 | (code >> 6)));
+                out.push_back(char(0x80 | (code & 0x3F)));
+            } else if (code < 0x10000) {
+                out.push_back(char(0xE0 | (code >> 12)));
+                out.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+                out.push_back(char(0x80 | (code & 0x3F)));
+            } else {
+                out.push_back(char(0xF0 | (code >> 18)));
+                out.push_back(char(0x80 | ((code >> 12) & 0x3F)));
+                out.push_back(char(0x80 | ((code >> 6) & 0x3F)));
+                out.push_back(char(0x80 | (code & 0x3F)));
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void appendBigEndian(std::vector<uint8_t> &out, uint64_t value, size_t bytes) {
+    for (size_t i = bytes; i > 0; --i) {
+        out.push_back(uint8_t(value >> ((i - 1) * 8)));
+    }
+}
+
+struct MessagePackWriter {
+    static void writeNull(std::vector<uint8_t> &out) {
+        out.push_back(0xc0);
+    }
+
+    static void writeBool(std::vector<uint8_t> &out, bool value) {
+        out.push_back(value ? 0xc3 : 0xc2);
+    }
+
+    static void writeInt(std::vector<uint8_t> &out, int64_t value) {
+        if (value >= 0) {
+            if (value < 128) {
+                out.push_back(uint8_t(value));
+            } else if (value <= UINT8_MAX) {
+                out.push_back(0xcc);
+                appendBigEndian(out, uint64_t(value), 1);
+            } else if (value <= UINT16_MAX) {
+                out.push_back(0xcd);
+                appendBigEndian(out, uint64_t(value), 2);
+            } else if (value <= UINT32_MAX) {
+                out.push_back(0xce);
+                appendBigEndian(out, uint64_t(value), 4);
+            } else {
+                out.push_back(0xcf);
+                appendBigEndian(out, uint64_t(value), 8);
+            }
+        } else if (value >= -32) {
+            out.push_back(uint8_t(value));
+        } else if (value >= INT8_MIN) {
+            out.push_back(0xd0);
+            appendBigEndian(out, uint64_t(value), 1);
+        } else if (value >= INT16_MIN) {
+            out.push_back(0xd1);
+            appendBigEndian(out, uint64_t(value), 2);
+        } else if (value >= INT32_MIN) {
+            out.push_back(0xd2);
+            appendBigEndian(out, uint64_t(value), 4);
+        } else {
+            out.push_back(0xd3);
+            appendBigEndian(out, uint64_t(value), 8);
+        }
+    }
+
+    static void writeDouble(std::vector<uint8_t> &out, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        out.push_back(0xcb);
+        appendBigEndian(out, bits, 8);
+    }
+
+    static void writeString(std::vector<uint8_t> &out, const char *data, size_t size) {
+        if (size < 32) {
+            out.push_back(uint8_t(0xa0 | size));
+        } else if (size <= UINT8_MAX) {
+            out.push_back(0xd9);
+            appendBigEndian(out, size, 1);
+        } else if (size <= UINT16_MAX) {
+            out.push_back(0xda);
+            appendBigEndian(out, size, 2);
+        } else {
+            out.push_back(0xdb);
+            appendBigEndian(out, size, 4);
+        }
+        out.insert(out.end(), data, data + size);
+    }
+
+    //Container size is unknown until the scan is finished, room for map32/array32 header is
+    //reserved and the smallest header that fits the count is written over it. Bytes it leaves
+    //unused are recorded as gap and removed by compact in a single pass over the output
+    static size_t beginContainer(std::vector<uint8_t> &out, bool isObject) {
+        const size_t headerPosition = out.size();
+        out.push_back(isObject ? 0x80 : 0x90);
+        appendBigEndian(out, 0, 4);
+        return headerPosition;
+    }
+
+    static void endContainer(std::vector<uint8_t> &out, size_t headerPosition, uint32_t count,
+                             std::vector<std::pair<size_t, size_t>> &gaps) {
+        const bool isObject = out[headerPosition] == 0x80;
+        uint8_t header[5];
+        size_t headerSize = 0;
+        if (count < 16) {
+            header[headerSize++] = uint8_t((isObject ? 0x80 : 0x90) | count);
+        } else if (count <= UINT16_MAX) {
+            header[headerSize++] = isObject ? 0xde : 0xdc;
+            header[headerSize++] = uint8_t(count >> 8);
+            header[headerSize++] = uint8_t(count);
+        } else {
+            header[headerSize++] = isObject ? 0xdf : 0xdd;
+            for (size_t i = 0; i < 4; ++i) {
+                header[headerSize++] = uint8_t(count >> ((3 - i) * 8));
+            }
+        }
+        memcpy(&out[headerPosition], header, headerSize);
+        if (headerSize < 5) {
+            gaps.emplace_back(headerPosition + headerSize, 5 - headerSize);
+        }
+    }
+
+    //Containers end innermost first, so gaps are sorted before the bytes between them are moved
+    static void compact(std::vector<uint8_t> &out, std::vector<std::pair<size_t, size_t>> &gaps) {
+        if (gaps.empty()) {
+            return;
+        }
+        std::sort(gaps.begin(), gaps.end());
+        size_t position = gaps.front().first;
+        for (size_t i = 0; i < gaps.size(); ++i) {
+            const size_t begin = gaps[i].first + gaps[i].second;
+            const size_t end = i + 1 < gaps.size() ? gaps[i + 1].first : out.size();
+            memmove(out.data() + position, out.data() + begin, end - begin);
+            position += end - begin;
+        }
+        out.resize(position);
+    }
+};
+
+struct CborWriter {
+    static void writeHead(std::vector<uint8_t> &out, uint8_t majorType, uint64_t value) {
+        majorType <<= 5;
+        if (value < 24) {
+            out.push_back(uint8_t(majorType | value));
+        } else if (value <= UINT8_MAX) {
+            out.push_back(majorType | 24);
+            appendBigEndian(out, value, 1);
+        } else if (value <= UINT16_MAX) {
+            out.push_back(majorType | 25);
+            appendBigEndian(out, value, 2);
+        } else if (value <= UINT32_MAX) {
+            out.push_back(majorType | 26);
+            appendBigEndian(out, value, 4);
+        } else {
+            out.push_back(majorType | 27);
+            appendBigEndian(out, value, 8);
+        }
+    }
+
+    static void writeNull(std::vector<uint8_t> &out) {
+        out.push_back(0xf6);
+    }
+
+    static void writeBool(std::vector<uint8_t> &out, bool value) {
+        out.push_back(value ? 0xf5 : 0xf4);
+    }
+
+    static void writeInt(std::vector<uint8_t> &out, int64_t value) {
+        if (value >= 0) {
+            writeHead(out, 0, uint64_t(value));
+        } else {
+            writeHead(out, 1, uint64_t(-(value + 1)));
+        }
+    }
+
+    static void writeDouble(std::vector<uint8_t> &out, double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        out.push_back(0xfb);
+        appendBigEndian(out, bits, 8);
+    }
+
+    static void writeString(std::vector<uint8_t> &out, const char *data, size_t size) {
+        writeHead(out, 3, size);
+        out.insert(out.end(), data, data + size);
+    }
+
+    //Indefinite length containers, so nothing needs to be patched
+    static size_t beginContainer(std::vector<uint8_t> &out, bool isObject) {
+        out.push_back(isObject ? 0xbf : 0x9f);
+        return SIZE_MAX;
+    }
+
+    static void endContainer(std::vector<uint8_t> &out, size_t, uint32_t, std::vector<std::pair<size_t, size_t>> &) {
+        out.push_back(0xff);
+    }
+
+    static void compact(std::vector<uint8_t> &, std::vector<std::pair<size_t, size_t>> &) {
+    }
+};
+
+const int MaxTranscodingDepth = 512;
+
+template<typename Writer>
+struct Transcoder {
+    std::vector<uint8_t> &out;
+    std::string unescaped;
+    std::vector<std::pair<size_t, size_t>> gaps;//Unused header bytes, position and size
+
+    bool writeString(const char *data, size_t size) {
+        if (memchr(data, '\\', size) == nullptr) {
+            Writer::writeString(out, data, size);
+            return true;
+        }
+
+        unescaped.clear();
+        if (!unescapeString(data, size, unescaped)) {
+            return false;
+        }
+        Writer::writeString(out, unescaped.data(), unescaped.size());
+        return true;
+    }
+
+    bool writeValue(const char *buffer, const microjson::JsonProperty &property, int depth) {
+        const char *value = buffer + property.valueBegin;
+        const size_t size = property.valueSize();
+        switch (property.type) {
+        case microjson::JsonStringType:
+            return writeString(value, size);
+        case microjson::JsonNumberType: {
+            const char *end = value + size;
+            const char *p = value;
+            int64_t integer = 0;
+            if (parseNumber(p, end, integer) && p == end) {
+                Writer::writeInt(out, integer);
+                return true;
+            }
+            p = value;
+            double number = 0;
+            if (parseNumber(p, end, number) && p == end) {
+                Writer::writeDouble(out, number);
+                return true;
+            }
+            return false;
+        }
+        case microjson::JsonBoolType:
+            Writer::writeBool(out, value[0] == 't');
+            return true;
+        case microjson::JsonObjectType:
+            if (value[0] == 'n') {
+                Writer::writeNull(out);
+                return true;
+            }
+            return writeContainer<'{'>(value, size, depth + 1);
+        case microjson::JsonArrayType:
+            return writeContainer<'['>(value, size, depth + 1);
+        default:
+            break;
+        }
+        return false;
+    }
+
+    //buffer points to the opening byte of container
+    template<const char expectedBeginByte>
+    bool writeContainer(const char *buffer, size_t size, int depth) {
+        if (depth > MaxTranscodingDepth) {
+            return false;
+        }
+
+        const bool isObject = expectedBeginByte == '{';
+        const size_t sizePosition = Writer::beginContainer(out, isObject);
+        uint32_t count = 0;
+
+        ++buffer;//Skip '{'
+        --size;
+        size_t i = 0;
+        for (; i < size && microjson::skipWhiteSpace(buffer[i]); ++i);
+        if (i < size && buffer[i] == expectedBeginByte + 2) {
+            Writer::endContainer(out, sizePosition, count, gaps);
+            return true;
+        }
+
+        microjson::JsonProperty property;
+        while (i < size) {
+            const bool extracted = isObject ? microjson::extractProperty(buffer, size, i, expectedBeginByte + 2, property)
+                                            : microjson::extractValue(buffer, size, i, expectedBeginByte + 2, property);
+            if (!extracted) {
+                return false;
+            }
+
+            if (isObject && !writeString(buffer + property.nameBegin, property.nameSize())) {
+                return false;
+            }
+
+            if (!writeValue(buffer, property, depth)) {
+                return false;
+            }
+            ++count;
+        }
+
+        if (i == SIZE_MAX) {
+            return false;
+        }
+
+        Writer::endContainer(out, sizePosition, count, gaps);
+        return true;
+    }
+};
+
+template<typename Writer>
+bool transcodeJson(const char *buffer, size_t size, std::vector<uint8_t> &out) {
+    if (buffer == nullptr || size == 0 || size == SIZE_MAX) {
+        return false;
+    }
+
+    size_t i = 0;
+    for (; i < size && microjson::skipWhiteSpace(buffer[i]); ++i);
+    if (i == size || (buffer[i] != '{' && buffer[i] != '[')) {
+        return false;
+    }
+
+    size_t beginPosition = SIZE_MAX;
+    size_t endPosition = SIZE_MAX;
+    if (buffer[i] == '{') {
+        lookForBoundaries<'{'>(buffer, size, beginPosition, endPosition);
+    } else {
+        lookForBoundaries<'['>(buffer, size, beginPosition, endPosition);
+    }
+
+    if (beginPosition == SIZE_MAX || endPosition == SIZE_MAX) {
+        return false;
+    }
+
+    const size_t originalSize = out.size();
+    Transcoder<Writer> transcoder{out, std::string(), std::vector<std::pair<size_t, size_t>>()};
+    const bool ok = buffer[i] == '{' ? transcoder.template writeContainer<'{'>(buffer + beginPosition, endPosition - beginPosition + 1, 0)
+                                     : transcoder.template writeContainer<'['>(buffer + beginPosition, endPosition - beginPosition + 1, 0);
+    if (!ok) {
+        out.resize(originalSize);
+        return false;
+    }
+    Writer::compact(out, transcoder.gaps);
+    return true;
+}
+
+inline void appendJsonString(std::string &out, const char *data, size_t size) {
+    static const char hexDigits[] = "0123456789abcdef";
+    out.push_back('"');
+    for (size_t i = 0; i < size; ++i) {
+        const unsigned char byte = data[i];
+        switch (byte) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (byte < 0x20) {
+                out += "\\u00";
+                out.push_back(hexDigits[byte >> 4]);
+                out.push_back(hexDigits[byte & 0xF]);
+            } else {
+                out.push_back(char(byte));
+            }
+            break;
+        }
+    }
+    out.push_back('"');
+}
+
+inline void appendJsonNumber(std::string &out, double value) {
+    if (value != value || value - value != 0) {
+        out += "null";//NaN and infinities are not representable in JSON
+        return;
+    }
+    //Shortest of 15-17 significant digits that reads back to the same value. Decimal point of
+    //the current locale is replaced before reading back in the C locale, so the output does not
+    //depend on it
+    char formatted[40];
+    char number[40];
+    for (int precision = 15; precision <= 17; ++precision) {
+        snprintf(formatted, sizeof(formatted), "%.*g", precision, value);
+        size_t length = 0;
+        bool decimalPoint = false;
+        for (const char *p = formatted; *p != '\0'; ++p) {
+            if (isDigit(*p) || *p == '-' || *p == '+' || *p == 'e') {
+                number[length++] = *p;
+                decimalPoint = false;
+            } else if (!decimalPoint) {
+                number[length++] = '.';
+                decimalPoint = true;
+            }
+        }
+        number[length] = '\0';
+        if (strtodC(number) == value) {
+            break;
+        }
+    }
+    out += number;
+}
+
+inline void appendJsonNumber(std::string &out, int64_t value) {
+    char number[24];
+    snprintf(number, sizeof(number), "%lld", static_cast<long long>(value));
+    out += number;
+}
+
+inline void appendJsonNumber(std::string &out, uint64_t value) {
+    char number[24];
+    snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(value));
+    out += number;
+}
+
+struct BinaryReader {
+    const uint8_t *buffer;
+    size_t size;
+    size_t position;
+
+    bool read(uint64_t &value, size_t bytes) {
+        if (size - position < bytes) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = 0; i < bytes; ++i) {
+            value = (value << 8) | buffer[position++];
+        }
+        return true;
+    }
+
+    bool readString(std::string &out, uint64_t length) {
+        if (size - position < length) {
+            return false;
+        }
+        appendJsonString(out, reinterpret_cast<const char *>(buffer + position), length);
+        position += length;
+        return true;
+    }
+};
+
+inline bool readHalfFloat(uint16_t half, double &value) {
+    const int exponent = (half >> 10) & 0x1f;
+    const int mantissa = half & 0x3ff;
+    if (exponent == 0) {
+        value = ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        value = ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        value = mantissa == 0 ? HUGE_VAL : NAN;
+    }
+    if (half & 0x8000) {
+        value = -value;
+    }
+    return true;
+}
+
+inline bool messagePackValueToJson(BinaryReader &reader, std::string &out, int depth, bool isKey);
+
+inline bool messagePackContainerToJson(BinaryReader &reader, std::string &out, uint64_t count, bool isObject, int depth) {
+    if (depth > MaxTranscodingDepth) {
+        return false;
+    }
+
+    out.push_back(isObject ? '{' : '[');
+    for (uint64_t i = 0; i < count; ++i) {
+        if (i > 0) {
+            out.push_back(',');
+        }
+        if (isObject) {
+            if (!messagePackValueToJson(reader, out, depth, true)) {
+                return false;
+            }
+            out.push_back(':');
+        }
+        if (!messagePackValueToJson(reader, out, depth, false)) {
+            return false;
+        }
+    }
+    out.push_back(isObject ? '}' : ']');
+    return true;
+}
+
+inline bool messagePackValueToJson(BinaryReader &reader, std::string &out, int depth, bool isKey) {
+    uint64_t type = 0;
+    if (!reader.read(type, 1)) {
+        return false;
+    }
+
+    uint64_t value = 0;
+    if (type >= 0xa0 && type <= 0xbf) {
+        return reader.readString(out, type & 0x1f);
+    }
+
+    if (type == 0xd9 || type == 0xda || type == 0xdb) {
+        return reader.read(value, size_t(1) << (type - 0xd9)) && reader.readString(out, value);
+    }
+
+    if (isKey) {
+        return false;//JSON object keys must be strings
+    }
+
+    if (type <= 0x7f) {
+        appendJsonNumber(out, int64_t(type));
+        return true;
+    }
+
+    if (type >= 0xe0) {
+        appendJsonNumber(out, int64_t(int8_t(type)));
+        return true;
+    }
+
+    if (type >= 0x80 && type <= 0x8f) {
+        return messagePackContainerToJson(reader, out, type & 0x0f, true, depth + 1);
+    }
+
+    if (type >= 0x90 && type <= 0x9f) {
+        return messagePackContainerToJson(reader, out, type & 0x0f, false, depth + 1);
+    }
+
+    switch (type) {
+    case 0xc0:
+        out += "null";
+        return true;
+    case 0xc2:
+        out += "false";
+        return true;
+    case 0xc3:
+        out += "true";
+        return true;
+    case 0xca: {
+        if (!reader.read(value, 4)) {
+            return false;
+        }
+        const uint32_t bits = uint32_t(value);
+        float number;
+        memcpy(&number, &bits, sizeof(number));
+        appendJsonNumber(out, double(number));
+        return true;
+    }
+    case 0xcb: {
+        if (!reader.read(value, 8)) {
+            return false;
+        }
+        double number;
+        memcpy(&number, &value, sizeof(number));
+        appendJsonNumber(out, number);
+        return true;
+    }
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+    case 0xcf:
+        if (!reader.read(value, size_t(1) << (type - 0xcc))) {
+            return false;
+        }
+        appendJsonNumber(out, value);
+        return true;
+    case 0xd0:
+        if (!reader.read(value, 1)) {
+            return false;
+        }
+        appendJsonNumber(out, int64_t(int8_t(value)));
+        return true;
+    case 0xd1:
+        if (!reader.read(value, 2)) {
+            return false;
+        }
+        appendJsonNumber(out, int64_t(int16_t(value)));
+        return true;
+    case 0xd2:
+        if (!reader.read(value, 4)) {
+            return false;
+        }
+        appendJsonNumber(out, int64_t(int32_t(value)));
+        return true;
+    case 0xd3:
+        if (!reader.read(value, 8)) {
+            return false;
+        }
+        appendJsonNumber(out, int64_t(value));
+        return true;
+    case 0xdc:
+    case 0xdd:
+        return reader.read(value, type == 0xdc ? 2 : 4) && messagePackContainerToJson(reader, out, value, false, depth + 1);
+    case 0xde:
+    case 0xdf:
+        return reader.read(value, type == 0xde ? 2 : 4) && messagePackContainerToJson(reader, out, value, true, depth + 1);
+    default:
+        break;
+    }
+    return false;//bin and ext types have no JSON representation
+}
+
+inline bool cborValueToJson(BinaryReader &reader, std::string &out, int depth, bool isKey);
+
+inline bool cborReadArgument(BinaryReader &reader, uint8_t additional, uint64_t &value) {
+    if (additional < 24) {
+        value = additional;
+        return true;
+    }
+    if (additional > 27) {
+        return false;
+    }
+    return reader.read(value, size_t(1) << (additional - 24));
+}
+
+inline bool cborValueToJson(BinaryReader &reader, std::string &out, int depth, bool isKey) {
+    uint64_t initial = 0;
+    if (!reader.read(initial, 1)) {
+        return false;
+    }
+
+    const uint8_t majorType = uint8_t(initial >> 5);
+    const uint8_t additional = uint8_t(initial & 0x1f);
+    uint64_t value = 0;
+
+    if (majorType == 3) {
+        return additional != 31 && cborReadArgument(reader, additional, value) && reader.readString(out, value);
+    }
+
+    if (isKey) {
+        return false;//JSON object keys must be strings
+    }
+
+    switch (majorType) {
+    case 0:
+        if (!cborReadArgument(reader, additional, value)) {
+            return false;
+        }
+        appendJsonNumber(out, value);
+        return true;
+    case 1:
+        if (!cborReadArgument(reader, additional, value)) {
+            return false;
+        }
+        if (value > uint64_t(INT64_MAX)) {
+            appendJsonNumber(out, -1.0 - double(value));
+        } else {
+            appendJsonNumber(out, -1 - int64_t(value));
+        }
+        return true;
+    case 4:
+    case 5: {
+        const bool isObject = majorType == 5;
+        const bool indefinite = additional == 31;
+        if (depth + 1 > MaxTranscodingDepth || (!indefinite && !cborReadArgument(reader, additional, value))) {
+            return false;
+        }
+
+        out.push_back(isObject ? '{' : '[');
+        for (uint64_t i = 0; indefinite || i < value; ++i) {
+            if (indefinite) {
+                if (reader.position >= reader.size) {
+                    return false;
+                }
+                if (reader.buffer[reader.position] == 0xff) {
+                    ++reader.position;
+                    break;
+                }
+            }
+            if (i > 0) {
+                out.push_back(',');
+            }
+            if (isObject) {
+                if (!cborValueToJson(reader, out, depth + 1, true)) {
+                    return false;
+                }
+                out.push_back(':');
+            }
+            if (!cborValueToJson(reader, out, depth + 1, false)) {
+                return false;
+            }
+        }
+        out.push_back(isObject ? '}' : ']');
+        return true;
+    }
+    case 6:
+        //Tags carry no meaning for JSON, tagged item is converted as is. Chains of tags nest like
+        //containers, so they are limited by the same depth
+        return depth + 1 <= MaxTranscodingDepth && cborReadArgument(reader, additional, value)
+                && cborValueToJson(reader, out, depth + 1, false);
+    case 7:
+        switch (additional) {
+        case 20:
+            out += "false";
+            return true;
+        case 21:
+            out += "true";
+            return true;
+        case 22:
+        case 23:
+            out += "null";
+            return true;
+        case 25: {
+            double number = 0;
+            if (!reader.read(value, 2) || !readHalfFloat(uint16_t(value), number)) {
+                return false;
+            }
+            appendJsonNumber(out, number);
+            return true;
+        }
+        case 26: {
+            if (!reader.read(value, 4)) {
+                return false;
+            }
+            const uint32_t bits = uint32_t(value);
+            float number;
+            memcpy(&number, &bits, sizeof(number));
+            appendJsonNumber(out, double(number));
+            return true;
+        }
+        case 27: {
+            if (!reader.read(value, 8)) {
+                return false;
+            }
+            double number;
+            memcpy(&number, &value, sizeof(number));
+            appendJsonNumber(out, number);
+            return true;
+        }
+        default:
+            break;
+        }
+        break;
+    default:
+        break;
+    }
+    return false;//Byte strings and unknown simple values have no JSON representation
+}
+
+template<bool (*convert)(BinaryReader &, std::string &, int, bool)>
+bool binaryToJson(const uint8_t *buffer, size_t size, std::string &out) {
+    if (buffer == nullptr || size == 0) {
+        return false;
+    }
+
+    const size_t originalSize = out.size();
+    BinaryReader reader{buffer, size, 0};
+    if (!convert(reader, out, 0, false) || reader.position != size) {
+        out.resize(originalSize);
+        return false;
+    }
+    return true;
+}
+
+//Visits members of the container that spans buffer[begin, end] with offsets relative to buffer.
+//Strings are skipped with escapes counted, so only the container itself needs to be well-formed.
+//Returns false on malformed member or when visit returns false.
+template<typename Visitor>
+bool walkPointerContainer(const char *buffer, size_t begin, size_t end, bool isObject, Visitor visit) {
+    const char closingByte = isObject ? '}' : ']';
+    size_t i = begin + 1;
+    for (; i < end && microjson::skipWhiteSpace(buffer[i]); ++i);
+    if (i < end && buffer[i] == closingByte) {
+        return true;
+    }
+
+    while (i < end) {
+        microjson::JsonProperty child;
+        if (isObject) {
+            if (buffer[i] != '"') {
+                return false;
+            }
+            child.nameBegin = i + 1;
+            if (!skipString(buffer, end, i)) {
+                return false;
+            }
+            child.nameEnd = i;
+            for (++i; i < end && microjson::skipWhiteSpace(buffer[i]); ++i);
+            if (i == end || buffer[i] != ':') {
+                return false;
+            }
+            ++i;
+        }
+
+        for (; i < end && microjson::skipWhiteSpace(buffer[i]); ++i);
+        child.valueBegin = i;
+        if (!skipValue(buffer, end, i)) {
+            return false;
+        }
+        child.valueEnd = i;
+        switch (buffer[child.valueBegin]) {
+        case '"':
+            child.type = microjson::JsonStringType;
+            ++child.valueBegin;
+            --child.valueEnd;
+            break;
+        case '{':
+        case 'n':
+            child.type = microjson::JsonObjectType;
+            break;
+        case '[':
+            child.type = microjson::JsonArrayType;
+            break;
+        case 't':
+        case 'f':
+            child.type = microjson::JsonBoolType;
+            break;
+        default:
+            child.type = microjson::JsonNumberType;
+            break;
+        }
+
+        if (!visit(child)) {
+            return false;
+        }
+
+        for (++i; i < end && microjson::skipWhiteSpace(buffer[i]); ++i);
+        if (i < end && buffer[i] == ',') {
+            for (++i; i < end && microjson::skipWhiteSpace(buffer[i]); ++i);
+            continue;
+        }
+        return i < end && buffer[i] == closingByte;
+    }
+    return false;
+}
+
+//Walks JSON pointer segments, property holds offsets of the last found value relative to buffer
+inline bool findValueByPointer(const char *buffer, size_t size, const std::string &pointer, microjson::JsonProperty &property) {
+    size_t begin = 0;
+    size_t end = size;
+    for (; begin < end && microjson::skipWhiteSpace(buffer[begin]); ++begin);
+    for (; end > begin && microjson::skipWhiteSpace(buffer[end - 1]); --end);
+    if (begin == end) {
+        return false;
+    }
+
+    property = microjson::JsonProperty();
+    property.valueBegin = begin;
+    property.valueEnd = end - 1;
+    switch (buffer[begin]) {
+    case '{':
+        property.type = microjson::JsonObjectType;
+        break;
+    case '[':
+        property.type = microjson::JsonArrayType;
+        break;
+    default:
+        return pointer.empty();
+    }
+
+    std::string segment;
+    std::string name;
+    size_t position = 0;
+    while (position < pointer.size()) {
+        if (pointer[position] != '/') {
+            return false;
+        }
+
+        size_t next = pointer.find('/', position + 1);
+        if (next == std::string::npos) {
+            next = pointer.size();
+        }
+        if (!unescapePointerSegment(pointer, position + 1, next, segment)) {
+            return false;
+        }
+        position = next;
+
+        const bool isObject = property.type == microjson::JsonObjectType && buffer[property.valueBegin] == '{';
+        if (!isObject && property.type != microjson::JsonArrayType) {
+            return false;
+        }
+
+        size_t index = 0;
+        if (!isObject && !parsePointerIndex(segment, index)) {
+            return false;
+        }
+
+        bool found = false;
+        size_t current = 0;
+        walkPointerContainer(buffer, property.valueBegin, property.valueEnd + 1, isObject, [&](const microjson::JsonProperty &child) {
+            if (isObject) {
+                const char *childName = buffer + child.nameBegin;
+                if (memchr(childName, '\\', child.nameSize()) != nullptr) {
+                    name.clear();
+                    if (!unescapeString(childName, child.nameSize(), name) || name != segment) {
+                        return true;
+                    }
+                } else if (child.nameSize() != segment.size() || memcmp(childName, segment.data(), segment.size()) != 0) {
+                    return true;
+                }
+            } else if (current++ != index) {
+                return true;
+            }
+            property = child;
+            found = true;
+            return false;
+        });
+
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename Collect>
+microjson::JsonSchemaResult scanJsonSchema(const char *buffer, size_t size, const microjson::JsonSchema &schema, Collect collect) {
+    microjson::JsonSchemaResult result;
+    std::vector<char> found(schema.size(), 0);
+    const microjson::JsonError error = scanJsonCommon<'{', microjson::extractProperty>(buffer, size,
+                                                                                       [&](const microjson::JsonProperty &property) {
+        size_t index = SIZE_MAX;
+        result.error = schema.check(buffer, property, index);
+        if (result.error != microjson::JsonSchemaValid) {
+            result.offset = result.error == microjson::JsonSchemaUnexpectedProperty ? property.nameBegin : property.valueBegin;
+            result.property = index;
+            return false;
+        }
+
+        if (index != SIZE_MAX) {
+            found[index] = 1;
+        }
+        collect(property);
+        return true;
+    });
+
+    if (error != microjson::JsonNoError) {
+        result = microjson::JsonSchemaResult();
+        result.error = microjson::JsonSchemaSyntaxError;
+        return result;
+    }
+
+    if (result.error != microjson::JsonSchemaValid) {
+        return result;
+    }
+
+    for (size_t i = 0; i < found.size(); ++i) {
+        if (!found[i] && schema.required(i)) {
+            result.error = microjson::JsonSchemaMissingProperty;
+            result.offset = size;
+            for (; result.offset > 0 && buffer[result.offset - 1] != '}'; --result.offset);
+            result.offset = result.offset > 0 ? result.offset - 1 : 0;
+            result.property = i;
+            break;
+        }
+    }
+    return result;
+}
+
+template<typename Object>
+void appendProperty(const char* buffer, Object &obj, const microjson::JsonProperty &property){
+    std::string name((buffer + property.nameBegin), property.nameSize());
+    std::string value;
+    if(property.valueSize() > 0) {
+        value = std::string((buffer + property.valueBegin), property.valueSize());
+    }
+    microjsonDebug << "name: " << name << " value: " << value << std::endl;
+    obj[name] = { value, property.type };
+};
+
+template<typename Array>
+void appendValue(const char* buffer, Array &values, const microjson::JsonProperty &property){
+    std::string value = std::string((buffer + property.valueBegin), property.valueSize());
+    microjsonDebug << "value: " << value << std::endl;
+    values.push_back({value, property.type});
+};
+
+}
+}
+
+bool microjson::extractValue(const char *buffer, size_t size, size_t &i, const char expectedEndByte, microjson::JsonProperty &property) {
+    if (size == 0) {
+        i = SIZE_MAX;
+        return false;
+    }
+    detail::lookForValue(buffer, size, i, property);
+    detail::findSeparator(buffer, size, i, expectedEndByte);
+
+    return property.checkValue();
+}
+
+bool microjson::extractProperty(const char *buffer, size_t size, size_t &i, const char expectedEndByte, microjson::JsonProperty &property) {
+    if (size == 0) {
+        i = SIZE_MAX;
+        return false;
+    }
+
+    detail::lookForName(buffer, size, i, property);
+    if(property.nameBegin == SIZE_MAX && property.nameEnd == SIZE_MAX) {
+        microjsonError << "Name not found" << std::endl;
+        return false;
+    }
+
+    microjsonDebug << "Found name: " << std::string(buffer + property.nameBegin, property.nameSize()) << std::endl;
+
+    if(!detail::lookForSeparator(buffer, size, i)) {
+        microjsonError << "Separator not found" << std::endl;
+        return false;
+    }
+
+    detail::lookForValue(buffer, size, i, property);
+    microjsonDebug << "Found value: " << std::string(buffer + property.valueBegin, property.valueSize()) << std::endl;
+    detail::findSeparator(buffer, size, i, expectedEndByte);
+
+    return property.check();
+}
+
+microjson::JsonObject microjson::parseJsonObject(const char *buffer, size_t size) {
+    return detail::parseJsonCommon<JsonObject, '{', extractProperty, detail::appendProperty<JsonObject>>(buffer, size);
+}
+
+microjson::JsonArray microjson::parseJsonArray(const char *buffer, size_t size) {
+    return detail::parseJsonCommon<JsonArray, '[', extractValue, detail::appendValue<JsonArray>>(buffer, size);
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+namespace microjson {
+namespace detail {
+template<typename Config, typename = void>
+struct ConfigValidates : std::false_type {};
+
+template<typename Config>
+struct ConfigValidates<Config, decltype(void(Config::validate))> : std::integral_constant<bool, Config::validate> {};
+}
+}
+
+template<typename Config>
+typename Config::Object microjson::parseJsonObject(const char *buffer, size_t size) {
+    using Object = typename Config::Object;
+    if (detail::ConfigValidates<Config>::value && !isValidJson(buffer, size)) {
+        return Object();
+    }
+    return detail::parseJsonCommon<Object, '{', extractProperty, detail::appendProperty<Object>>(buffer, size);
+}
+
+template<typename Config>
+typename Config::Array microjson::parseJsonArray(const char *buffer, size_t size) {
+    using Array = typename Config::Array;
+    if (detail::ConfigValidates<Config>::value && !isValidJson(buffer, size)) {
+        return Array();
+    }
+    return detail::parseJsonCommon<Array, '[', extractValue, detail::appendValue<Array>>(buffer, size);
+}
+#endif
+
+microjson::JsonError microjson::parseJsonObject(const char *buffer, size_t size, JsonProperty *properties, size_t capacity, size_t &count) {
+    return detail::parseJsonFixedCommon<'{', extractProperty>(buffer, size, properties, capacity, count);
+}
+
+microjson::JsonError microjson::parseJsonArray(const char *buffer, size_t size, JsonProperty *properties, size_t capacity, size_t &count) {
+    return detail::parseJsonFixedCommon<'[', extractValue>(buffer, size, properties, capacity, count);
+}
+
+microjson::JsonProjection::JsonProjection(std::initializer_list<std::string> keys) : m_keys(keys)
+{
+    compile();
+}
+
+microjson::JsonProjection::JsonProjection(const std::vector<std::string> &keys) : m_keys(keys)
+{
+    compile();
+}
+
+void microjson::JsonProjection::compile() {
+    m_lengthMask = 0;
+    memset(m_firstByteMask, 0, sizeof(m_firstByteMask));
+    for (const auto &key : m_keys) {
+        m_lengthMask |= 1ull << (key.size() < 63 ? key.size() : 63);
+        if (!key.empty()) {
+            const unsigned char firstByte = key[0];
+            m_firstByteMask[firstByte >> 6] |= 1ull << (firstByte & 63);
+        }
+    }
+}
+
+//Masks are unions over keys, so a key is added without recompiling the others
+void microjson::JsonProjection::append(const std::string &key) {
+    m_keys.push_back(key);
+    m_lengthMask |= 1ull << (key.size() < 63 ? key.size() : 63);
+    if (!key.empty()) {
+        const unsigned char firstByte = key[0];
+        m_firstByteMask[firstByte >> 6] |= 1ull << (firstByte & 63);
+    }
+}
+
+size_t microjson::JsonProjection::indexOf(const char *name, size_t size) const {
+    if ((m_lengthMask & (1ull << (size < 63 ? size : 63))) == 0) {
+        return SIZE_MAX;
+    }
+
+    if (size > 0) {
+        const unsigned char firstByte = name[0];
+        if ((m_firstByteMask[firstByte >> 6] & (1ull << (firstByte & 63))) == 0) {
+            return SIZE_MAX;
+        }
+    }
+
+    for (size_t index = 0; index < m_keys.size(); ++index) {
+        const std::string &key = m_keys[index];
+        if (key.size() == size && memcmp(key.data(), name, size) == 0) {
+            return index;
+        }
+    }
+    return SIZE_MAX;
+}
+
+microjson::JsonObject microjson::parseJsonObject(const char *buffer, size_t size, const JsonProjection &projection) {
+    JsonObject returnValue;
+    detail::scanProjection(buffer, size, projection, [&returnValue](const char *buffer, size_t, const JsonProperty &property) {
+        detail::appendProperty(buffer, returnValue, property);
+        return true;
+    });
+    return returnValue;
+}
+
+microjson::JsonArray microjson::getMany(const char *buffer, size_t size, const JsonProjection &projection) {
+    JsonArray returnValue(projection.size());
+    detail::scanProjection(buffer, size, projection, [&returnValue](const char *buffer, size_t index, const JsonProperty &property) {
+        JsonValue &value = returnValue[index];
+        value.value.assign(buffer + property.valueBegin, property.valueSize());
+        value.type = property.type;
+        return true;
+    });
+    return returnValue;
+}
+
+bool microjson::parseJsonNumberArray(const char *buffer, size_t size, std::vector<double> &out, size_t tupleSize) {
+    return detail::parseNumberArrayToVector(buffer, size, tupleSize, out);
+}
+
+bool microjson::parseJsonNumberArray(const char *buffer, size_t size, std::vector<int64_t> &out, size_t tupleSize) {
+    return detail::parseNumberArrayToVector(buffer, size, tupleSize, out);
+}
+
+size_t microjson::parseJsonNumberArray(const char *buffer, size_t size, double *out, size_t capacity, size_t tupleSize) {
+    return detail::parseNumberArrayToBuffer(buffer, size, tupleSize, out, capacity);
+}
+
+size_t microjson::parseJsonNumberArray(const char *buffer, size_t size, int64_t *out, size_t capacity, size_t tupleSize) {
+    return detail::parseNumberArrayToBuffer(buffer, size, tupleSize, out, capacity);
+}
+
+bool microjson::jsonToMessagePack(const char *buffer, size_t size, std::vector<uint8_t> &out) {
+    return detail::transcodeJson<detail::MessagePackWriter>(buffer, size, out);
+}
+
+bool microjson::jsonToCbor(const char *buffer, size_t size, std::vector<uint8_t> &out) {
+    return detail::transcodeJson<detail::CborWriter>(buffer, size, out);
+}
+
+bool microjson::messagePackToJson(const uint8_t *buffer, size_t size, std::string &out) {
+    return detail::binaryToJson<detail::messagePackValueToJson>(buffer, size, out);
+}
+
+bool microjson::cborToJson(const uint8_t *buffer, size_t size, std::string &out) {
+    return detail::binaryToJson<detail::cborValueToJson>(buffer, size, out);
+}
+
+microjson::JsonCompactValue::JsonCompactValue(const char *buffer, const JsonProperty &property) : m_tag(InvalidTag)
+{
+    const uint32_t offset = uint32_t(property.valueBegin);
+    const uint32_t size = uint32_t(property.valueSize());
+    switch (property.type) {
+    case JsonNumberType:
+        //Range is 32-bit offset and 24-bit size, cached value takes the remaining 8 bytes
+        memcpy(m_data, &offset, sizeof(offset));
+        if (size > MaxCachedNumberSize) {
+            memcpy(m_data + sizeof(offset), &size, sizeof(size));
+            m_tag = NumberTag | (LongNumberText << 4);
+            return;
+        }
+        m_data[4] = char(size);
+        m_data[5] = char(size >> 8);
+        m_data[6] = char(size >> 16);
+        m_tag = NumberTag;
+        return;
+    case JsonStringType:
+        if (size <= InlineCapacity) {
+            memcpy(m_data, buffer + offset, size);
+            m_tag = InlineStringTag | (size << 4);
+            return;
+        }
+        m_tag = StringTag;
+        break;
+    case JsonBoolType:
+        m_tag = buffer[offset] == 't' ? TrueTag : FalseTag;
+        return;
+    case JsonObjectType:
+        if (buffer[offset] == 'n') {
+            m_tag = NullTag;
+            return;
+        }
+        m_tag = ObjectTag;
+        break;
+    case JsonArrayType:
+        m_tag = ArrayTag;
+        break;
+    default:
+        return;
+    }
+
+    memcpy(m_data, &offset, sizeof(offset));
+    memcpy(m_data + sizeof(offset), &size, sizeof(size));
+}
+
+void microjson::JsonCompactRef::range(uint32_t &offset, uint32_t &size) const {
+    memcpy(&offset, m_value.m_data, sizeof(offset));
+    if (m_value.tag() == JsonCompactValue::NumberTag && m_value.numberCache() != JsonCompactValue::LongNumberText) {
+        const unsigned char *packed = reinterpret_cast<const unsigned char *>(m_value.m_data + sizeof(offset));
+        size = uint32_t(packed[0]) | (uint32_t(packed[1]) << 8) | (uint32_t(packed[2]) << 16);
+        return;
+    }
+    memcpy(&size, m_value.m_data + sizeof(offset), sizeof(size));
+}
+
+microjson::JsonType microjson::JsonCompactRef::type() const {
+    switch (m_value.tag()) {
+    case JsonCompactValue::NullTag:
+    case JsonCompactValue::ObjectTag:
+        return JsonObjectType;
+    case JsonCompactValue::FalseTag:
+    case JsonCompactValue::TrueTag:
+        return JsonBoolType;
+    case JsonCompactValue::NumberTag:
+        return JsonNumberType;
+    case JsonCompactValue::InlineStringTag:
+    case JsonCompactValue::StringTag:
+        return JsonStringType;
+    case JsonCompactValue::ArrayTag:
+        return JsonArrayType;
+    default:
+        break;
+    }
+    return JsonInvalidType;
+}
+
+bool microjson::JsonCompactRef::isNull() const {
+    return m_value.tag() == JsonCompactValue::NullTag;
+}
+
+bool microjson::JsonCompactRef::toBool() const {
+    return m_value.tag() == JsonCompactValue::TrueTag;
+}
+
+int64_t microjson::JsonCompactRef::toInt() const {
+    if (m_value.tag() != JsonCompactValue::NumberTag) {
+        return 0;
+    }
+
+    switch (m_value.numberCache()) {
+    case JsonCompactValue::IntegerCache: {
+        int64_t integer;
+        memcpy(&integer, m_value.m_data + JsonCompactValue::NumberCacheOffset, sizeof(integer));
+        return integer;
+    }
+    case JsonCompactValue::DoubleCache:
+        break;
+    default: {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        range(offset, size);
+        const char *end = m_buffer + offset + size;
+        const char *p = m_buffer + offset;
+        int64_t integer = 0;
+        if (detail::parseNumber(p, end, integer) && p == end) {
+            if (m_cache != nullptr && m_value.numberCache() == JsonCompactValue::NoNumberCache) {
+                memcpy(m_cache->m_data + JsonCompactValue::NumberCacheOffset, &integer, sizeof(integer));
+                m_cache->m_tag = JsonCompactValue::NumberTag | (JsonCompactValue::IntegerCache << 4);
+            }
+            return integer;
+        }
+        break;
+    }
+    }
+
+    const double number = toDouble();
+    if (number != number) {
+        return 0;
+    }
+    if (number >= 9223372036854775808.0) {
+        return INT64_MAX;
+    }
+    if (number < -9223372036854775808.0) {
+        return INT64_MIN;
+    }
+    return static_cast<int64_t>(number);
+}
+
+double microjson::JsonCompactRef::toDouble() const {
+    if (m_value.tag() != JsonCompactValue::NumberTag) {
+        return 0;
+    }
+
+    switch (m_value.numberCache()) {
+    case JsonCompactValue::DoubleCache: {
+        double number;
+        memcpy(&number, m_value.m_data + JsonCompactValue::NumberCacheOffset, sizeof(number));
+        return number;
+    }
+    case JsonCompactValue::IntegerCache: {
+        int64_t integer;
+        memcpy(&integer, m_value.m_data + JsonCompactValue::NumberCacheOffset, sizeof(integer));
+        return static_cast<double>(integer);
+    }
+    default:
+        break;
+    }
+
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    range(offset, size);
+    const char *p = m_buffer + offset;
+    double number = 0;
+    if (!detail::parseNumber(p, m_buffer + offset + size, number)) {
+        number = 0;
+    }
+    if (m_cache != nullptr && m_value.numberCache() == JsonCompactValue::NoNumberCache) {
+        memcpy(m_cache->m_data + JsonCompactValue::NumberCacheOffset, &number, sizeof(number));
+        m_cache->m_tag = JsonCompactValue::NumberTag | (JsonCompactValue::DoubleCache << 4);
+    }
+    return number;
+}
+
+std::string microjson::JsonCompactRef::toString() const {
+    switch (m_value.tag()) {
+    case JsonCompactValue::NullTag:
+        return "null";
+    case JsonCompactValue::FalseTag:
+        return "false";
+    case JsonCompactValue::TrueTag:
+        return "true";
+    case JsonCompactValue::InlineStringTag:
+        return std::string(m_value.m_data, m_value.inlineSize());
+    case JsonCompactValue::NumberTag:
+    case JsonCompactValue::StringTag:
+    case JsonCompactValue::ObjectTag:
+    case JsonCompactValue::ArrayTag: {
+        uint32_t offset = 0;
+        uint32_t size = 0;
+        range(offset, size);
+        return std::string(m_buffer + offset, size);
+    }
+    default:
+        break;
+    }
+    return std::string();
+}
+
+microjson::JsonCompactArray microjson::parseJsonCompactArray(const char *buffer, size_t size) {
+    JsonCompactArray returnValue;
+    if (size > UINT32_MAX) {
+        return returnValue;
+    }
+
+    returnValue.m_buffer = buffer;
+    std::vector<JsonCompactValue> &values = returnValue.m_values;
+    const JsonError error = detail::scanJsonCommon<'[', extractValue>(buffer, size, [buffer, &values](const JsonProperty &property) {
+        values.push_back(JsonCompactValue(buffer, property));
+        return true;
+    });
+
+    if (error != JsonNoError) {
+        values.clear();
+    }
+    return returnValue;
+}
+
+bool microjson::findJsonValue(const char *buffer, size_t size, const std::string &pointer, JsonProperty &property) {
+    if (buffer == nullptr || size == 0 || size == SIZE_MAX) {
+        return false;
+    }
+    return detail::findValueByPointer(buffer, size, pointer, property);
+}
+
+std::string microjson::escapeJsonString(const char *buffer, size_t size) {
+    std::string returnValue;
+    returnValue.reserve(size + 2);
+    detail::appendJsonString(returnValue, buffer, size);
+    return returnValue;
+}
+
+bool microjson::unescapeJsonString(const char *buffer, size_t size, std::string &out) {
+    const size_t originalSize = out.size();
+    if (!detail::unescapeString(buffer, size, out)) {
+        out.resize(originalSize);
+        return false;
+    }
+    return true;
+}
+
+bool microjson::parseJsonNumber(const char *buffer, size_t size, int64_t &value) {
+    const char *p = buffer;
+    return detail::parseNumber(p, buffer + size, value) && p == buffer + size;
+}
+
+bool microjson::parseJsonNumber(const char *buffer, size_t size, double &value) {
+    const char *p = buffer;
+    return detail::parseNumber(p, buffer + size, value) && p == buffer + size;
+}
+
+microjson::JsonSchema::JsonSchema() : m_projection(std::vector<std::string>())
+  , m_additionalProperties(true)
+{
+}
+
+microjson::JsonSchema &microjson::JsonSchema::property(const std::string &name, JsonType type, bool required) {
+    m_rules.push_back(Rule{type, required, false, false, 0, 0, 0, SIZE_MAX, std::vector<std::string>()});
+    m_projection.append(name);
+    return *this;
+}
+
+microjson::JsonSchema &microjson::JsonSchema::range(double min, double max) {
+    if (!m_rules.empty()) {
+        m_rules.back().hasRange = true;
+        m_rules.back().min = min;
+        m_rules.back().max = max;
+    }
+    return *this;
+}
+
+microjson::JsonSchema &microjson::JsonSchema::length(size_t min, size_t max) {
+    if (!m_rules.empty()) {
+        m_rules.back().minLength = min;
+        m_rules.back().maxLength = max;
+    }
+    return *this;
+}
+
+microjson::JsonSchema &microjson::JsonSchema::oneOf(std::initializer_list<std::string> values) {
+    if (!m_rules.empty()) {
+        m_rules.back().values = values;
+    }
+    return *this;
+}
+
+microjson::JsonSchema &microjson::JsonSchema::nullable() {
+    if (!m_rules.empty()) {
+        m_rules.back().nullable = true;
+    }
+    return *this;
+}
+
+microjson::JsonSchemaError microjson::JsonSchema::check(const char *buffer, const JsonProperty &property, size_t &index) const {
+    index = m_projection.indexOf(buffer + property.nameBegin, property.nameSize());
+    if (index == SIZE_MAX) {
+        return m_additionalProperties ? JsonSchemaValid : JsonSchemaUnexpectedProperty;
+    }
+
+    const Rule &rule = m_rules[index];
+    const char *value = buffer + property.valueBegin;
+    size_t valueSize = property.valueSize();
+    if (property.type == JsonObjectType && value[0] == 'n') {
+        return rule.nullable || rule.type == JsonInvalidType ? JsonSchemaValid : JsonSchemaTypeMismatch;
+    }
+
+    if (rule.type != JsonInvalidType && rule.type != property.type) {
+        return JsonSchemaTypeMismatch;
+    }
+
+    if (rule.hasRange && property.type == JsonNumberType) {
+        const char *p = value;
+        double number = 0;
+        if (!detail::parseNumber(p, value + valueSize, number) || p != value + valueSize) {
+            return JsonSchemaTypeMismatch;
+        }
+        if (number < rule.min || number > rule.max) {
+            return JsonSchemaOutOfRange;
+        }
+    }
+
+    //Escaped strings are compared by their unescaped text
+    const bool checksString = property.type == JsonStringType && (rule.minLength > 0 || rule.maxLength != SIZE_MAX || !rule.values.empty());
+    std::string unescaped;
+    if (checksString && memchr(value, '\\', valueSize) != nullptr) {
+        if (!detail::unescapeString(value, valueSize, unescaped)) {
+            return JsonSchemaTypeMismatch;
+        }
+        value = unescaped.data();
+        valueSize = unescaped.size();
+    }
+
+    if (property.type == JsonStringType && (valueSize < rule.minLength || valueSize > rule.maxLength)) {
+        return JsonSchemaLengthMismatch;
+    }
+
+    if (!rule.values.empty()) {
+        bool matches = false;
+        for (const auto &expected : rule.values) {
+            if (expected.size() == valueSize && memcmp(expected.data(), value, valueSize) == 0) {
+                matches = true;
+                break;
+            }
+        }
+        if (!matches) {
+            return JsonSchemaNotInEnum;
+        }
+    }
+    return JsonSchemaValid;
+}
+
+microjson::JsonObject microjson::parseJsonObject(const char *buffer, size_t size, const JsonSchema &schema, JsonSchemaResult &result) {
+    JsonObject returnValue;
+    result = detail::scanJsonSchema(buffer, size, schema, [buffer, &returnValue](const JsonProperty &property) {
+        detail::appendProperty(buffer, returnValue, property);
+    });
+
+    if (!result.valid()) {
+        returnValue.clear();
+    }
+    return returnValue;
+}
+
+microjson::JsonSchemaResult microjson::validateJsonObject(const char *buffer, size_t size, const JsonSchema &schema) {
+    return detail::scanJsonSchema(buffer, size, schema, [](const JsonProperty &) {});
+}
+
+namespace microjson {
+namespace detail {
+//Clock is read once per block of input, so deadline costs nothing per byte
+class DeadlineCheck {
+public:
+    explicit DeadlineCheck(std::chrono::steady_clock::time_point deadline) : m_deadline(deadline)
+      , m_nextCheck(deadline == std::chrono::steady_clock::time_point::max() ? SIZE_MAX : 0) {}
+
+    bool expired(size_t position) {
+        if (position < m_nextCheck) {
+            return false;
+        }
+        m_nextCheck = position + CheckInterval;
+        return std::chrono::steady_clock::now() > m_deadline;
+    }
+
+private:
+    static const size_t CheckInterval = 64 * 1024;
+
+    std::chrono::steady_clock::time_point m_deadline;
+    size_t m_nextCheck;
+};
+}
+}
+
+microjson::JsonError microjson::checkJsonLimits(const char *buffer, size_t size, const JsonLimits &limits) {
+    if (buffer == nullptr || size == 0 || size == SIZE_MAX) {
+        return JsonSyntaxError;
+    }
+
+    if (size > limits.maxSize) {
+        return JsonSizeLimitError;
+    }
+
+    detail::DeadlineCheck deadline(limits.deadline);
+    const size_t maxDepth = limits.maxDepth < MaxValidationDepth ? limits.maxDepth : MaxValidationDepth;
+    uint32_t members[MaxValidationDepth];//Members of every open level, saturated
+    size_t depth = 0;
+    bool memberExpected = false;//Next value byte begins a member of the innermost level
+    for (size_t i = 0; i < size; ++i) {
+        if (deadline.expired(i)) {
+            return JsonDeadlineError;
+        }
+
+        const char byte = buffer[i];
+        if (memberExpected && !skipWhiteSpace(byte)) {
+            memberExpected = false;
+            if (byte != '}' && byte != ']') {
+                if (members[depth - 1] < UINT32_MAX) {
+                    ++members[depth - 1];
+                }
+                if (members[depth - 1] > limits.maxMembers) {
+                    return JsonMembersLimitError;
+                }
+            }
+        }
+
+        switch (byte) {
+        case '"': {
+            const size_t begin = i;
+            //Closing quote is not searched past the limit
+            const size_t limitedSize = limits.maxStringSize < size - begin - 1 ? begin + limits.maxStringSize + 2 : size;
+            if (!detail::skipString(buffer, limitedSize, i)) {
+                return limitedSize < size ? JsonStringLimitError : JsonSyntaxError;
+            }
+        }
+            break;
+        case '{':
+        case '[':
+            if (depth >= maxDepth) {
+                return JsonDepthLimitError;
+            }
+            members[depth++] = 0;
+            memberExpected = true;
+            break;
+        case '}':
+        case ']':
+            if (depth == 0) {
+                return JsonSyntaxError;
+            }
+            --depth;
+            break;
+        case ',':
+            memberExpected = depth > 0;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return depth == 0 ? JsonNoError : JsonSyntaxError;
+}
+
+microjson::JsonObject microjson::parseJsonObject(const char *buffer, size_t size, const JsonLimits &limits, JsonError &error) {
+    JsonObject returnValue;
+    error = checkJsonLimits(buffer, size, limits);
+    if (error != JsonNoError) {
+        return returnValue;
+    }
+
+    detail::DeadlineCheck deadline(limits.deadline);
+    bool expired = false;
+    error = detail::scanJsonCommon<'{', extractProperty>(buffer, size, [buffer, &returnValue, &deadline, &expired](const JsonProperty &property) {
+        if (deadline.expired(property.valueEnd)) {
+            expired = true;
+            return false;
+        }
+        detail::appendProperty(buffer, returnValue, property);
+        return true;
+    });
+
+    if (expired) {
+        error = JsonDeadlineError;
+    }
+    if (error != JsonNoError) {
+        returnValue.clear();
+    }
+    return returnValue;
+}
+
+microjson::JsonArray microjson::parseJsonArray(const char *buffer, size_t size, const JsonLimits &limits, JsonError &error) {
+    JsonArray returnValue;
+    error = checkJsonLimits(buffer, size, limits);
+    if (error != JsonNoError) {
+        return returnValue;
+    }
+
+    detail::DeadlineCheck deadline(limits.deadline);
+    bool expired = false;
+    error = detail::scanJsonCommon<'[', extractValue>(buffer, size, [buffer, &returnValue, &deadline, &expired](const JsonProperty &property) {
+        if (deadline.expired(property.valueEnd)) {
+            expired = true;
+            return false;
+        }
+        detail::appendValue(buffer, returnValue, property);
+        return true;
+    });
+
+    if (expired) {
+        error = JsonDeadlineError;
+    }
+    if (error != JsonNoError) {
+        returnValue.clear();
+    }
+    return returnValue;
+}
+
+namespace microjson {
+namespace detail {
+//Key hash of frozen objects, cheaper than hashBuffer since keys are short
+inline uint64_t hashKey(const char *name, size_t size) {
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ size;
+    uint64_t tail = 0;
+    if (size >= 8) {
+        for (size_t i = 0; i + 8 < size; i += 8) {
+            uint64_t word;
+            memcpy(&word, name + i, sizeof(word));
+            hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+            hash ^= hash >> 32;
+        }
+        //Last word overlaps previous one, fixed size loads avoid memcpy calls
+        memcpy(&tail, name + size - 8, sizeof(tail));
+    } else if (size >= 4) {
+        uint32_t low;
+        uint32_t high;
+        memcpy(&low, name, sizeof(low));
+        memcpy(&high, name + size - 4, sizeof(high));
+        tail = low | (static_cast<uint64_t>(high) << 32);
+    } else if (size > 0) {
+        tail = static_cast<uint8_t>(name[0]) | (static_cast<uint64_t>(static_cast<uint8_t>(name[size / 2])) << 8)
+               | (static_cast<uint64_t>(static_cast<uint8_t>(name[size - 1])) << 16);
+    }
+    hash = (hash ^ tail) * 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 29;
+    hash *= 0x9fb21c651e98df25ull;
+    return hash ^ (hash >> 32);
+}
+
+//Maps value to [0, range) with multiplication instead of division
+inline size_t reduce(uint32_t value, size_t range) {
+    return static_cast<size_t>((static_cast<uint64_t>(value) * range) >> 32);
+}
+
+inline size_t frozenBucket(uint64_t hash, size_t bucketCount) {
+    return reduce(static_cast<uint32_t>(hash >> 32), bucketCount);
+}
+
+inline size_t frozenSlot(uint64_t hash, uint32_t displacement, size_t slotCount) {
+    const uint32_t step = static_cast<uint32_t>(hash >> 16) | 1;
+    return reduce(static_cast<uint32_t>(hash) + displacement * step, slotCount);
+}
+}
+}
+
+microjson::JsonFrozenObject::JsonFrozenObject(const JsonObject &object) : m_size(object.size())
+{
+    if (object.empty()) {
+        return;
+    }
+
+    std::vector<const JsonObject::value_type *> properties;
+    std::vector<uint64_t> hashes;
+    properties.reserve(object.size());
+    hashes.reserve(object.size());
+    size_t keysSize = 0;
+    for (const auto &property : object) {
+        properties.push_back(&property);
+        hashes.push_back(detail::hashKey(property.first.data(), property.first.size()));
+        keysSize += property.first.size();
+    }
+
+    if (keysSize >= UINT32_MAX) {
+        microjsonError << "Keys of frozen object exceed 4 GiB" << std::endl;
+        m_size = 0;
+        return;
+    }
+    m_keys.reserve(keysSize);
+
+    //Only first key of every hash is placed into the table
+    std::vector<uint64_t> unique(hashes);
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+    //Slots are added when buckets can't be placed into a minimal table. Hashes that map to the
+    //same slot for every displacement can't be placed at any size, after a few attempts buckets
+    //that don't fit are left to the collision list
+    const int MaxBuildAttempts = 8;
+    size_t slotCount = unique.size();
+    for (int attempt = 1; !build(unique, slotCount, attempt == MaxBuildAttempts); ++attempt) {
+        slotCount += slotCount / 8 + 1;
+    }
+
+    for (size_t i = 0; i < properties.size(); ++i) {
+        const uint64_t hash = hashes[i];
+        const uint32_t displacement = m_displacements[detail::frozenBucket(hash, m_displacements.size())];
+        Entry &entry = m_entries[detail::frozenSlot(hash, displacement, m_entries.size())];
+        if (entry.keySize == UINT32_MAX) {
+            assign(entry, properties[i]->first, properties[i]->second, hash);
+        } else {
+            m_collisions.push_back(Entry());
+            assign(m_collisions.back(), properties[i]->first, properties[i]->second, hash);
+        }
+    }
+}
+
+void microjson::JsonFrozenObject::assign(Entry &entry, const std::string &name, const JsonValue &value, uint64_t hash) {
+    entry.hash = hash;
+    entry.keyOffset = static_cast<uint32_t>(m_keys.size());
+    entry.keySize = static_cast<uint32_t>(name.size());
+    entry.value = value;
+    m_keys += name;
+}
+
+//Hash and displace: buckets are placed largest first, each bucket searches a displacement
+//that moves all its keys to free slots. With spill buckets that don't fit keep displacement 0,
+//their keys take a free slot if there is one or go to the collision list.
+bool microjson::JsonFrozenObject::build(const std::vector<uint64_t> &hashes, size_t slotCount, bool spill) {
+    const uint32_t MaxDisplacement = 1 << 16;
+    const size_t bucketCount = (hashes.size() + 1) / 2;
+    std::vector<std::vector<uint64_t>> buckets(bucketCount);
+    for (uint64_t hash : hashes) {
+        buckets[detail::frozenBucket(hash, bucketCount)].push_back(hash);
+    }
+    std::vector<size_t> order(bucketCount);
+    for (size_t i = 0; i < bucketCount; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&buckets](size_t a, size_t b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<char> occupied(slotCount, 0);
+    std::vector<size_t> slots;
+    m_displacements.assign(bucketCount, 0);
+    for (size_t bucketIndex : order) {
+        const std::vector<uint64_t> &bucket = buckets[bucketIndex];
+        if (bucket.empty()) {
+            break;
+        }
+
+        uint32_t displacement = 0;
+        for (; displacement < MaxDisplacement; ++displacement) {
+            slots.clear();
+            for (uint64_t hash : bucket) {
+                const size_t slot = detail::frozenSlot(hash, displacement, slotCount);
+                if (occupied[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (slots.size() == bucket.size()) {
+                break;
+            }
+        }
+
+        if (displacement == MaxDisplacement) {
+            if (!spill) {
+                return false;
+            }
+            continue;
+        }
+
+        m_displacements[bucketIndex] = displacement;
+        for (size_t slot : slots) {
+            occupied[slot] = 1;
+        }
+    }
+
+    m_entries.assign(slotCount, Entry());
+    return true;
+}
+
+const microjson::JsonValue *microjson::JsonFrozenObject::find(const char *name, size_t size) const {
+    if (m_entries.empty()) {
+        return nullptr;
+    }
+
+    const uint64_t hash = detail::hashKey(name, size);
+    const uint32_t displacement = m_displacements[detail::frozenBucket(hash, m_displacements.size())];
+    const Entry &entry = m_entries[detail::frozenSlot(hash, displacement, m_entries.size())];
+    if (entry.hash == hash && entry.keySize == size && memcmp(m_keys.data() + entry.keyOffset, name, size) == 0) {
+        return &entry.value;
+    }
+    return m_collisions.empty() ? nullptr : findCollision(name, size, hash);
+}
+
+const microjson::JsonValue *microjson::JsonFrozenObject::findCollision(const char *name, size_t size, uint64_t hash) const {
+    for (const auto &entry : m_collisions) {
+        if (entry.hash == hash && entry.keySize == size && memcmp(m_keys.data() + entry.keyOffset, name, size) == 0) {
+            return &entry.value;
+        }
+    }
+    return nullptr;
+}
+
+microjson::JsonFrozenObject microjson::freeze(const JsonObject &object) {
+    return JsonFrozenObject(object);
+}
+
+namespace microjson {
+namespace detail {
+inline bool isContinuation(const char *p) {
+    return (static_cast<unsigned char>(*p) & 0xc0) == 0x80;
+}
+
+//Validates UTF-8 sequence that begins at i, moves i to its last byte
+inline bool validateUtf8(const char *buffer, size_t size, size_t &i) {
+    const unsigned char lead = static_cast<unsigned char>(buffer[i]);
+    size_t length = 0;
+    unsigned char min = 0x80;
+    unsigned char max = 0xbf;
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 1;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 2;
+        min = lead == 0xe0 ? 0xa0 : 0x80;
+        max = lead == 0xed ? 0x9f : 0xbf;//Surrogates
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 3;
+        min = lead == 0xf0 ? 0x90 : 0x80;
+        max = lead == 0xf4 ? 0x8f : 0xbf;
+    } else {
+        return false;
+    }
+
+    if (size - i <= length) {
+        i = size;
+        return false;
+    }
+
+    const unsigned char second = static_cast<unsigned char>(buffer[i + 1]);
+    if (second < min || second > max) {
+        ++i;
+        return false;
+    }
+
+    for (size_t k = 2; k <= length; ++k) {
+        if (!isContinuation(buffer + i + k)) {
+            i += k;
+            return false;
+        }
+    }
+    i += length;
+    return true;
+}
+
+inline bool isHexDigit(const char byte) {
+    return isDigit(byte) || (byte >= 'a' && byte <= 'f') || (byte >= 'A' && byte <= 'F');
+}
+
+//Moves i past the closing quote of the string that begins at i, on error i is the invalid byte
+inline bool validateString(const char *buffer, size_t size, size_t &i) {
+    ++i;
+    while (true) {
+        skipWords<stringSpecialBytes>(buffer, size, i);
+
+        if (i >= size) {
+            return false;
+        }
+
+        const unsigned char byte = static_cast<unsigned char>(buffer[i]);
+        if (byte == '"') {
+            ++i;
+            return true;
+        }
+
+        if (byte == '\\') {
+            if (++i >= size) {
+                return false;
+            }
+            switch (buffer[i]) {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                break;
+            case 'u':
+                for (size_t k = 0; k < 4; ++k) {
+                    if (++i >= size || !isHexDigit(buffer[i])) {
+                        return false;
+                    }
+                }
+                break;
+            default:
+                return false;
+            }
+        } else if (byte < 0x20) {
+            return false;
+        } else if (byte >= 0x80 && !validateUtf8(buffer, size, i)) {
+            return false;
+        }
+        ++i;
+    }
+}
+
+//Strict number grammar: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+inline bool validateNumber(const char *buffer, size_t size, size_t &i) {
+    if (buffer[i] == '-') {
+        ++i;
+    }
+
+    if (i >= size || !isDigit(buffer[i])) {
+        return false;
+    }
+
+    if (buffer[i] == '0') {
+        ++i;
+    } else {
+        for (; i < size && isDigit(buffer[i]); ++i);
+    }
+
+    if (i < size && buffer[i] == '.') {
+        if (++i >= size || !isDigit(buffer[i])) {
+            return false;
+        }
+        for (; i < size && isDigit(buffer[i]); ++i);
+    }
+
+    if (i < size && (buffer[i] == 'e' || buffer[i] == 'E')) {
+        if (++i < size && (buffer[i] == '+' || buffer[i] == '-')) {
+            ++i;
+        }
+        if (i >= size || !isDigit(buffer[i])) {
+            return false;
+        }
+        for (; i < size && isDigit(buffer[i]); ++i);
+    }
+    return true;
+}
+
+inline bool validateLiteral(const char *buffer, size_t size, size_t &i, const char *literal, size_t length) {
+    for (size_t k = 0; k < length; ++k, ++i) {
+        if (i >= size || buffer[i] != literal[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+}
+
+microjson::JsonValidationResult microjson::validateJson(const char *buffer, size_t size) {
+    JsonValidationResult result;
+    result.error = JsonSyntaxError;
+    if (buffer == nullptr || size == SIZE_MAX) {
+        result.offset = 0;
+        return result;
+    }
+
+    uint64_t scopes[MaxValidationDepth / 64];//Bit per level, set for objects
+    size_t depth = 0;
+    size_t i = 0;
+    bool expectValue = true;
+    while (true) {
+        detail::skipWhiteSpaces(buffer, size, i);
+        if (expectValue) {
+            if (i >= size) {
+                break;
+            }
+
+            bool valid = true;
+            switch (buffer[i]) {
+            case '{':
+            case '[': {
+                if (depth == MaxValidationDepth) {
+                    result.error = JsonDepthLimitError;
+                    result.offset = i;
+                    return result;
+                }
+
+                const bool object = buffer[i] == '{';
+                const uint64_t bit = 1ull << (depth % 64);
+                scopes[depth / 64] = object ? (scopes[depth / 64] | bit) : (scopes[depth / 64] & ~bit);
+                ++depth;
+                ++i;
+                detail::skipWhiteSpaces(buffer, size, i);
+                if (i < size && buffer[i] == (object ? '}' : ']')) {
+                    --depth;
+                    ++i;
+                    expectValue = false;
+                    continue;
+                }
+
+                if (object) {
+                    if (i >= size || buffer[i] != '"' || !detail::validateString(buffer, size, i)) {
+                        valid = false;
+                        break;
+                    }
+                    detail::skipWhiteSpaces(buffer, size, i);
+                    if (i >= size || buffer[i] != ':') {
+                        valid = false;
+                        break;
+                    }
+                    ++i;
+                }
+                continue;
+            }
+            case '"':
+                valid = detail::validateString(buffer, size, i);
+                break;
+            case 't':
+                valid = detail::validateLiteral(buffer, size, i, "true", 4);
+                break;
+            case 'f':
+                valid = detail::validateLiteral(buffer, size, i, "false", 5);
+                break;
+            case 'n':
+                valid = detail::validateLiteral(buffer, size, i, "null", 4);
+                break;
+            default:
+                valid = detail::validateNumber(buffer, size, i);
+                break;
+            }
+
+            if (!valid) {
+                break;
+            }
+            expectValue = false;
+            continue;
+        }
+
+        if (depth == 0) {
+            if (i == size) {
+                result.error = JsonNoError;
+                result.offset = SIZE_MAX;
+                return result;
+            }
+            break;
+        }
+
+        if (i >= size) {
+            break;
+        }
+
+        const bool object = (scopes[(depth - 1) / 64] >> ((depth - 1) % 64)) & 1;
+        if (buffer[i] == (object ? '}' : ']')) {
+            --depth;
+            ++i;
+            continue;
+        }
+
+        if (buffer[i] != ',') {
+            break;
+        }
+        ++i;
+        expectValue = true;
+
+        if (object) {
+            detail::skipWhiteSpaces(buffer, size, i);
+            if (i >= size || buffer[i] != '"' || !detail::validateString(buffer, size, i)) {
+                break;
+            }
+            detail::skipWhiteSpaces(buffer, size, i);
+            if (i >= size || buffer[i] != ':') {
+                break;
+            }
+            ++i;
+        }
+    }
+
+    result.offset = i < size ? i : size;
+    return result;
+}
+
+bool microjson::isValidJson(const char *buffer, size_t size) {
+    return validateJson(buffer, size).valid();
+}
+
+namespace microjson {
+namespace detail {
+//Counts full size of the output and writes what fits into capacity
+class FormatWriter {
+public:
+    FormatWriter(char *out, size_t capacity) : m_out(out)
+      , m_capacity(capacity)
+      , m_size(0) {}
+
+    void write(const char *data, size_t size) {
+        if (m_size < m_capacity) {
+            memmove(m_out + m_size, data, std::min(size, m_capacity - m_size));
+        }
+        m_size += size;
+    }
+
+    void write(uint64_t word) {
+        if (m_size + sizeof(word) <= m_capacity) {
+            memcpy(m_out + m_size, &word, sizeof(word));
+            m_size += sizeof(word);
+        } else {
+            write(reinterpret_cast<const char *>(&word), sizeof(word));
+        }
+    }
+
+    void put(char byte) {
+        if (m_size < m_capacity) {
+            m_out[m_size] = byte;
+        }
+        ++m_size;
+    }
+
+    void newLine(size_t spaces) {
+        put('\n');
+        for (; spaces > 0; --spaces) {
+            put(' ');
+        }
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+private:
+    char *m_out;
+    size_t m_capacity;
+    size_t m_size;
+};
+
+//Copies string that begins at i including quotes, returns false if it is not terminated
+inline bool copyString(const char *buffer, size_t size, size_t &i, FormatWriter &writer) {
+    const size_t begin = i++;
+    while (true) {
+        skipWords<quoteOrBackslashBytes>(buffer, size, i);
+        for (; i < size && buffer[i] != '"' && buffer[i] != '\\'; ++i);
+
+        if (i >= size) {
+            return false;
+        }
+        if (buffer[i] == '"') {
+            writer.write(buffer + begin, ++i - begin);
+            return true;
+        }
+        i += 2;//Escaped byte
+    }
+}
+}
+}
+
+//Words are stored only after they are loaded, so output may overwrite the input
+size_t microjson::minifyJson(const char *buffer, size_t size, char *out, size_t capacity) {
+    detail::FormatWriter writer(out, capacity);
+    size_t i = 0;
+    while (i < size) {
+        if (i + 8 <= size) {
+            uint64_t word;
+            memcpy(&word, buffer + i, sizeof(word));
+            if ((detail::quoteOrSpaceBytes(word) & detail::HighBits) == 0) {
+                writer.write(word);
+                i += 8;
+                continue;
+            }
+
+            //Bytes up to the first string are compacted one by one
+            for (const size_t end = i + 8; i < end && buffer[i] != '"'; ++i) {
+                if (!isJsonWhiteSpace(buffer[i])) {
+                    writer.put(buffer[i]);
+                }
+            }
+        }
+
+        if (i >= size) {
+            break;
+        }
+        if (buffer[i] == '"') {
+            if (!detail::copyString(buffer, size, i, writer)) {
+                return SIZE_MAX;
+            }
+        } else {
+            if (!isJsonWhiteSpace(buffer[i])) {
+                writer.put(buffer[i]);
+            }
+            ++i;
+        }
+    }
+    return writer.size();
+}
+
+//Empty objects and arrays are kept on one line
+size_t microjson::prettifyJson(const char *buffer, size_t size, char *out, size_t capacity, size_t indent) {
+    detail::FormatWriter writer(out, capacity);
+    size_t depth = 0;
+    size_t i = 0;
+    while (i < size) {
+        const char byte = buffer[i];
+        switch (byte) {
+        case '{':
+        case '[': {
+            writer.put(byte);
+            size_t next = i + 1;
+            for (; next < size && isJsonWhiteSpace(buffer[next]); ++next);
+            if (next < size && (buffer[next] == '}' || buffer[next] == ']')) {
+                writer.put(buffer[next]);
+                i = next + 1;
+                continue;
+            }
+            writer.newLine(++depth * indent);
+            ++i;
+        }
+            break;
+        case '}':
+        case ']':
+            depth = depth > 0 ? depth - 1 : 0;
+            writer.newLine(depth * indent);
+            writer.put(byte);
+            ++i;
+            break;
+        case ',':
+            writer.put(',');
+            writer.newLine(depth * indent);
+            ++i;
+            break;
+        case ':':
+            writer.write(": ", 2);
+            ++i;
+            break;
+        case '"':
+            if (!detail::copyString(buffer, size, i, writer)) {
+                return SIZE_MAX;
+            }
+            break;
+        default: {
+            if (isJsonWhiteSpace(byte)) {
+                ++i;
+                break;
+            }
+            const size_t begin = i;
+            for (; i < size && !isJsonWhiteSpace(buffer[i]) && buffer[i] != ',' && buffer[i] != '}' && buffer[i] != ']' && buffer[i] != ':'; ++i);
+            writer.write(buffer + begin, i - begin);
+        }
+            break;
+        }
+    }
+    return writer.size();
+}
+
+bool microjson::minifyJson(const char *buffer, size_t size, std::string &out) {
+    out.resize(size);
+    const size_t resultSize = minifyJson(buffer, size, &out[0], size);
+    out.resize(resultSize != SIZE_MAX ? resultSize : 0);
+    return resultSize != SIZE_MAX;
+}
+
+bool microjson::prettifyJson(const char *buffer, size_t size, std::string &out, size_t indent) {
+    out.resize(size + size / 2);
+    size_t resultSize = prettifyJson(buffer, size, &out[0], out.size(), indent);
+    if (resultSize != SIZE_MAX && resultSize > out.size()) {
+        out.resize(resultSize);
+        resultSize = prettifyJson(buffer, size, &out[0], out.size(), indent);
+    }
+    out.resize(resultSize != SIZE_MAX ? resultSize : 0);
+    return resultSize != SIZE_MAX;
 }
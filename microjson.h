@@ -23,14 +23,24 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#pragma once
+
 #include <stddef.h>
 #include <stdint.h>
 
-#include <functional>
-
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <initializer_list>
+#include <chrono>
+
+#ifdef MICROJSON_HEADER_ONLY
+    #define MICROJSON_EXTERN inline
+    #define MICROJSON_INLINE inline
+#else
+    #define MICROJSON_EXTERN extern
+    #define MICROJSON_INLINE
+#endif
 
 namespace microjson {
 enum JsonType {
@@ -87,16 +97,475 @@ struct JsonProperty {
     }
 };
 
+enum JsonError {
+    JsonNoError,
+    JsonSyntaxError,
+    JsonOverflowError,
+    JsonDepthLimitError,
+    JsonSizeLimitError,
+    JsonMembersLimitError,
+    JsonStringLimitError,
+    JsonDeadlineError
+};
+
+//Resource limits of a single parse. Whole input including nested values is checked before
+//anything is collected, so nested values of the result may be parsed without limits. Deadline
+//is checked while values are collected as well.
+struct JsonLimits {
+    JsonLimits() : maxDepth(SIZE_MAX)
+      , maxSize(SIZE_MAX)
+      , maxMembers(SIZE_MAX)
+      , maxStringSize(SIZE_MAX)
+      , deadline(std::chrono::steady_clock::time_point::max()) {}
+
+    size_t maxDepth;//Nesting levels, top-level object or array is level 1, at most MaxValidationDepth
+    size_t maxSize;//Input size in bytes
+    size_t maxMembers;//Properties or elements of any object or array
+    size_t maxStringSize;//Raw size of any string or property name in bytes
+    std::chrono::steady_clock::time_point deadline;
+};
+
+template<size_t Capacity>
+struct JsonFixedProperties {
+    JsonFixedProperties() : size(0) {}
+
+    JsonProperty properties[Capacity];
+    size_t size;
+
+    const JsonProperty *begin() const {
+        return properties;
+    }
+
+    const JsonProperty *end() const {
+        return properties + size;
+    }
+
+    //Looks for property by name, offsets of properties are relative to the parsed buffer
+    const JsonProperty *find(const char *buffer, const char *name, size_t nameSize) const {
+        for (size_t i = 0; i < size; ++i) {
+            const JsonProperty &property = properties[i];
+            if (property.nameSize() == nameSize) {
+                size_t j = 0;
+                for (; j < nameSize && buffer[property.nameBegin + j] == name[j]; ++j);
+                if (j == nameSize) {
+                    return &property;
+                }
+            }
+        }
+        return nullptr;
+    }
+};
+
+template<size_t Capacity>
+using JsonFixedObject = JsonFixedProperties<Capacity>;
+template<size_t Capacity>
+using JsonFixedArray = JsonFixedProperties<Capacity>;
+
+//16 bytes tagged value. Numbers are kept as text range, first conversion through a mutable array
+//caches converted value next to the range. Strings up to 15 bytes are stored inline, longer strings,
+//objects and arrays are ranges in the source buffer. Values are accessed through JsonCompactArray
+//that owns the buffer pointer.
+class JsonCompactValue {
+public:
+    JsonCompactValue() : m_tag(InvalidTag) {}
+    //Offsets of property must be relative to buffer
+    MICROJSON_INLINE JsonCompactValue(const char *buffer, const JsonProperty &property);
+
+private:
+    friend class JsonCompactRef;
+    friend class JsonCompactArray;
+
+    enum Tag : uint8_t {
+        InvalidTag,
+        NullTag,
+        FalseTag,
+        TrueTag,
+        NumberTag,
+        InlineStringTag,
+        StringTag,
+        ObjectTag,
+        ArrayTag
+    };
+
+    //Kept in the upper half of the tag of NumberTag values. Number text longer than
+    //MaxCachedNumberSize uses the whole 32-bit size and is never cached
+    enum NumberCache : uint8_t {
+        NoNumberCache,
+        IntegerCache,
+        DoubleCache,
+        LongNumberText
+    };
+
+    static const size_t InlineCapacity = 15;
+    static const uint32_t MaxCachedNumberSize = 0xffffff;
+    static const size_t NumberCacheOffset = 7;
+
+    Tag tag() const {
+        return static_cast<Tag>(m_tag & 0x0f);
+    }
+
+    size_t inlineSize() const {
+        return m_tag >> 4;
+    }
+
+    NumberCache numberCache() const {
+        return static_cast<NumberCache>(m_tag >> 4);
+    }
+
+    char m_data[InlineCapacity];
+    uint8_t m_tag;
+};
+
+static_assert(sizeof(JsonCompactValue) == 16, "JsonCompactValue is expected to be 16 bytes");
+
+class JsonCompactRef {
+public:
+    //Conversions store the converted number in cache when it is not null, cache is expected to
+    //be the value itself
+    JsonCompactRef(const JsonCompactValue &value, const char *buffer, JsonCompactValue *cache = nullptr) : m_value(value)
+      , m_buffer(buffer)
+      , m_cache(cache) {}
+
+    //null is reported as JsonObjectType, same as for JsonValue
+    MICROJSON_INLINE JsonType type() const;
+    MICROJSON_INLINE bool isNull() const;
+    MICROJSON_INLINE bool toBool() const;
+    //Saturates values out of int64_t range
+    MICROJSON_INLINE int64_t toInt() const;
+    MICROJSON_INLINE double toDouble() const;
+
+    //Raw text of the value, same as JsonValue::value
+    MICROJSON_INLINE std::string toString() const;
+
+private:
+    MICROJSON_INLINE void range(uint32_t &offset, uint32_t &size) const;
+
+    const JsonCompactValue &m_value;
+    const char *m_buffer;
+    JsonCompactValue *m_cache;
+};
+
+//Array of compact values that refers the source buffer, buffer must outlive the array.
+//Elements of non-const array cache the first numeric conversion, so concurrent readers either
+//access the array through a const reference, which never writes, or synchronize access.
+class JsonCompactArray {
+public:
+    JsonCompactArray() : m_buffer(nullptr) {}
+
+    size_t size() const {
+        return m_values.size();
+    }
+
+    JsonCompactRef operator[](size_t index) const {
+        return JsonCompactRef(m_values[index], m_buffer);
+    }
+
+    JsonCompactRef operator[](size_t index) {
+        return JsonCompactRef(m_values[index], m_buffer, &m_values[index]);
+    }
+
+    const char *buffer() const {
+        return m_buffer;
+    }
+
+private:
+    friend MICROJSON_INLINE JsonCompactArray parseJsonCompactArray(const char *buffer, size_t size);
+
+    const char *m_buffer;
+    std::vector<JsonCompactValue> m_values;
+};
+
 using JsonObject = std::unordered_map<std::string, JsonValue>;
 using JsonArray = std::vector<JsonValue>;
 
-extern JsonArray parseJsonArray(const char *buffer, size_t size);
-extern JsonObject parseJsonObject(const char *buffer, size_t size);
+//Immutable object for read-heavy lookups. Properties are indexed by a perfect hash with
+//per-bucket displacements, so lookup is a key hash, two array reads and a single key compare.
+//Lookups don't modify the object and need no synchronization between readers.
+class JsonFrozenObject {
+public:
+    JsonFrozenObject() : m_size(0) {}
+    MICROJSON_INLINE explicit JsonFrozenObject(const JsonObject &object);
+
+    //Returns nullptr if property doesn't exist
+    MICROJSON_INLINE const JsonValue *find(const char *name, size_t size) const;
+
+    const JsonValue *find(const std::string &name) const {
+        return find(name.data(), name.size());
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    //Number of slots, equals to size() unless the minimal table could not be built
+    size_t capacity() const {
+        return m_entries.size();
+    }
+
+private:
+    struct Entry {
+        Entry() : hash(0)
+          , keyOffset(0)
+          , keySize(UINT32_MAX) {}
+
+        uint64_t hash;
+        uint32_t keyOffset;
+        uint32_t keySize;//UINT32_MAX marks empty slot
+        JsonValue value;
+    };
+
+    MICROJSON_INLINE bool build(const std::vector<uint64_t> &hashes, size_t slotCount, bool spill);
+    MICROJSON_INLINE void assign(Entry &entry, const std::string &name, const JsonValue &value, uint64_t hash);
+    MICROJSON_INLINE const JsonValue *findCollision(const char *name, size_t size, uint64_t hash) const;
+
+    std::vector<Entry> m_entries;
+    std::vector<uint32_t> m_displacements;
+    std::vector<Entry> m_collisions;//Keys that found their slot taken, practically always empty
+    std::string m_keys;
+    size_t m_size;
+};
+
+MICROJSON_EXTERN JsonFrozenObject freeze(const JsonObject &object);
+
+class JsonProjection {
+public:
+    MICROJSON_INLINE JsonProjection(std::initializer_list<std::string> keys);
+    MICROJSON_INLINE explicit JsonProjection(const std::vector<std::string> &keys);
+
+    //Returns index of the key in projection or SIZE_MAX if name is not projected
+    MICROJSON_INLINE size_t indexOf(const char *name, size_t size) const;
+
+    size_t size() const {
+        return m_keys.size();
+    }
+
+    const std::string &key(size_t index) const {
+        return m_keys[index];
+    }
+
+private:
+    friend class JsonSchema;
+
+    MICROJSON_INLINE void compile();
+    MICROJSON_INLINE void append(const std::string &key);
+
+    std::vector<std::string> m_keys;
+    uint64_t m_lengthMask;
+    uint64_t m_firstByteMask[4];
+};
+
+enum JsonSchemaError {
+    JsonSchemaValid,
+    JsonSchemaSyntaxError,
+    JsonSchemaMissingProperty,
+    JsonSchemaUnexpectedProperty,
+    JsonSchemaTypeMismatch,
+    JsonSchemaOutOfRange,
+    JsonSchemaLengthMismatch,
+    JsonSchemaNotInEnum
+};
+
+struct JsonSchemaResult {
+    JsonSchemaResult() : error(JsonSchemaValid)
+      , offset(SIZE_MAX)
+      , property(SIZE_MAX) {}
+
+    JsonSchemaError error;
+    size_t offset;//Offset of the violating value, name or end of object for missing properties
+    size_t property;//Index of the violated schema property
+
+    bool valid() const {
+        return error == JsonSchemaValid;
+    }
+};
+
+//Compiled object schema. Rules are applied to the last added property:
+//JsonSchema().property("id", JsonNumberType).range(0, 1000).property("name", JsonStringType, false).length(1, 64)
+class JsonSchema {
+public:
+    MICROJSON_INLINE JsonSchema();
+
+    //JsonInvalidType accepts value of any type
+    MICROJSON_INLINE JsonSchema &property(const std::string &name, JsonType type, bool required = true);
+    MICROJSON_INLINE JsonSchema &range(double min, double max);
+    //Length of unescaped string in bytes. oneOf compares unescaped strings as well
+    MICROJSON_INLINE JsonSchema &length(size_t min, size_t max);
+    MICROJSON_INLINE JsonSchema &oneOf(std::initializer_list<std::string> values);
+    MICROJSON_INLINE JsonSchema &nullable();
+
+    JsonSchema &additionalProperties(bool allowed) {
+        m_additionalProperties = allowed;
+        return *this;
+    }
+
+    //Validates property that is found by extractProperty, offsets are relative to buffer
+    MICROJSON_INLINE JsonSchemaError check(const char *buffer, const JsonProperty &property, size_t &index) const;
+
+    size_t size() const {
+        return m_rules.size();
+    }
+
+    bool required(size_t index) const {
+        return m_rules[index].required;
+    }
+
+private:
+    struct Rule {
+        JsonType type;
+        bool required;
+        bool nullable;
+        bool hasRange;
+        double min;
+        double max;
+        size_t minLength;
+        size_t maxLength;
+        std::vector<std::string> values;
+    };
+
+    std::vector<Rule> m_rules;
+    JsonProjection m_projection;//Grows with every property, so adding properties is linear
+    bool m_additionalProperties;
+};
+
+MICROJSON_EXTERN JsonArray parseJsonArray(const char *buffer, size_t size);
+MICROJSON_EXTERN JsonObject parseJsonObject(const char *buffer, size_t size);
+
+//Parses object and validates it against schema in the same pass. Scanning stops at the first
+//violation, result is empty then
+MICROJSON_EXTERN JsonObject parseJsonObject(const char *buffer, size_t size, const JsonSchema &schema, JsonSchemaResult &result);
+//Validation only, nothing is collected
+MICROJSON_EXTERN JsonSchemaResult validateJsonObject(const char *buffer, size_t size, const JsonSchema &schema);
+
+struct JsonValidationResult {
+    JsonValidationResult() : error(JsonNoError)
+      , offset(SIZE_MAX) {}
+
+    JsonError error;//JsonDepthLimitError if nesting is deeper than MaxValidationDepth
+    size_t offset;//Offset of the first invalid byte, size for truncated input
+
+    bool valid() const {
+        return error == JsonNoError;
+    }
+};
+
+static const size_t MaxValidationDepth = 4096;
+
+//Checks that buffer is a single well-formed JSON text (RFC 8259), including number grammar,
+//literals, escapes, UTF-8 in strings and nesting. Nothing is allocated.
+MICROJSON_EXTERN JsonValidationResult validateJson(const char *buffer, size_t size);
+MICROJSON_EXTERN bool isValidJson(const char *buffer, size_t size);
+
+//Reformat JSON text without parsing, key order and string contents are kept byte to byte. Input
+//is expected to be valid, validateJson may be used to check it. Like snprintf, at most capacity
+//bytes are written to out and the full size of the result is returned, SIZE_MAX on unterminated
+//string. out may be equal to buffer for minifyJson.
+MICROJSON_EXTERN size_t minifyJson(const char *buffer, size_t size, char *out, size_t capacity);
+MICROJSON_EXTERN size_t prettifyJson(const char *buffer, size_t size, char *out, size_t capacity, size_t indent = 4);
+//Same as above with output resized to the result, false and empty out on unterminated string
+MICROJSON_EXTERN bool minifyJson(const char *buffer, size_t size, std::string &out);
+MICROJSON_EXTERN bool prettifyJson(const char *buffer, size_t size, std::string &out, size_t indent = 4);
+
+//Enforce limits before parsing, error is set to the first exceeded limit or JsonSyntaxError
+MICROJSON_EXTERN JsonObject parseJsonObject(const char *buffer, size_t size, const JsonLimits &limits, JsonError &error);
+MICROJSON_EXTERN JsonArray parseJsonArray(const char *buffer, size_t size, const JsonLimits &limits, JsonError &error);
+MICROJSON_EXTERN JsonError checkJsonLimits(const char *buffer, size_t size, const JsonLimits &limits);
+
+//Collects only properties listed in projection, values of other properties are skipped without allocation
+MICROJSON_EXTERN JsonObject parseJsonObject(const char *buffer, size_t size, const JsonProjection &projection);
+
+//Returns values in order of projection keys in a single scan. The last of duplicated keys wins, like
+//in parseJsonObject. Values of missing keys have JsonInvalidType
+MICROJSON_EXTERN JsonArray getMany(const char *buffer, size_t size, const JsonProjection &projection);
+
+//Heap free parsing into caller provided storage. Properties keep offsets relative to buffer,
+//JsonOverflowError is returned when capacity is exhausted, count holds the number of stored properties
+MICROJSON_EXTERN JsonError parseJsonObject(const char *buffer, size_t size, JsonProperty *properties, size_t capacity, size_t &count);
+MICROJSON_EXTERN JsonError parseJsonArray(const char *buffer, size_t size, JsonProperty *properties, size_t capacity, size_t &count);
+
+template<size_t Capacity>
+JsonError parseJsonObject(const char *buffer, size_t size, JsonFixedObject<Capacity> &object) {
+    return parseJsonObject(buffer, size, object.properties, Capacity, object.size);
+}
+
+template<size_t Capacity>
+JsonError parseJsonArray(const char *buffer, size_t size, JsonFixedArray<Capacity> &array) {
+    return parseJsonArray(buffer, size, array.properties, Capacity, array.size);
+}
 
 inline bool skipWhiteSpace(const char byte) {
     return byte == '\n' || byte == ' ' || byte == '\r' || byte == '\t' || byte == '\f' || byte == '\v';
 }
 
-extern bool extractValue(const char *buffer, size_t size, size_t &i, const char expectedEndByte, microjson::JsonProperty &property);
-extern bool extractProperty(const char *buffer, size_t size, size_t &i, const char expectedEndByte, microjson::JsonProperty &property);
+//Whitespace as defined by RFC 8259, unlike skipWhiteSpace doesn't accept '\f' and '\v'
+inline bool isJsonWhiteSpace(const char byte) {
+    return byte == ' ' || byte == '\n' || byte == '\r' || byte == '\t';
 }
+
+//Decodes array of numbers directly into out, arrays of fixed size tuples like [[x,y],[x,y]] are
+//flattened when tupleSize is set. Returns false and leaves out unchanged if array contains anything
+//else than numbers, parseJsonArray should be used as fallback then. int64_t variants fail on
+//fractions, exponents and values out of range.
+MICROJSON_EXTERN bool parseJsonNumberArray(const char *buffer, size_t size, std::vector<double> &out, size_t tupleSize = 0);
+MICROJSON_EXTERN bool parseJsonNumberArray(const char *buffer, size_t size, std::vector<int64_t> &out, size_t tupleSize = 0);
+
+//Same as above but decodes into caller buffer. Returns number of stored values or SIZE_MAX if
+//array is mixed or doesn't fit into capacity
+MICROJSON_EXTERN size_t parseJsonNumberArray(const char *buffer, size_t size, double *out, size_t capacity, size_t tupleSize = 0);
+MICROJSON_EXTERN size_t parseJsonNumberArray(const char *buffer, size_t size, int64_t *out, size_t capacity, size_t tupleSize = 0);
+
+//Transcodes JSON object or array into MessagePack or CBOR without building JsonObject. Strings are
+//unescaped and numbers are converted to integers or doubles on the fly. Output is appended to out,
+//on error out is restored to its original size
+MICROJSON_EXTERN bool jsonToMessagePack(const char *buffer, size_t size, std::vector<uint8_t> &out);
+MICROJSON_EXTERN bool jsonToCbor(const char *buffer, size_t size, std::vector<uint8_t> &out);
+
+//Decodes single MessagePack or CBOR item back into JSON text appended to out
+MICROJSON_EXTERN bool messagePackToJson(const uint8_t *buffer, size_t size, std::string &out);
+MICROJSON_EXTERN bool cborToJson(const uint8_t *buffer, size_t size, std::string &out);
+
+//Parses array into compact values, buffers larger than 4GiB are not supported
+MICROJSON_EXTERN JsonCompactArray parseJsonCompactArray(const char *buffer, size_t size);
+
+//Locates value by JSON pointer (RFC 6901) like "/a/b/0", empty pointer refers the whole document.
+//Offsets of found property are relative to buffer, for strings they exclude quotes
+MICROJSON_EXTERN bool findJsonValue(const char *buffer, size_t size, const std::string &pointer, JsonProperty &property);
+
+//Returns quoted and escaped JSON string
+MICROJSON_EXTERN std::string escapeJsonString(const char *buffer, size_t size);
+
+//Appends unescaped text of JSON string given without quotes, returns false on malformed escape sequence
+MICROJSON_EXTERN bool unescapeJsonString(const char *buffer, size_t size, std::string &out);
+
+//Converts number text like JsonValue::value of JsonNumberType. int64_t variant fails on fractions,
+//exponents and values out of range
+MICROJSON_EXTERN bool parseJsonNumber(const char *buffer, size_t size, int64_t &value);
+MICROJSON_EXTERN bool parseJsonNumber(const char *buffer, size_t size, double &value);
+
+MICROJSON_EXTERN bool extractValue(const char *buffer, size_t size, size_t &i, const char expectedEndByte, microjson::JsonProperty &property);
+MICROJSON_EXTERN bool extractProperty(const char *buffer, size_t size, size_t &i, const char expectedEndByte, microjson::JsonProperty &property);
+
+#ifdef MICROJSON_HEADER_ONLY
+//Compile-time configuration of header-only parser, containers may be replaced by any map-like
+//and vector-like types that accept JsonValue. Optional static constexpr bool validate checks input
+//with validateJson before parsing and gives empty container for malformed one, without it parser
+//is as lenient as the non-template one.
+struct JsonDefaultConfig {
+    using Object = JsonObject;
+    using Array = JsonArray;
+    static constexpr bool validate = false;
+};
+
+template<typename Config>
+typename Config::Array parseJsonArray(const char *buffer, size_t size);
+template<typename Config>
+typename Config::Object parseJsonObject(const char *buffer, size_t size);
+#endif
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+    #include "microjson.cpp"
+#endif
@@ -0,0 +1,355 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+#if !defined(__cpp_impl_coroutine)
+    #error "microjsonasync.h requires C++20 coroutines support"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+namespace microjson {
+
+enum JsonAsyncStatus {
+    JsonAsyncValue,   //value() holds next element
+    JsonAsyncPending, //byte budget is exhausted, parser may be resumed by next() at any time
+    JsonAsyncFinished,
+    JsonAsyncFailed
+};
+
+//Async generator of parsed elements. Consumer awaits next(), producer runs until it yields
+//an element, exhausts the byte budget or awaits the byte source for more input
+template<typename T>
+class JsonAsyncGenerator {
+public:
+    struct promise_type {
+        std::optional<T> current;
+        JsonAsyncStatus status = JsonAsyncPending;
+        std::coroutine_handle<> consumer;
+
+        struct TransferToConsumer {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                return handle.promise().consumer;
+            }
+            void await_resume() noexcept {}
+        };
+
+        JsonAsyncGenerator get_return_object() {
+            return JsonAsyncGenerator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        TransferToConsumer final_suspend() noexcept {
+            if (status != JsonAsyncFailed) {
+                status = JsonAsyncFinished;
+            }
+            return {};
+        }
+
+        TransferToConsumer yield_value(T value) {
+            current = std::move(value);
+            status = JsonAsyncValue;
+            return {};
+        }
+
+        TransferToConsumer yield_value(JsonAsyncStatus value) {
+            status = value;
+            return {};
+        }
+
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    JsonAsyncGenerator(JsonAsyncGenerator &&other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    JsonAsyncGenerator(const JsonAsyncGenerator &) = delete;
+    JsonAsyncGenerator &operator=(const JsonAsyncGenerator &) = delete;
+    ~JsonAsyncGenerator() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    auto next() {
+        struct NextAwaiter {
+            std::coroutine_handle<promise_type> producer;
+            bool await_ready() noexcept {
+                return producer.done();
+            }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer) noexcept {
+                producer.promise().consumer = consumer;
+                producer.promise().current.reset();
+                return producer;
+            }
+            JsonAsyncStatus await_resume() noexcept {
+                return producer.promise().status;
+            }
+        };
+        return NextAwaiter{m_handle};
+    }
+
+    T &value() {
+        return *m_handle.promise().current;
+    }
+
+private:
+    explicit JsonAsyncGenerator(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+//Splits buffered input into top-level elements of object or array. Scanning state survives
+//between chunks, so every input byte is visited once
+class JsonAsyncScanner {
+public:
+    enum State {
+        NeedMore,
+        Element,
+        End,
+        Failed,
+        BudgetExhausted
+    };
+
+    JsonAsyncScanner(char expectedBeginByte, size_t byteBudget) : m_expectedBeginByte(expectedBeginByte)
+      , m_byteBudget(byteBudget == 0 ? SIZE_MAX : byteBudget)
+      , m_budgetLeft(m_byteBudget) {}
+
+    void append(std::string_view chunk) {
+        if (m_elementBegin > 0 && m_elementBegin * 2 > m_buffer.size()) {
+            m_buffer.erase(0, m_elementBegin);
+            m_position -= m_elementBegin;
+            m_elementBegin = 0;
+        }
+        m_buffer.append(chunk.data(), chunk.size());
+    }
+
+    //On Element data() + elementBegin() holds element including trailing ',' or closing byte
+    State next(bool eof) {
+        for (; m_position < m_buffer.size(); ++m_position) {
+            if (m_budgetLeft == 0) {
+                m_budgetLeft = m_byteBudget;
+                return BudgetExhausted;
+            }
+            --m_budgetLeft;
+
+            const char byte = m_buffer[m_position];
+            if (!m_begun) {
+                if (byte == m_expectedBeginByte) {
+                    m_begun = true;
+                    m_elementBegin = m_position + 1;
+                } else if (!skipWhiteSpace(byte)) {
+                    return Failed;
+                }
+                continue;
+            }
+
+            if (m_stringScope) {
+                if (m_escape) {
+                    m_escape = false;
+                } else if (byte == '\\') {
+                    m_escape = true;
+                } else if (byte == '"') {
+                    m_stringScope = false;
+                }
+                continue;
+            }
+
+            switch (byte) {
+            case '"':
+                m_stringScope = true;
+                m_empty = false;
+                break;
+            case '{':
+            case '[':
+                ++m_depth;
+                m_empty = false;
+                break;
+            case '}':
+            case ']':
+                if (m_depth > 0) {
+                    --m_depth;
+                    break;
+                }
+                if (byte != m_expectedBeginByte + 2) {
+                    return Failed;
+                }
+                m_elementSize = m_position - m_elementBegin + 1;
+                ++m_position;
+                if (m_empty) {
+                    return m_elements == 0 ? End : Failed;
+                }
+                m_finished = true;
+                ++m_elements;
+                return Element;
+            case ',':
+                if (m_depth == 0) {
+                    if (m_empty) {
+                        return Failed;
+                    }
+                    m_elementSize = m_position - m_elementBegin + 1;
+                    ++m_position;
+                    ++m_elements;
+                    return Element;
+                }
+                break;
+            default:
+                if (!skipWhiteSpace(byte)) {
+                    m_empty = false;
+                }
+                break;
+            }
+        }
+        return eof ? Failed : NeedMore;
+    }
+
+    //Called after Element was processed
+    State advance() {
+        m_elementBegin = m_position;
+        m_empty = true;
+        return m_finished ? End : NeedMore;
+    }
+
+    const char *data() const {
+        return m_buffer.data();
+    }
+
+    size_t elementBegin() const {
+        return m_elementBegin;
+    }
+
+    size_t elementSize() const {
+        return m_elementSize;
+    }
+
+private:
+    std::string m_buffer;
+    char m_expectedBeginByte;
+    size_t m_byteBudget;
+    size_t m_budgetLeft;
+    size_t m_position = 0;
+    size_t m_elementBegin = 0;
+    size_t m_elementSize = 0;
+    size_t m_elements = 0;
+    int m_depth = 0;
+    bool m_begun = false;
+    bool m_stringScope = false;
+    bool m_escape = false;
+    bool m_empty = true;
+    bool m_finished = false;
+};
+
+using JsonAsyncProperty = std::pair<std::string, JsonValue>;
+
+//Source is any type with read() returning an awaitable that resolves to std::string_view chunk,
+//empty chunk means end of input. Chunks are copied, so they only need to live until next read().
+//Source must outlive the generator. Every byteBudget scanned bytes generator reports JsonAsyncPending,
+//0 means no budget.
+template<typename Source>
+JsonAsyncGenerator<JsonAsyncProperty> parseJsonObjectAsync(Source &source, size_t byteBudget = SIZE_MAX) {
+    JsonAsyncScanner scanner('{', byteBudget);
+    bool eof = false;
+    while (true) {
+        JsonAsyncScanner::State state = scanner.next(eof);
+        switch (state) {
+        case JsonAsyncScanner::NeedMore: {
+            std::string_view chunk = co_await source.read();
+            eof = chunk.empty();
+            scanner.append(chunk);
+            break;
+        }
+        case JsonAsyncScanner::BudgetExhausted:
+            co_yield JsonAsyncPending;
+            break;
+        case JsonAsyncScanner::Element: {
+            const char *element = scanner.data() + scanner.elementBegin();
+            size_t i = 0;
+            JsonProperty property;
+            if (!extractProperty(element, scanner.elementSize(), i, '}', property)) {
+                co_yield JsonAsyncFailed;
+                co_return;
+            }
+            co_yield JsonAsyncProperty(std::string(element + property.nameBegin, property.nameSize()),
+                                       JsonValue(std::string(element + property.valueBegin, property.valueSize()), property.type));
+            if (scanner.advance() == JsonAsyncScanner::End) {
+                co_return;
+            }
+            break;
+        }
+        case JsonAsyncScanner::End:
+            co_return;
+        case JsonAsyncScanner::Failed:
+            co_yield JsonAsyncFailed;
+            co_return;
+        }
+    }
+}
+
+template<typename Source>
+JsonAsyncGenerator<JsonValue> parseJsonArrayAsync(Source &source, size_t byteBudget = SIZE_MAX) {
+    JsonAsyncScanner scanner('[', byteBudget);
+    bool eof = false;
+    while (true) {
+        JsonAsyncScanner::State state = scanner.next(eof);
+        switch (state) {
+        case JsonAsyncScanner::NeedMore: {
+            std::string_view chunk = co_await source.read();
+            eof = chunk.empty();
+            scanner.append(chunk);
+            break;
+        }
+        case JsonAsyncScanner::BudgetExhausted:
+            co_yield JsonAsyncPending;
+            break;
+        case JsonAsyncScanner::Element: {
+            const char *element = scanner.data() + scanner.elementBegin();
+            size_t i = 0;
+            JsonProperty property;
+            if (!extractValue(element, scanner.elementSize(), i, ']', property)) {
+                co_yield JsonAsyncFailed;
+                co_return;
+            }
+            co_yield JsonValue(std::string(element + property.valueBegin, property.valueSize()), property.type);
+            if (scanner.advance() == JsonAsyncScanner::End) {
+                co_return;
+            }
+            break;
+        }
+        case JsonAsyncScanner::End:
+            co_return;
+        case JsonAsyncScanner::Failed:
+            co_yield JsonAsyncFailed;
+            co_return;
+        }
+    }
+}
+}
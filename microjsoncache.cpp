@@ -0,0 +1,370 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjsoncache.h"
+#include "microjsondetail.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace microjson {
+namespace detail {
+inline uint64_t mix(uint64_t value) {
+    value ^= value >> 31;
+    value *= 0x7fb5d329728ea185ull;
+    value ^= value >> 27;
+    value *= 0x81dadef4bc2dd44dull;
+    value ^= value >> 33;
+    return value;
+}
+
+//Rough size of JsonValue including heap allocated text
+inline size_t valueCost(const std::string &value) {
+    return sizeof(microjson::JsonValue) + (value.capacity() > 15 ? value.capacity() : 0);
+}
+
+inline size_t resultCost(const microjson::JsonObject &object) {
+    const size_t nodeOverhead = 2 * sizeof(void *) + sizeof(size_t);
+    size_t cost = sizeof(object) + object.bucket_count() * sizeof(void *);
+    for (const auto &property : object) {
+        cost += nodeOverhead + sizeof(std::string) + (property.first.capacity() > 15 ? property.first.capacity() : 0)
+                + valueCost(property.second.value);
+    }
+    return cost;
+}
+
+//Rough size of string shared through make_shared
+inline size_t internedCost(const std::string &value) {
+    return 2 * sizeof(void *) + sizeof(std::string) + (value.capacity() > 15 ? value.capacity() : 0);
+}
+
+//Same estimate as resultCost for JsonObject with the same members
+inline size_t plainCost(const microjson::JsonInternedObject &object) {
+    const size_t nodeOverhead = 2 * sizeof(void *) + sizeof(size_t);
+    size_t cost = sizeof(microjson::JsonObject) + object.size() * sizeof(void *);
+    for (const auto &member : object) {
+        cost += nodeOverhead + sizeof(std::string) + (member.name->capacity() > 15 ? member.name->capacity() : 0)
+                + valueCost(*member.value);
+    }
+    return cost;
+}
+
+inline size_t resultCost(const microjson::JsonArray &array) {
+    size_t cost = sizeof(array);
+    for (const auto &value : array) {
+        cost += valueCost(value.value);
+    }
+    return cost;
+}
+}
+}
+
+uint64_t microjson::hashBuffer(const char *buffer, size_t size) {
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ (size * 0xc2b2ae3d27d4eb4full);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, buffer + i, sizeof(word));
+        hash = (hash ^ detail::mix(word)) * 0x9fb21c651e98df25ull;
+    }
+
+    uint64_t tail = 0;
+    if (i < size) {
+        memcpy(&tail, buffer + i, size - i);
+    }
+    hash ^= detail::mix(tail ^ (size - i));
+    return detail::mix(hash);
+}
+
+microjson::JsonParseCache::JsonParseCache(size_t memoryLimit) : m_memoryUsage(0)
+  , m_memoryLimit(memoryLimit)
+  , m_hits(0)
+  , m_misses(0)
+{
+}
+
+microjson::JsonParseCache::EntryList::iterator microjson::JsonParseCache::find(uint64_t hash, bool isObject, const char *buffer, size_t size) {
+    auto range = m_index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const Entry &entry = *it->second;
+        if (entry.isObject == isObject && entry.source.size() == size && memcmp(entry.source.data(), buffer, size) == 0) {
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return it->second;
+        }
+    }
+    return m_entries.end();
+}
+
+void microjson::JsonParseCache::insert(Entry &&entry) {
+    if (entry.cost > m_memoryLimit.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    if (find(entry.hash, entry.isObject, entry.source.data(), entry.source.size()) != m_entries.end()) {
+        return;//Inserted by concurrent parse
+    }
+
+    m_memoryUsage += entry.cost;
+    m_entries.push_front(std::move(entry));
+    m_index.emplace(m_entries.front().hash, m_entries.begin());
+    evict();
+}
+
+void microjson::JsonParseCache::evict() {
+    const size_t limit = m_memoryLimit.load(std::memory_order_relaxed);
+    while (m_memoryUsage > limit && !m_entries.empty()) {
+        auto last = std::prev(m_entries.end());
+        auto range = m_index.equal_range(last->hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == last) {
+                m_index.erase(it);
+                break;
+            }
+        }
+        m_memoryUsage -= last->cost;
+        m_entries.erase(last);
+    }
+}
+
+std::shared_ptr<const microjson::JsonObject> microjson::JsonParseCache::parseJsonObject(const char *buffer, size_t size) {
+    const uint64_t hash = hashBuffer(buffer, size);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = find(hash, true, buffer, size);
+        if (it != m_entries.end()) {
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return it->object;
+        }
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+
+    //Parse without lock, concurrent misses of the same buffer are resolved on insertion
+    std::shared_ptr<const JsonObject> object = std::make_shared<const JsonObject>(microjson::parseJsonObject(buffer, size));
+    Entry entry{hash, true, std::string(buffer, size), object, nullptr, 0};
+    entry.cost = sizeof(Entry) + size + detail::resultCost(*object);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    insert(std::move(entry));
+    return object;
+}
+
+std::shared_ptr<const microjson::JsonArray> microjson::JsonParseCache::parseJsonArray(const char *buffer, size_t size) {
+    const uint64_t hash = hashBuffer(buffer, size);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = find(hash, false, buffer, size);
+        if (it != m_entries.end()) {
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return it->array;
+        }
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+
+    std::shared_ptr<const JsonArray> array = std::make_shared<const JsonArray>(microjson::parseJsonArray(buffer, size));
+    Entry entry{hash, false, std::string(buffer, size), nullptr, array, 0};
+    entry.cost = sizeof(Entry) + size + detail::resultCost(*array);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    insert(std::move(entry));
+    return array;
+}
+
+void microjson::JsonParseCache::setMemoryLimit(size_t memoryLimit) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memoryLimit.store(memoryLimit, std::memory_order_relaxed);
+    evict();
+}
+
+void microjson::JsonParseCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_index.clear();
+    m_memoryUsage = 0;
+}
+
+size_t microjson::JsonParseCache::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryUsage;
+}
+
+size_t microjson::JsonParseCache::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+const microjson::JsonInternedMember *microjson::JsonInternedObject::find(const char *name, size_t size) const {
+    auto it = std::lower_bound(m_members.begin(), m_members.end(), 0, [name, size](const JsonInternedMember &member, int) {
+        return detail::compareNames(member.name->data(), member.name->size(), name, size) < 0;
+    });
+    if (it == m_members.end() || detail::compareNames(it->name->data(), it->name->size(), name, size) != 0) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+microjson::JsonObject microjson::JsonInternedObject::toObject() const {
+    JsonObject object;
+    object.reserve(m_members.size());
+    for (const auto &member : m_members) {
+        object.emplace(*member.name, JsonValue(*member.value, member.type));
+    }
+    return object;
+}
+
+microjson::JsonInternedString microjson::JsonInternStore::internString(const char *buffer, size_t size) {
+    const uint64_t hash = hashBuffer(buffer, size);
+    auto range = m_strings.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second->size() == size && memcmp(it->second->data(), buffer, size) == 0) {
+            return it->second;
+        }
+    }
+    JsonInternedString string = std::make_shared<const std::string>(buffer, size);
+    m_strings.emplace(hash, string);
+    return string;
+}
+
+//Members are interned already, so equal objects have identical member pointers
+std::shared_ptr<const microjson::JsonInternedObject> microjson::JsonInternStore::internObject(JsonInternedObject &&object) {
+    uint64_t hash = object.m_members.size();
+    for (const auto &member : object.m_members) {
+        hash = detail::mix(hash ^ reinterpret_cast<uintptr_t>(member.name.get()));
+        hash = detail::mix(hash ^ reinterpret_cast<uintptr_t>(member.value.get()) ^ member.type);
+    }
+
+    auto range = m_objects.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const std::vector<JsonInternedMember> &members = it->second->m_members;
+        if (members.size() == object.m_members.size()
+                && std::equal(members.begin(), members.end(), object.m_members.begin(),
+                              [](const JsonInternedMember &member1, const JsonInternedMember &member2) {
+            return member1.name == member2.name && member1.value == member2.value && member1.type == member2.type;
+        })) {
+            return it->second;
+        }
+    }
+
+    std::shared_ptr<const JsonInternedObject> interned = std::make_shared<const JsonInternedObject>(std::move(object));
+    m_objects.emplace(hash, interned);
+    return interned;
+}
+
+std::shared_ptr<const microjson::JsonInternedObject> microjson::JsonInternStore::parseJsonObject(const char *buffer, size_t size) {
+    std::vector<JsonProperty> properties(16);
+    size_t count = 0;
+    JsonError error;
+    while ((error = microjson::parseJsonObject(buffer, size, properties.data(), properties.size(), count)) == JsonOverflowError) {
+        properties.resize(properties.size() * 2);
+    }
+    if (error != JsonNoError) {
+        return nullptr;
+    }
+
+    //Duplicated names stay in source order, only the last one of each run is interned below
+    std::stable_sort(properties.begin(), properties.begin() + count, [buffer](const JsonProperty &property1, const JsonProperty &property2) {
+        return detail::compareNames(buffer + property1.nameBegin, property1.nameSize(), buffer + property2.nameBegin, property2.nameSize()) < 0;
+    });
+
+    JsonInternedObject object;
+    object.m_members.reserve(count);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < count; ++i) {
+        const JsonProperty &property = properties[i];
+        if (i + 1 < count && detail::compareNames(buffer + property.nameBegin, property.nameSize(),
+                                          buffer + properties[i + 1].nameBegin, properties[i + 1].nameSize()) == 0) {
+            continue;
+        }
+        object.m_members.push_back({internString(buffer + property.nameBegin, property.nameSize()),
+                                    internString(buffer + property.valueBegin, property.valueSize()), property.type});
+    }
+    return internObject(std::move(object));
+}
+
+std::shared_ptr<const microjson::JsonInternedObject> microjson::JsonInternStore::intern(const JsonObject &object) {
+    std::vector<const JsonObject::value_type *> properties;
+    properties.reserve(object.size());
+    for (const auto &property : object) {
+        properties.push_back(&property);
+    }
+    std::sort(properties.begin(), properties.end(), [](const JsonObject::value_type *property1, const JsonObject::value_type *property2) {
+        return property1->first < property2->first;
+    });
+
+    JsonInternedObject interned;
+    interned.m_members.reserve(properties.size());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto property : properties) {
+        interned.m_members.push_back({internString(property->first.data(), property->first.size()),
+                                      internString(property->second.value.data(), property->second.value.size()),
+                                      property->second.type});
+    }
+    return internObject(std::move(interned));
+}
+
+size_t microjson::JsonInternStore::collect() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t released = 0;
+    //Objects first, they hold references to strings
+    for (auto it = m_objects.begin(); it != m_objects.end();) {
+        if (it->second.use_count() == 1) {
+            it = m_objects.erase(it);
+            ++released;
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = m_strings.begin(); it != m_strings.end();) {
+        if (it->second.use_count() == 1) {
+            it = m_strings.erase(it);
+            ++released;
+        } else {
+            ++it;
+        }
+    }
+    return released;
+}
+
+void microjson::JsonInternStore::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_objects.clear();
+    m_strings.clear();
+}
+
+microjson::JsonInternStats microjson::JsonInternStore::stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    JsonInternStats stats{m_strings.size(), m_objects.size(), 0, 0, 0};
+    for (const auto &string : m_strings) {
+        stats.storedBytes += detail::internedCost(*string.second);
+    }
+    for (const auto &object : m_objects) {
+        const size_t references = static_cast<size_t>(object.second.use_count() - 1);
+        stats.references += references;
+        stats.storedBytes += 2 * sizeof(void *) + sizeof(JsonInternedObject)
+                + object.second->m_members.capacity() * sizeof(JsonInternedMember);
+        stats.plainBytes += references * detail::plainCost(*object.second);
+    }
+    return stats;
+}
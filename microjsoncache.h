@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace microjson {
+
+//Fast non-cryptographic 64-bit hash of buffer
+MICROJSON_EXTERN uint64_t hashBuffer(const char *buffer, size_t size);
+
+//Thread safe LRU cache of immutable parse results. Entries are keyed by hash and size of the
+//source buffer and verified by comparing the stored source bytes, so collisions never return
+//a wrong result. Cached results are shared, they stay valid after eviction while referenced.
+class JsonParseCache {
+public:
+    MICROJSON_INLINE explicit JsonParseCache(size_t memoryLimit = 16 * 1024 * 1024);
+
+    MICROJSON_INLINE std::shared_ptr<const JsonObject> parseJsonObject(const char *buffer, size_t size);
+    MICROJSON_INLINE std::shared_ptr<const JsonArray> parseJsonArray(const char *buffer, size_t size);
+
+    MICROJSON_INLINE void setMemoryLimit(size_t memoryLimit);
+    MICROJSON_INLINE void clear();
+
+    size_t memoryLimit() const {
+        return m_memoryLimit.load(std::memory_order_relaxed);
+    }
+
+    //Estimated size of cached sources and results
+    MICROJSON_INLINE size_t memoryUsage() const;
+    MICROJSON_INLINE size_t size() const;
+
+    size_t hits() const {
+        return m_hits.load(std::memory_order_relaxed);
+    }
+
+    size_t misses() const {
+        return m_misses.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        bool isObject;
+        std::string source;
+        std::shared_ptr<const JsonObject> object;
+        std::shared_ptr<const JsonArray> array;
+        size_t cost;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    MICROJSON_INLINE EntryList::iterator find(uint64_t hash, bool isObject, const char *buffer, size_t size);
+    MICROJSON_INLINE void insert(Entry &&entry);
+    MICROJSON_INLINE void evict();
+
+    mutable std::mutex m_mutex;
+    EntryList m_entries;//Most recently used first
+    std::unordered_multimap<uint64_t, EntryList::iterator> m_index;
+    size_t m_memoryUsage;
+    std::atomic<size_t> m_memoryLimit;
+    std::atomic<size_t> m_hits;
+    std::atomic<size_t> m_misses;
+};
+
+using JsonInternedString = std::shared_ptr<const std::string>;
+
+struct JsonInternedMember {
+    JsonInternedString name;
+    JsonInternedString value;//Raw text, same as JsonValue::value
+    JsonType type;
+};
+
+//Immutable object which members are shared with other objects of the same JsonInternStore
+class JsonInternedObject {
+public:
+    using const_iterator = std::vector<JsonInternedMember>::const_iterator;
+
+    size_t size() const {
+        return m_members.size();
+    }
+
+    bool empty() const {
+        return m_members.empty();
+    }
+
+    //Members are ordered by name
+    const_iterator begin() const {
+        return m_members.begin();
+    }
+
+    const_iterator end() const {
+        return m_members.end();
+    }
+
+    //Returns nullptr if member is missing
+    MICROJSON_INLINE const JsonInternedMember *find(const char *name, size_t size) const;
+    const JsonInternedMember *find(const std::string &name) const {
+        return find(name.data(), name.size());
+    }
+
+    MICROJSON_INLINE JsonObject toObject() const;
+
+private:
+    friend class JsonInternStore;
+
+    std::vector<JsonInternedMember> m_members;
+};
+
+struct JsonInternStats {
+    size_t strings;
+    size_t objects;
+    size_t references;//Objects held outside of the store
+    size_t storedBytes;//Estimated memory of interned strings and objects
+    size_t plainBytes;//Estimated memory of the same references parsed into JsonObject
+
+    size_t savedBytes() const {
+        return plainBytes > storedBytes ? plainBytes - storedBytes : 0;
+    }
+};
+
+//Thread safe deduplicating store for long retained parse results. Names, values and raw text of
+//nested values are interned by content, objects with identical members are shared as a whole, so
+//repeated records and repeated nested values are kept once. Interned data is reference counted,
+//collect() releases what is no longer referenced outside of the store.
+class JsonInternStore {
+public:
+    //Returns nullptr on syntax error
+    MICROJSON_INLINE std::shared_ptr<const JsonInternedObject> parseJsonObject(const char *buffer, size_t size);
+    MICROJSON_INLINE std::shared_ptr<const JsonInternedObject> intern(const JsonObject &object);
+
+    //Returns number of released strings and objects
+    MICROJSON_INLINE size_t collect();
+    MICROJSON_INLINE void clear();
+    MICROJSON_INLINE JsonInternStats stats() const;
+
+private:
+    MICROJSON_INLINE JsonInternedString internString(const char *buffer, size_t size);
+    MICROJSON_INLINE std::shared_ptr<const JsonInternedObject> internObject(JsonInternedObject &&object);
+
+    mutable std::mutex m_mutex;
+    std::unordered_multimap<uint64_t, JsonInternedString> m_strings;
+    std::unordered_multimap<uint64_t, std::shared_ptr<const JsonInternedObject>> m_objects;
+};
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+    #include "microjsoncache.cpp"
+#endif
@@ -0,0 +1,452 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjsoncolumns.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace microjson {
+namespace detail {
+struct RowRange {
+    size_t begin;
+    size_t size;
+};
+
+//Chunks shorter than this are not worth a thread
+const size_t MinChunkRows = 4096;
+
+inline size_t trimRow(const char *buffer, size_t begin, size_t &end) {
+    for (; begin < end && microjson::skipWhiteSpace(buffer[begin]); ++begin);
+    for (; end > begin && microjson::skipWhiteSpace(buffer[end - 1]); --end);
+    return begin;
+}
+
+//Splits top level array or lines into row ranges without parsing rows, stops after maxRows
+inline bool collectRows(const char *buffer, size_t size, size_t maxRows, std::vector<RowRange> &rows) {
+    size_t i = 0;
+    for (; i < size && microjson::skipWhiteSpace(buffer[i]); ++i);
+    if (i < size && buffer[i] == '[') {
+        size_t begin = ++i;
+        int depth = 0;
+        for (; i < size && rows.size() < maxRows; ++i) {
+            const char byte = buffer[i];
+            if (byte == '"') {
+                for (++i; i < size && buffer[i] != '"'; ++i) {
+                    if (buffer[i] == '\\') {
+                        ++i;
+                    }
+                }
+            } else if (byte == '{' || byte == '[') {
+                ++depth;
+            } else if ((byte == '}' || byte == ']') && depth > 0) {
+                --depth;
+            } else if (depth == 0 && (byte == ',' || byte == ']')) {
+                size_t end = i;
+                begin = trimRow(buffer, begin, end);
+                if (begin == end) {
+                    return byte == ']' && rows.empty();//Only [] may have no rows
+                }
+                rows.push_back({begin, end - begin});
+                if (byte == ']') {
+                    return true;
+                }
+                begin = i + 1;
+            }
+        }
+        return rows.size() == maxRows;
+    }
+
+    while (i < size && rows.size() < maxRows) {
+        const char *newLine = static_cast<const char *>(memchr(buffer + i, '\n', size - i));
+        size_t end = newLine != nullptr ? newLine - buffer : size;
+        const size_t begin = trimRow(buffer, i, end);
+        if (begin < end) {
+            rows.push_back({begin, end - begin});
+        }
+        i = newLine != nullptr ? newLine - buffer + 1 : size;
+    }
+    return true;
+}
+
+//Parses row into reused properties storage
+inline bool parseRow(const char *row, size_t size, std::vector<microjson::JsonProperty> &properties, size_t &count) {
+    if (properties.empty()) {
+        properties.resize(32);
+    }
+
+    microjson::JsonError error;
+    while ((error = microjson::parseJsonObject(row, size, properties.data(), properties.size(), count)) == microjson::JsonOverflowError) {
+        properties.resize(properties.size() * 2);
+    }
+    return error == microjson::JsonNoError;
+}
+
+inline void appendBit(std::vector<uint8_t> &bitmap, size_t row, bool value) {
+    if ((row & 7) == 0) {
+        bitmap.push_back(0);
+    }
+    bitmap.back() |= uint8_t(value) << (row & 7);
+}
+}
+}
+
+namespace microjson {
+//Appends rows to columns, keeps scratch buffer for unescaped strings
+class JsonColumnWriter {
+public:
+    static void reserve(JsonColumn &column, size_t rows) {
+        column.m_validity.reserve((rows + 7) / 8);
+        if (column.m_type == JsonColumnInt64 || column.m_type == JsonColumnDouble) {
+            column.m_values.reserve(rows * sizeof(int64_t));
+        } else if (column.m_type == JsonColumnString) {
+            column.m_offsets.reserve(rows + 1);
+        }
+    }
+
+    static void appendNull(JsonColumn &column) {
+        detail::appendBit(column.m_validity, column.m_size, false);
+        switch (column.m_type) {
+        case JsonColumnInt64:
+        case JsonColumnDouble:
+            column.m_values.resize(column.m_values.size() + sizeof(int64_t));
+            break;
+        case JsonColumnBool:
+            detail::appendBit(column.m_values, column.m_size, false);
+            break;
+        case JsonColumnString:
+            column.m_offsets.push_back(column.m_offsets.back());
+            break;
+        }
+        ++column.m_nullCount;
+        ++column.m_size;
+    }
+
+    //Values of other types are stored as null, returns false if string data exceeds int32 offsets
+    bool appendValue(JsonColumn &column, const char *row, const JsonProperty &property) {
+        const char *value = row + property.valueBegin;
+        const size_t size = property.valueSize();
+        switch (column.m_type) {
+        case JsonColumnInt64: {
+            int64_t integer = 0;
+            if (property.type != JsonNumberType || !parseJsonNumber(value, size, integer)) {
+                break;
+            }
+            appendFixed(column, integer);
+            return true;
+        }
+        case JsonColumnDouble: {
+            double number = 0;
+            if (property.type != JsonNumberType || !parseJsonNumber(value, size, number)) {
+                break;
+            }
+            appendFixed(column, number);
+            return true;
+        }
+        case JsonColumnBool:
+            if (property.type != JsonBoolType) {
+                break;
+            }
+            detail::appendBit(column.m_validity, column.m_size, true);
+            detail::appendBit(column.m_values, column.m_size, value[0] == 't');
+            ++column.m_size;
+            return true;
+        case JsonColumnString:
+            if (property.type != JsonStringType) {
+                break;
+            }
+            if (memchr(value, '\\', size) == nullptr) {
+                column.m_values.insert(column.m_values.end(), value, value + size);
+            } else {
+                m_unescaped.clear();
+                if (!unescapeJsonString(value, size, m_unescaped)) {
+                    break;
+                }
+                column.m_values.insert(column.m_values.end(), m_unescaped.begin(), m_unescaped.end());
+            }
+            if (column.m_values.size() > size_t(INT32_MAX)) {
+                return false;
+            }
+            detail::appendBit(column.m_validity, column.m_size, true);
+            column.m_offsets.push_back(static_cast<int32_t>(column.m_values.size()));
+            ++column.m_size;
+            return true;
+        }
+        appendNull(column);
+        return true;
+    }
+
+    //Appends chunk shredded separately, size of column must be multiple of 8
+    static bool append(JsonColumn &column, const JsonColumn &chunk) {
+        column.m_validity.insert(column.m_validity.end(), chunk.m_validity.begin(), chunk.m_validity.end());
+        if (column.m_type == JsonColumnString) {
+            const size_t base = column.m_values.size();
+            if (base + chunk.m_values.size() > size_t(INT32_MAX)) {
+                return false;
+            }
+            for (size_t i = 1; i < chunk.m_offsets.size(); ++i) {
+                column.m_offsets.push_back(static_cast<int32_t>(base + chunk.m_offsets[i]));
+            }
+        }
+        column.m_values.insert(column.m_values.end(), chunk.m_values.begin(), chunk.m_values.end());
+        column.m_size += chunk.m_size;
+        column.m_nullCount += chunk.m_nullCount;
+        return true;
+    }
+
+private:
+    template<typename T>
+    static void appendFixed(JsonColumn &column, T value) {
+        detail::appendBit(column.m_validity, column.m_size, true);
+        const size_t offset = column.m_values.size();
+        column.m_values.resize(offset + sizeof(value));
+        memcpy(&column.m_values[offset], &value, sizeof(value));
+        ++column.m_size;
+    }
+
+    std::string m_unescaped;
+};
+}
+
+namespace microjson {
+namespace detail {
+//Members usually follow the same order in every row, so search starts from the field after the
+//last matched one
+inline size_t findField(const std::vector<microjson::JsonColumnField> &fields, size_t expected, const char *name, size_t size) {
+    for (size_t tried = 0, field = expected; tried < fields.size(); ++tried, field = field + 1 < fields.size() ? field + 1 : 0) {
+        if (fields[field].name.size() == size && memcmp(fields[field].name.data(), name, size) == 0) {
+            return field;
+        }
+    }
+    return SIZE_MAX;
+}
+
+inline bool shredChunk(const char *buffer, const RowRange *rows, size_t count, const std::vector<microjson::JsonColumnField> &fields,
+                       std::vector<microjson::JsonColumn> &columns) {
+    columns.clear();
+    columns.reserve(fields.size());
+    for (const auto &field : fields) {
+        columns.push_back(microjson::JsonColumn(field.name, field.type));
+        microjson::JsonColumnWriter::reserve(columns.back(), count);
+    }
+
+    microjson::JsonColumnWriter writer;
+    std::vector<microjson::JsonProperty> properties;
+    std::vector<size_t> filled(fields.size(), SIZE_MAX);//Last row that has value of the field
+    std::vector<size_t> members(fields.size(), 0);//Member of the row that holds value of the field
+    for (size_t row = 0; row < count; ++row) {
+        const char *data = buffer + rows[row].begin;
+        size_t propertiesCount = 0;
+        if (!parseRow(data, rows[row].size, properties, propertiesCount)) {
+            return false;
+        }
+
+        size_t expected = 0;
+        for (size_t i = 0; i < propertiesCount; ++i) {
+            const microjson::JsonProperty &property = properties[i];
+            const size_t field = findField(fields, expected, data + property.nameBegin, property.nameSize());
+            if (field == SIZE_MAX) {
+                continue;
+            }
+
+            expected = field + 1 < fields.size() ? field + 1 : 0;
+            filled[field] = row;
+            members[field] = i;
+        }
+
+        for (size_t field = 0; field < fields.size(); ++field) {
+            if (filled[field] != row) {
+                microjson::JsonColumnWriter::appendNull(columns[field]);
+            } else if (!writer.appendValue(columns[field], data, properties[members[field]])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}
+}
+
+namespace microjson {
+namespace detail {
+//Shreds chunks on threads and concatenates them
+inline bool shredRows(const char *buffer, const std::vector<RowRange> &rows, const std::vector<microjson::JsonColumnField> &fields,
+                      std::vector<microjson::JsonColumn> &columns, size_t threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    const size_t chunks = std::max<size_t>(1, std::min(threads, rows.size() / MinChunkRows));
+    //Chunks hold multiple of 8 rows, so their bitmaps are concatenated bytewise
+    const size_t chunkRows = ((rows.size() + chunks - 1) / chunks + 7) & ~size_t(7);
+
+    std::vector<std::vector<microjson::JsonColumn>> results(chunks);
+    std::vector<char> succeeded(chunks, 0);
+    auto shred = [&](size_t chunk) {
+        const size_t begin = std::min(rows.size(), chunk * chunkRows);
+        const size_t count = std::min(rows.size() - begin, chunkRows);
+        succeeded[chunk] = shredChunk(buffer, rows.data() + begin, count, fields, results[chunk]);
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+        workers.push_back(std::thread(shred, chunk));
+    }
+    shred(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        if (!succeeded[chunk]) {
+            return false;
+        }
+    }
+
+    columns = std::move(results[0]);
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+        for (size_t field = 0; field < columns.size(); ++field) {
+            if (!microjson::JsonColumnWriter::append(columns[field], results[chunk][field])) {
+                columns.clear();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}
+}
+
+microjson::JsonColumn::JsonColumn(const std::string &name, JsonColumnType type) : m_name(name)
+  , m_type(type)
+  , m_size(0)
+  , m_nullCount(0)
+{
+    if (type == JsonColumnString) {
+        m_offsets.push_back(0);
+    }
+}
+
+int64_t microjson::JsonColumn::int64At(size_t row) const {
+    int64_t value;
+    memcpy(&value, m_values.data() + row * sizeof(value), sizeof(value));
+    return value;
+}
+
+double microjson::JsonColumn::doubleAt(size_t row) const {
+    double value;
+    memcpy(&value, m_values.data() + row * sizeof(value), sizeof(value));
+    return value;
+}
+
+bool microjson::JsonColumn::boolAt(size_t row) const {
+    return (m_values[row >> 3] & (1 << (row & 7))) != 0;
+}
+
+std::string microjson::JsonColumn::stringAt(size_t row) const {
+    return std::string(reinterpret_cast<const char *>(m_values.data()) + m_offsets[row], m_offsets[row + 1] - m_offsets[row]);
+}
+
+bool microjson::shredJsonRows(const char *buffer, size_t size, const std::vector<JsonColumnField> &fields,
+                              std::vector<JsonColumn> &columns, size_t threads) {
+    columns.clear();
+    std::vector<detail::RowRange> rows;
+    return detail::collectRows(buffer, size, SIZE_MAX, rows) && detail::shredRows(buffer, rows, fields, columns, threads);
+}
+
+std::vector<microjson::JsonColumnField> microjson::inferJsonColumns(const char *buffer, size_t size, size_t rows) {
+    struct Candidate {
+        JsonColumnField field;
+        bool conflict;
+    };
+
+    std::vector<Candidate> candidates;
+    std::vector<detail::RowRange> ranges;
+    std::vector<JsonProperty> properties;
+    detail::collectRows(buffer, size, rows, ranges);
+    for (const auto &range : ranges) {
+        const char *data = buffer + range.begin;
+        size_t count = 0;
+        if (!detail::parseRow(data, range.size, properties, count)) {
+            continue;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            const JsonProperty &property = properties[i];
+            const char *value = data + property.valueBegin;
+            const size_t valueSize = property.valueSize();
+            JsonColumnType type = JsonColumnString;
+            bool nested = false;
+            int64_t integer = 0;
+            switch (property.type) {
+            case JsonNumberType:
+                type = parseJsonNumber(value, valueSize, integer) ? JsonColumnInt64 : JsonColumnDouble;
+                break;
+            case JsonBoolType:
+                type = JsonColumnBool;
+                break;
+            case JsonStringType:
+                break;
+            default:
+                if (property.type == JsonObjectType && value[0] == 'n') {
+                    continue;//null fits any column
+                }
+                nested = true;
+                break;
+            }
+
+            const std::string name(data + property.nameBegin, property.nameSize());
+            auto it = std::find_if(candidates.begin(), candidates.end(), [&name](const Candidate &candidate) {
+                return candidate.field.name == name;
+            });
+            if (it == candidates.end()) {
+                candidates.push_back({{name, type}, nested});
+                continue;
+            }
+
+            JsonColumnType &known = it->field.type;
+            if (nested) {
+                it->conflict = true;
+            } else if (known != type) {
+                const bool numbers = (known == JsonColumnInt64 || known == JsonColumnDouble)
+                        && (type == JsonColumnInt64 || type == JsonColumnDouble);
+                if (numbers) {
+                    known = JsonColumnDouble;
+                } else {
+                    it->conflict = true;
+                }
+            }
+        }
+    }
+
+    std::vector<JsonColumnField> fields;
+    for (const auto &candidate : candidates) {
+        if (!candidate.conflict) {
+            fields.push_back(candidate.field);
+        }
+    }
+    return fields;
+}
@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+namespace microjson {
+
+enum JsonColumnType {
+    JsonColumnInt64,
+    JsonColumnDouble,
+    JsonColumnBool,
+    JsonColumnString
+};
+
+struct JsonColumnField {
+    std::string name;//Raw member name, escape sequences are not decoded
+    JsonColumnType type;
+};
+
+//Column in Arrow layout: validity bitmap with a bit per row, least significant bit first and set
+//for present values, values buffer of int64 or double, bit-packed booleans, or UTF-8 string data
+//with size() + 1 int32 offsets. Missing members, null and values of other types are null.
+class JsonColumn {
+public:
+    MICROJSON_INLINE JsonColumn(const std::string &name, JsonColumnType type);
+
+    const std::string &name() const {
+        return m_name;
+    }
+
+    JsonColumnType type() const {
+        return m_type;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    size_t nullCount() const {
+        return m_nullCount;
+    }
+
+    const std::vector<uint8_t> &validity() const {
+        return m_validity;
+    }
+
+    const std::vector<uint8_t> &values() const {
+        return m_values;
+    }
+
+    //Empty for other than string columns
+    const std::vector<int32_t> &offsets() const {
+        return m_offsets;
+    }
+
+    bool isNull(size_t row) const {
+        return (m_validity[row >> 3] & (1 << (row & 7))) == 0;
+    }
+
+    MICROJSON_INLINE int64_t int64At(size_t row) const;
+    MICROJSON_INLINE double doubleAt(size_t row) const;
+    MICROJSON_INLINE bool boolAt(size_t row) const;
+    MICROJSON_INLINE std::string stringAt(size_t row) const;
+
+private:
+    friend class JsonColumnWriter;
+
+    std::string m_name;
+    JsonColumnType m_type;
+    size_t m_size;
+    size_t m_nullCount;
+    std::vector<uint8_t> m_validity;
+    std::vector<uint8_t> m_values;
+    std::vector<int32_t> m_offsets;
+};
+
+//Shreds rows into columns of listed fields. Input is either array of objects or newline delimited
+//objects, empty lines are skipped. Members that are not listed are skipped without conversion,
+//the last of duplicated members is used. Rows are split into chunks shredded on threads threads,
+//0 uses hardware concurrency. Returns false and leaves columns empty if a row is not an object or
+//string data of a column exceeds 2GiB.
+MICROJSON_EXTERN bool shredJsonRows(const char *buffer, size_t size, const std::vector<JsonColumnField> &fields,
+                                    std::vector<JsonColumn> &columns, size_t threads = 0);
+
+//Infers fields from scalar members of the first rows in order of appearance. Integers mixed with
+//other numbers make double columns, members with nested values or conflicting types are skipped.
+MICROJSON_EXTERN std::vector<JsonColumnField> inferJsonColumns(const char *buffer, size_t size, size_t rows = 1000);
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+    #include "microjsoncolumns.cpp"
+#endif
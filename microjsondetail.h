@@ -0,0 +1,202 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+#include <string.h>
+
+//SWAR predicates and scanners shared by the library modules, not a part of public API
+namespace microjson {
+namespace detail {
+const uint64_t LowBytes = 0x0101010101010101ull;
+const uint64_t HighBits = 0x8080808080808080ull;
+
+//Non zero if any byte of word is '"', '\\', a control character or not ASCII
+inline uint64_t stringSpecialBytes(uint64_t word) {
+    const uint64_t quote = word ^ (LowBytes * '"');
+    const uint64_t backslash = word ^ (LowBytes * '\\');
+    return ((quote - LowBytes) & ~quote) | ((backslash - LowBytes) & ~backslash) | ((word - LowBytes * 0x20) & ~word) | word;
+}
+
+//Non zero high bit of the first '"' or '\\' byte of word
+inline uint64_t quoteOrBackslashBytes(uint64_t word) {
+    const uint64_t quote = word ^ (LowBytes * '"');
+    const uint64_t backslash = word ^ (LowBytes * '\\');
+    return ((quote - LowBytes) & ~quote) | ((backslash - LowBytes) & ~backslash);
+}
+
+//Non zero high bit of the first '"' or whitespace byte of word
+inline uint64_t quoteOrSpaceBytes(uint64_t word) {
+    const uint64_t quote = word ^ (LowBytes * '"');
+    return ((quote - LowBytes) & ~quote) | ((word - LowBytes * 0x21) & ~word);
+}
+
+//Non zero high bit of the first '"' or bracket byte of word, '[' and ']' differ from '{' and '}' by 0x20
+inline uint64_t structuralBytes(uint64_t word) {
+    const uint64_t quote = word ^ (LowBytes * '"');
+    const uint64_t open = (word | (LowBytes * 0x20)) ^ (LowBytes * '{');
+    const uint64_t close = (word | (LowBytes * 0x20)) ^ (LowBytes * '}');
+    return ((quote - LowBytes) & ~quote) | ((open - LowBytes) & ~open) | ((close - LowBytes) & ~close);
+}
+
+//Moves i over whole words that have no bytes matched by Bytes, the rest is left to the caller
+template<uint64_t (*Bytes)(uint64_t)>
+inline void skipWords(const char *buffer, size_t size, size_t &i) {
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, buffer + i, sizeof(word));
+        if ((Bytes(word) & HighBits) != 0) {
+            break;
+        }
+    }
+}
+
+//Moves i to the closing quote of the string that begins at i
+inline bool skipString(const char *buffer, size_t size, size_t &i) {
+    for (++i; i < size; ++i) {
+        const char *quote = static_cast<const char *>(memchr(buffer + i, '"', size - i));
+        if (quote == nullptr) {
+            break;
+        }
+
+        i = quote - buffer;
+        size_t escapes = 0;
+        while (buffer[i - escapes - 1] == '\\') {
+            ++escapes;
+        }
+
+        if (escapes % 2 == 0) {
+            return true;
+        }
+    }
+    i = size;
+    return false;
+}
+
+inline void skipWhiteSpaces(const char *buffer, size_t size, size_t &i) {
+    for (; i < size && static_cast<unsigned char>(buffer[i]) <= ' ' && microjson::isJsonWhiteSpace(buffer[i]); ++i);
+}
+
+//Moves i to the last byte of the value that begins at or after i. Only nesting is tracked and
+//the value is not classified, so skipping is allocation free.
+inline bool skipValue(const char *buffer, size_t size, size_t &i) {
+    for(; i < size && microjson::skipWhiteSpace(buffer[i]); ++i);
+    if (i >= size) {
+        return false;
+    }
+
+    switch (buffer[i]) {
+    case '"':
+        return skipString(buffer, size, i);
+    case '{':
+    case '[': {
+        size_t depth = 0;
+        for (; i < size; ++i) {
+            skipWords<structuralBytes>(buffer, size, i);
+            if (i >= size) {
+                break;
+            }
+
+            switch (buffer[i]) {
+            case '"':
+                if (!skipString(buffer, size, i)) {
+                    return false;
+                }
+                break;
+            case '{':
+            case '[':
+                ++depth;
+                break;
+            case '}':
+            case ']':
+                if (--depth == 0) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        return false;
+    }
+    default:
+        break;
+    }
+
+    const size_t begin = i;
+    for (; i < size; ++i) {
+        const char byte = buffer[i];
+        if (byte == ',' || byte == '}' || byte == ']' || microjson::skipWhiteSpace(byte)) {
+            break;
+        }
+    }
+
+    if (i == begin) {
+        return false;
+    }
+    --i;
+    return true;
+}
+
+//Byte order of raw member names, a name goes before names it is a prefix of
+inline int compareNames(const char *name1, size_t size1, const char *name2, size_t size2) {
+    const int result = memcmp(name1, name2, size1 < size2 ? size1 : size2);
+    return result != 0 ? result : (size1 < size2 ? -1 : (size1 > size2 ? 1 : 0));
+}
+
+//Unescapes pointer segment, RFC 6901 allows only ~0 and ~1 escapes
+inline bool unescapePointerSegment(const std::string &pointer, size_t begin, size_t end, std::string &segment) {
+    segment.clear();
+    for (size_t i = begin; i < end; ++i) {
+        if (pointer[i] != '~') {
+            segment.push_back(pointer[i]);
+            continue;
+        }
+        if (i + 1 == end || (pointer[i + 1] != '0' && pointer[i + 1] != '1')) {
+            return false;
+        }
+        segment.push_back(pointer[++i] == '0' ? '~' : '/');
+    }
+    return true;
+}
+
+//Array index of pointer segment, leading zeros are not allowed
+inline bool parsePointerIndex(const std::string &segment, size_t &index) {
+    if (segment.empty() || segment.size() > 19 || (segment[0] == '0' && segment.size() > 1)) {
+        return false;
+    }
+    index = 0;
+    for (const char byte : segment) {
+        if (byte < '0' || byte > '9') {
+            return false;
+        }
+        index = index * 10 + size_t(byte - '0');
+    }
+    return true;
+}
+}
+}
@@ -0,0 +1,450 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjsondiff.h"
+#include "microjsoncache.h"
+#include "microjsondetail.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace microjson {
+namespace detail {
+//Alignment of arrays falls back to comparing elements by position above this size of table
+const size_t MaxAlignmentCells = 1 << 20;
+
+struct DiffSpan {
+    size_t begin;
+    size_t end;//Past the last byte of value
+    size_t nameBegin;//Raw name of object member without quotes
+    size_t nameSize;
+    size_t order;//Position in parent container
+    uint64_t hash;
+};
+
+inline uint64_t finalizeDiffHash(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    return hash ^ (hash >> 33);
+}
+
+inline uint64_t combineDiffHashes(uint64_t hash, uint64_t value) {
+    return finalizeDiffHash(hash * 0x9e3779b97f4a7c15ull + value);
+}
+
+//First byte of value, '0' for numbers
+inline char diffKind(char byte) {
+    return byte == '{' || byte == '[' || byte == '"' || byte == 't' || byte == 'f' || byte == 'n' ? byte : '0';
+}
+
+//Scans validated text, containers are indexed only when they have to be compared
+class DiffDocument {
+public:
+    DiffDocument(const char *buffer, size_t size) : m_buffer(buffer)
+      , m_size(size) {}
+
+    const char *data() const {
+        return m_buffer;
+    }
+
+    DiffSpan root() const {
+        DiffSpan span = DiffSpan();
+        skipWhiteSpaces(m_buffer, m_size, span.begin);
+        size_t last = span.begin;
+        skipValue(m_buffer, m_size, last);
+        span.end = last + 1;
+        return span;
+    }
+
+    //Appends children of container, members of objects are sorted by name and the last of duplicated
+    //names is kept, same as parseJsonObject
+    void children(const DiffSpan &container, std::vector<DiffSpan> &out) const {
+        const size_t mark = out.size();
+        const bool object = m_buffer[container.begin] == '{';
+        size_t i = container.begin + 1;
+        skipWhiteSpaces(m_buffer, m_size, i);
+        while (m_buffer[i] != (object ? '}' : ']')) {
+            DiffSpan child = DiffSpan();
+            if (object) {
+                child.nameBegin = i + 1;
+                skipString(m_buffer, m_size, i);
+                child.nameSize = i - child.nameBegin;
+                skipWhiteSpaces(m_buffer, m_size, ++i);
+                skipWhiteSpaces(m_buffer, m_size, ++i);//Skip ':'
+            }
+            child.begin = i;
+            skipValue(m_buffer, m_size, i);
+            child.end = ++i;
+            child.order = out.size() - mark;
+            out.push_back(child);
+            skipWhiteSpaces(m_buffer, m_size, i);
+            if (m_buffer[i] == ',') {
+                skipWhiteSpaces(m_buffer, m_size, ++i);
+            }
+        }
+
+        if (object) {
+            std::sort(out.begin() + mark, out.end(), [this](const DiffSpan &member1, const DiffSpan &member2) {
+                const int result = compareNames(member1, *this, member2);
+                return result != 0 ? result < 0 : member1.order < member2.order;
+            });
+            auto last = std::unique(out.rbegin(), out.rend() - mark, [this](const DiffSpan &member1, const DiffSpan &member2) {
+                return compareNames(member1, *this, member2) == 0;
+            });
+            out.erase(out.begin() + mark, last.base());
+        }
+    }
+
+    int compareNames(const DiffSpan &member1, const DiffDocument &document2, const DiffSpan &member2) const {
+        return detail::compareNames(m_buffer + member1.nameBegin, member1.nameSize, document2.m_buffer + member2.nameBegin, member2.nameSize);
+    }
+
+    //Subtree hash that does not depend on formatting and, for unordered objects, on member order
+    uint64_t hash(const DiffSpan &span, bool unorderedObjects, std::vector<DiffSpan> &stack) const {
+        const char kind = diffKind(m_buffer[span.begin]);
+        if (kind != '{' && kind != '[') {
+            return microjson::hashBuffer(m_buffer + span.begin, span.end - span.begin);
+        }
+
+        const size_t mark = stack.size();
+        children(span, stack);
+        for (size_t i = mark; i < stack.size(); ++i) {
+            const uint64_t hash = this->hash(stack[i], unorderedObjects, stack);
+            stack[i].hash = kind == '[' ? hash : finalizeDiffHash(microjson::hashBuffer(m_buffer + stack[i].nameBegin, stack[i].nameSize) ^ hash);
+        }
+        if (kind == '{' && !unorderedObjects) {
+            std::sort(stack.begin() + mark, stack.end(), [](const DiffSpan &member1, const DiffSpan &member2) {
+                return member1.order < member2.order;
+            });
+        }
+
+        uint64_t hash = static_cast<uint64_t>(kind);
+        for (size_t i = mark; i < stack.size(); ++i) {
+            hash = kind == '{' && unorderedObjects ? hash + stack[i].hash : combineDiffHashes(hash, stack[i].hash);
+        }
+        hash = combineDiffHashes(hash, stack.size() - mark);
+        stack.resize(mark);
+        return hash;
+    }
+
+private:
+    const char *m_buffer;
+    size_t m_size;
+};
+
+//Walks both documents together, changes are not collected when changes is null and the walk stops
+//at the first difference
+class Differ {
+public:
+    Differ(const DiffDocument &document1, const DiffDocument &document2, bool unorderedObjects,
+           std::vector<microjson::JsonDiffChange> *changes) : m_document1(document1)
+      , m_document2(document2)
+      , m_unorderedObjects(unorderedObjects)
+      , m_changes(changes) {}
+
+    bool compare(const DiffSpan &span1, const DiffSpan &span2) {
+        if (sameText(span1, span2)) {
+            return true;
+        }
+
+        const char kind = diffKind(m_document1.data()[span1.begin]);
+        if (kind != diffKind(m_document2.data()[span2.begin]) || (kind != '{' && kind != '[')) {
+            return replace(span2);
+        }
+        return kind == '{' ? compareObjects(span1, span2) : compareArrays(span1, span2);
+    }
+
+private:
+    //SIMD memcmp of libc skips identical values without indexing them
+    bool sameText(const DiffSpan &span1, const DiffSpan &span2) const {
+        const size_t size = span1.end - span1.begin;
+        return size == span2.end - span2.begin && memcmp(m_document1.data() + span1.begin, m_document2.data() + span2.begin, size) == 0;
+    }
+
+    bool compareObjects(const DiffSpan &span1, const DiffSpan &span2) {
+        std::vector<DiffSpan> members1;
+        std::vector<DiffSpan> members2;
+        m_document1.children(span1, members1);
+        m_document2.children(span2, members2);
+        if (m_changes == nullptr && members1.size() != members2.size()) {
+            return false;
+        }
+
+        if (!m_unorderedObjects) {
+            std::vector<std::pair<size_t, size_t>> orders;
+            forMembers(members1, members2, [&](size_t i, size_t j) {
+                if (i != SIZE_MAX && j != SIZE_MAX) {
+                    orders.emplace_back(members1[i].order, members2[j].order);
+                }
+            });
+            std::sort(orders.begin(), orders.end());
+            for (size_t i = 1; i < orders.size(); ++i) {
+                if (orders[i].second < orders[i - 1].second) {
+                    return replace(span2);
+                }
+            }
+        }
+
+        bool equal = true;
+        forMembers(members1, members2, [&](size_t i, size_t j) {
+            if (!equal && m_changes == nullptr) {
+                return;
+            }
+
+            const size_t pathSize = m_path.size();
+            if (i == SIZE_MAX) {
+                appendToken(m_document2.data(), members2[j]);
+                equal = add(members2[j]);
+            } else {
+                appendToken(m_document1.data(), members1[i]);
+                if (j == SIZE_MAX) {
+                    equal = remove();
+                } else if (!compare(members1[i], members2[j])) {
+                    equal = false;
+                }
+            }
+            m_path.resize(pathSize);
+        });
+        return equal;
+    }
+
+    //Equal heads and tails are trimmed by text, the rest is aligned by longest common subsequence
+    //of subtree hashes. Changed elements between aligned ones are compared by position.
+    bool compareArrays(const DiffSpan &span1, const DiffSpan &span2) {
+        std::vector<DiffSpan> elements1;
+        std::vector<DiffSpan> elements2;
+        m_document1.children(span1, elements1);
+        m_document2.children(span2, elements2);
+        if (m_changes == nullptr && elements1.size() != elements2.size()) {
+            return false;
+        }
+
+        const size_t common = std::min(elements1.size(), elements2.size());
+        size_t head = 0;
+        for (; head < common && sameText(elements1[head], elements2[head]); ++head);
+        size_t tail = 0;
+        for (; tail < common - head && sameText(elements1[elements1.size() - 1 - tail], elements2[elements2.size() - 1 - tail]); ++tail);
+
+        const DiffSpan *middle1 = elements1.data() + head;
+        const DiffSpan *middle2 = elements2.data() + head;
+        const size_t size1 = elements1.size() - head - tail;
+        const size_t size2 = elements2.size() - head - tail;
+        if (m_changes == nullptr) {
+            for (size_t i = 0; i < size1; ++i) {
+                if (!compare(middle1[i], middle2[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //Suffix table, lengths[i * (size2 + 1) + j] is length of common subsequence of middle1[i..] and middle2[j..]
+        std::vector<uint64_t> hashes1;
+        std::vector<uint64_t> hashes2;
+        std::vector<uint32_t> lengths;
+        const bool align = size1 > 0 && size2 > 0 && (size1 + 1) * (size2 + 1) <= MaxAlignmentCells;
+        if (align) {
+            for (size_t i = 0; i < size1; ++i) {
+                hashes1.push_back(m_document1.hash(middle1[i], m_unorderedObjects, m_stack));
+            }
+            for (size_t j = 0; j < size2; ++j) {
+                hashes2.push_back(m_document2.hash(middle2[j], m_unorderedObjects, m_stack));
+            }
+            lengths.assign((size1 + 1) * (size2 + 1), 0);
+            for (size_t i = size1; i-- > 0;) {
+                for (size_t j = size2; j-- > 0;) {
+                    lengths[i * (size2 + 1) + j] = hashes1[i] == hashes2[j] ? lengths[(i + 1) * (size2 + 1) + j + 1] + 1
+                        : std::max(lengths[(i + 1) * (size2 + 1) + j], lengths[i * (size2 + 1) + j + 1]);
+                }
+            }
+        }
+
+        bool equal = true;
+        size_t index = head;//Position in the array with preceding changes applied
+        size_t i = 0;
+        size_t j = 0;
+        while (i < size1 || j < size2) {
+            if (align && i < size1 && j < size2 && hashes1[i] == hashes2[j]) {
+                equal = compareElement(index++, middle1[i++], middle2[j++]) && equal;
+                continue;
+            }
+
+            //Run of unaligned elements, the first of them are compared in place
+            const size_t begin1 = i;
+            const size_t begin2 = j;
+            while ((i < size1 || j < size2) && !(align && i < size1 && j < size2 && hashes1[i] == hashes2[j])) {
+                if (j < size2 && (i == size1 || !align || lengths[i * (size2 + 1) + j + 1] >= lengths[(i + 1) * (size2 + 1) + j])) {
+                    ++j;
+                } else {
+                    ++i;
+                }
+            }
+            const size_t paired = std::min(i - begin1, j - begin2);
+            for (size_t k = 0; k < paired; ++k) {
+                equal = compareElement(index++, middle1[begin1 + k], middle2[begin2 + k]) && equal;
+            }
+            //Removals at the same index shift the following elements down
+            for (size_t k = begin1 + paired; k < i; ++k) {
+                equal = elementChange(index, nullptr);
+            }
+            for (size_t k = begin2 + paired; k < j; ++k) {
+                equal = elementChange(index++, &middle2[k]);
+            }
+        }
+        return equal;
+    }
+
+    bool compareElement(size_t index, const DiffSpan &element1, const DiffSpan &element2) {
+        const size_t pathSize = m_path.size();
+        appendIndex(index);
+        const bool equal = compare(element1, element2);
+        m_path.resize(pathSize);
+        return equal;
+    }
+
+    //Adds element or removes it when element is null
+    bool elementChange(size_t index, const DiffSpan *element) {
+        const size_t pathSize = m_path.size();
+        appendIndex(index);
+        element != nullptr ? add(*element) : remove();
+        m_path.resize(pathSize);
+        return false;
+    }
+
+    //Calls visit(i, j) for members of both objects merged by name, missing side is SIZE_MAX
+    template<typename Visit>
+    void forMembers(const std::vector<DiffSpan> &members1, const std::vector<DiffSpan> &members2, Visit visit) const {
+        size_t i = 0;
+        size_t j = 0;
+        while (i < members1.size() || j < members2.size()) {
+            const int result = i == members1.size() ? 1 : j == members2.size() ? -1
+                : m_document1.compareNames(members1[i], m_document2, members2[j]);
+            visit(result <= 0 ? i : SIZE_MAX, result >= 0 ? j : SIZE_MAX);
+            i += result <= 0 ? 1 : 0;
+            j += result >= 0 ? 1 : 0;
+        }
+    }
+
+    void appendToken(const char *buffer, const DiffSpan &member) {
+        m_token.clear();
+        if (!microjson::unescapeJsonString(buffer + member.nameBegin, member.nameSize, m_token)) {
+            m_token.assign(buffer + member.nameBegin, member.nameSize);
+        }
+        m_path.push_back('/');
+        for (char byte : m_token) {
+            if (byte == '~') {
+                m_path += "~0";
+            } else if (byte == '/') {
+                m_path += "~1";
+            } else {
+                m_path.push_back(byte);
+            }
+        }
+    }
+
+    void appendIndex(size_t index) {
+        m_path.push_back('/');
+        m_path += std::to_string(index);
+    }
+
+    bool record(microjson::JsonDiffOperation operation, const DiffSpan *span) {
+        if (m_changes != nullptr) {
+            m_changes->push_back({operation, m_path, span != nullptr ? std::string(m_document2.data() + span->begin, span->end - span->begin)
+                                                                     : std::string()});
+        }
+        return false;
+    }
+
+    bool add(const DiffSpan &span) {
+        return record(microjson::JsonDiffAdd, &span);
+    }
+
+    bool remove() {
+        return record(microjson::JsonDiffRemove, nullptr);
+    }
+
+    bool replace(const DiffSpan &span) {
+        return record(microjson::JsonDiffReplace, &span);
+    }
+
+    const DiffDocument &m_document1;
+    const DiffDocument &m_document2;
+    bool m_unorderedObjects;
+    std::vector<microjson::JsonDiffChange> *m_changes;
+    std::vector<DiffSpan> m_stack;
+    std::string m_path;
+    std::string m_token;
+};
+
+inline bool diffJsonCommon(const char *buffer1, size_t size1, const char *buffer2, size_t size2, bool unorderedObjects,
+                           std::vector<microjson::JsonDiffChange> *changes) {
+    if (size1 == size2 && memcmp(buffer1, buffer2, size1) == 0) {
+        return microjson::validateJson(buffer1, size1).valid();
+    }
+    if (!microjson::validateJson(buffer1, size1).valid() || !microjson::validateJson(buffer2, size2).valid()) {
+        return false;
+    }
+
+    const DiffDocument document1(buffer1, size1);
+    const DiffDocument document2(buffer2, size2);
+    Differ differ(document1, document2, unorderedObjects, changes);
+    return differ.compare(document1.root(), document2.root()) || changes != nullptr;
+}
+}
+}
+
+bool microjson::diffJson(const char *buffer1, size_t size1, const char *buffer2, size_t size2,
+                         std::vector<JsonDiffChange> &changes, bool unorderedObjects) {
+    changes.clear();
+    return detail::diffJsonCommon(buffer1, size1, buffer2, size2, unorderedObjects, &changes);
+}
+
+bool microjson::equalJson(const char *buffer1, size_t size1, const char *buffer2, size_t size2, bool unorderedObjects) {
+    return detail::diffJsonCommon(buffer1, size1, buffer2, size2, unorderedObjects, nullptr);
+}
+
+std::string microjson::toJsonPatch(const std::vector<JsonDiffChange> &changes) {
+    static const char *const Operations[] = {"add", "remove", "replace"};
+    std::string patch("[");
+    for (const auto &change : changes) {
+        if (patch.size() > 1) {
+            patch.push_back(',');
+        }
+        patch += "{\"op\":\"";
+        patch += Operations[change.operation];
+        patch += "\",\"path\":";
+        patch += escapeJsonString(change.path.data(), change.path.size());
+        if (change.operation != JsonDiffRemove) {
+            patch += ",\"value\":";
+            patch += change.value;
+        }
+        patch.push_back('}');
+    }
+    patch.push_back(']');
+    return patch;
+}
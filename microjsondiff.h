@@ -0,0 +1,61 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+namespace microjson {
+
+enum JsonDiffOperation {
+    JsonDiffAdd,
+    JsonDiffRemove,
+    JsonDiffReplace
+};
+
+struct JsonDiffChange {
+    JsonDiffOperation operation;
+    std::string path;//JSON pointer, array indices are valid when changes are applied in order
+    std::string value;//New value text for JsonDiffAdd and JsonDiffReplace
+};
+
+//Structural comparison of two JSON buffers without building JsonObject trees. Containers are
+//compared by structure, so whitespace does not matter, scalars are compared by their text.
+//Members are matched by name, the last of duplicated names wins. Unless unorderedObjects is set
+//objects with reordered members are reported as replaced. Byte identical values are skipped by
+//memcmp without being indexed, elements of changed arrays are aligned by subtree hashes, so an
+//insertion is reported as one change. Returns false on malformed input.
+MICROJSON_EXTERN bool diffJson(const char *buffer1, size_t size1, const char *buffer2, size_t size2,
+                               std::vector<JsonDiffChange> &changes, bool unorderedObjects = false);
+//Stops at the first difference, malformed buffers are never equal
+MICROJSON_EXTERN bool equalJson(const char *buffer1, size_t size1, const char *buffer2, size_t size2, bool unorderedObjects = false);
+
+//RFC 6902 patch text that transforms the first buffer of diffJson into the second one
+MICROJSON_EXTERN std::string toJsonPatch(const std::vector<JsonDiffChange> &changes);
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+    #include "microjsondiff.cpp"
+#endif
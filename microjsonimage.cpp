@@ -0,0 +1,475 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjsonimage.h"
+#include "microjsoncache.h"
+#include "microjsondetail.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define MICROJSON_HAS_MMAP
+#endif
+
+namespace microjson {
+namespace detail {
+const char ImageMagic[8] = {'M', 'J', 'S', 'O', 'N', 'I', 'M', 'G'};
+const uint32_t ByteOrderMark = 0x01020304;
+
+//Header layout: magic, version, byte order, image size, checksum of header and tables, source
+//size, source stamp, root value offset, reserved
+const size_t HeaderSize = 56;
+const size_t VersionOffset = 8;
+const size_t ByteOrderOffset = 12;
+const size_t SizeOffset = 16;
+const size_t ChecksumOffset = 24;
+const size_t SourceSizeOffset = 32;
+const size_t SourceStampOffset = 40;
+const size_t RootOffset = 48;
+
+//Value record: type, text offset, text size, children offset, children count. Member record is
+//name offset and name size followed by value record. Members are sorted by name.
+const size_t ValueFields = 5;
+const size_t MemberFields = 7;
+
+template<typename T>
+inline T readField(const char *image, size_t offset) {
+    T value;
+    memcpy(&value, image + offset, sizeof(value));
+    return value;
+}
+
+template<typename T>
+inline void writeField(std::string &image, size_t offset, T value) {
+    memcpy(&image[offset], &value, sizeof(value));
+}
+
+//Source text is not covered, so loading costs the same for long strings and short ones. Text is
+//only reachable through bounds checked records, corrupted text gives wrong values but no faults.
+inline uint64_t imageChecksum(const char *image, size_t root, size_t size) {
+    uint64_t checksum = microjson::hashBuffer(image, ChecksumOffset);
+    checksum = checksum * 0x9fb21c651e98df25ull ^ microjson::hashBuffer(image + SourceSizeOffset, HeaderSize - SourceSizeOffset);
+    return checksum * 0x9fb21c651e98df25ull ^ microjson::hashBuffer(image + root, size - root);
+}
+
+//Writes tables of validated text in a single pass, tables of children are appended before
+//tables of their parents
+class ImageBuilder {
+public:
+    ImageBuilder(const char *buffer, size_t size, std::string &image, size_t textBase) : m_buffer(buffer)
+      , m_size(size)
+      , m_image(image)
+      , m_textBase(textBase) {}
+
+    //Fills value record of value that begins at i, i is moved past the value
+    void value(size_t &i, uint32_t *fields) {
+        const size_t begin = i;
+        const char byte = m_buffer[i];
+        switch (byte) {
+        case '{':
+        case '[': {
+            const bool object = byte == '{';
+            std::vector<Record> records;
+            skipWhiteSpaces(m_buffer, m_size, ++i);
+            while (m_buffer[i] != (object ? '}' : ']')) {
+                Record record;
+                uint32_t *valueFields = record.fields;
+                if (object) {
+                    const size_t nameBegin = i;
+                    skipString(m_buffer, m_size, i);
+                    record.fields[0] = offset(nameBegin + 1);
+                    record.fields[1] = static_cast<uint32_t>(i - nameBegin - 1);
+                    valueFields += 2;
+                    skipWhiteSpaces(m_buffer, m_size, ++i);
+                    skipWhiteSpaces(m_buffer, m_size, ++i);//Skip ':'
+                }
+                value(i, valueFields);
+                records.push_back(record);
+                skipWhiteSpaces(m_buffer, m_size, i);
+                if (m_buffer[i] == ',') {
+                    skipWhiteSpaces(m_buffer, m_size, ++i);
+                }
+            }
+            ++i;
+
+            if (object) {
+                //Equal names keep source order, unique over reversed records leaves the last one
+                std::stable_sort(records.begin(), records.end(), [this](const Record &record1, const Record &record2) {
+                    return compareNames(record1, record2) < 0;
+                });
+                auto last = std::unique(records.rbegin(), records.rend(), [this](const Record &record1, const Record &record2) {
+                    return compareNames(record1, record2) == 0;
+                });
+                records.erase(records.begin(), last.base());
+            }
+
+            fields[0] = object ? microjson::JsonObjectType : microjson::JsonArrayType;
+            fields[3] = static_cast<uint32_t>(m_image.size());
+            fields[4] = static_cast<uint32_t>(records.size());
+            const size_t recordSize = (object ? MemberFields : ValueFields) * sizeof(uint32_t);
+            for (const auto &record : records) {
+                m_image.append(reinterpret_cast<const char *>(record.fields), recordSize);
+            }
+            fields[1] = offset(begin);
+            fields[2] = static_cast<uint32_t>(i - begin);
+        }
+            return;
+        case '"':
+            skipString(m_buffer, m_size, i);
+            ++i;
+            fields[0] = microjson::JsonStringType;
+            fields[1] = offset(begin + 1);
+            fields[2] = static_cast<uint32_t>(i - begin - 2);
+            break;
+        default:
+            skipValue(m_buffer, m_size, i);
+            ++i;
+            fields[0] = byte == 't' || byte == 'f' ? microjson::JsonBoolType : byte == 'n' ? microjson::JsonObjectType : microjson::JsonNumberType;
+            fields[1] = offset(begin);
+            fields[2] = static_cast<uint32_t>(i - begin);
+            break;
+        }
+        fields[3] = 0;
+        fields[4] = 0;
+    }
+
+private:
+    struct Record {
+        uint32_t fields[MemberFields];
+    };
+
+    int compareNames(const Record &record1, const Record &record2) const {
+        return detail::compareNames(m_image.data() + record1.fields[0], record1.fields[1], m_image.data() + record2.fields[0], record2.fields[1]);
+    }
+
+    uint32_t offset(size_t position) const {
+        return static_cast<uint32_t>(m_textBase + position);
+    }
+
+    const char *m_buffer;
+    size_t m_size;
+    std::string &m_image;
+    size_t m_textBase;
+};
+
+inline uint64_t modificationStamp(const struct stat &fileStat) {
+#ifdef __linux__
+    return static_cast<uint64_t>(fileStat.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(fileStat.st_mtim.tv_nsec);
+#else
+    return static_cast<uint64_t>(fileStat.st_mtime);
+#endif
+}
+
+inline bool readFile(const std::string &path, std::string &out) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    char chunk[64 * 1024];
+    size_t read = 0;
+    out.clear();
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        out.append(chunk, read);
+    }
+    const bool failed = ferror(file) != 0;
+    fclose(file);
+    return !failed;
+}
+}
+}
+
+bool microjson::buildJsonImage(const char *buffer, size_t size, std::string &image, uint64_t sourceStamp) {
+    image.clear();
+    if (!validateJson(buffer, size).valid()) {
+        return false;
+    }
+
+    image.reserve(detail::HeaderSize + size + size / 2);
+    image.assign(detail::HeaderSize, '\0');
+    image.append(buffer, size);
+    image.append((4 - image.size() % 4) % 4, '\0');
+
+    //Root record goes first, so its offset is known before tables are written
+    const size_t root = image.size();
+    image.append(detail::ValueFields * sizeof(uint32_t), '\0');
+    detail::ImageBuilder builder(buffer, size, image, detail::HeaderSize);
+    uint32_t fields[detail::ValueFields];
+    size_t i = 0;
+    detail::skipWhiteSpaces(buffer, size, i);
+    builder.value(i, fields);
+    if (image.size() > UINT32_MAX) {
+        image.clear();
+        return false;
+    }
+    memcpy(&image[root], fields, sizeof(fields));
+
+    memcpy(&image[0], detail::ImageMagic, sizeof(detail::ImageMagic));
+    detail::writeField<uint32_t>(image, detail::VersionOffset, JsonImage::Version);
+    detail::writeField<uint32_t>(image, detail::ByteOrderOffset, detail::ByteOrderMark);
+    detail::writeField<uint64_t>(image, detail::SizeOffset, image.size());
+    detail::writeField<uint64_t>(image, detail::SourceSizeOffset, size);
+    detail::writeField<uint64_t>(image, detail::SourceStampOffset, sourceStamp);
+    detail::writeField<uint32_t>(image, detail::RootOffset, static_cast<uint32_t>(root));
+    detail::writeField<uint64_t>(image, detail::ChecksumOffset, detail::imageChecksum(image.data(), root, image.size()));
+    return true;
+}
+
+//Checksum guards against truncated or corrupted files, offsets are checked by refs on access
+bool microjson::JsonImage::load(const char *data, size_t size, bool verifyChecksum) {
+    m_data = nullptr;
+    m_size = 0;
+    if (data == nullptr || size < detail::HeaderSize || size > UINT32_MAX
+            || memcmp(data, detail::ImageMagic, sizeof(detail::ImageMagic)) != 0
+            || detail::readField<uint32_t>(data, detail::VersionOffset) != Version
+            || detail::readField<uint32_t>(data, detail::ByteOrderOffset) != detail::ByteOrderMark
+            || detail::readField<uint64_t>(data, detail::SizeOffset) != size) {
+        return false;
+    }
+
+    const size_t root = detail::readField<uint32_t>(data, detail::RootOffset);
+    if (root < detail::HeaderSize || root > size - detail::ValueFields * sizeof(uint32_t)
+            || (verifyChecksum && detail::readField<uint64_t>(data, detail::ChecksumOffset) != detail::imageChecksum(data, root, size))) {
+        return false;
+    }
+
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+microjson::JsonImageRef microjson::JsonImage::root() const {
+    if (m_data == nullptr) {
+        return JsonImageRef();
+    }
+    return JsonImageRef(m_data, static_cast<uint32_t>(m_size), detail::readField<uint32_t>(m_data, detail::RootOffset));
+}
+
+uint64_t microjson::JsonImage::sourceSize() const {
+    return m_data != nullptr ? detail::readField<uint64_t>(m_data, detail::SourceSizeOffset) : 0;
+}
+
+uint64_t microjson::JsonImage::sourceStamp() const {
+    return m_data != nullptr ? detail::readField<uint64_t>(m_data, detail::SourceStampOffset) : 0;
+}
+
+uint32_t microjson::JsonImageRef::field(size_t index) const {
+    return detail::readField<uint32_t>(m_image, m_offset + index * sizeof(uint32_t));
+}
+
+microjson::JsonType microjson::JsonImageRef::type() const {
+    return m_offset != 0 ? static_cast<JsonType>(field(0)) : JsonInvalidType;
+}
+
+bool microjson::JsonImageRef::isNull() const {
+    return type() == JsonObjectType && dataSize() > 0 && data()[0] == 'n';
+}
+
+//Table of children must lie within the image, otherwise the value has no children
+size_t microjson::JsonImageRef::size() const {
+    if (m_offset == 0) {
+        return 0;
+    }
+
+    const size_t table = field(3);
+    const size_t recordSize = (type() == JsonObjectType ? detail::MemberFields : detail::ValueFields) * sizeof(uint32_t);
+    const size_t count = field(4);
+    return table >= detail::HeaderSize && table <= m_imageSize && count <= (m_imageSize - table) / recordSize ? count : 0;
+}
+
+bool microjson::JsonImageRef::textInBounds() const {
+    return m_offset != 0 && field(1) <= m_imageSize && field(2) <= m_imageSize - field(1);
+}
+
+const char *microjson::JsonImageRef::data() const {
+    return textInBounds() ? m_image + field(1) : nullptr;
+}
+
+size_t microjson::JsonImageRef::dataSize() const {
+    return textInBounds() ? field(2) : 0;
+}
+
+microjson::JsonImageRef microjson::JsonImageRef::operator[](size_t index) const {
+    if (index >= size()) {
+        return JsonImageRef();
+    }
+
+    if (type() == JsonObjectType) {
+        return JsonImageRef(m_image, m_imageSize, static_cast<uint32_t>(field(3) + (index * detail::MemberFields + 2) * sizeof(uint32_t)));
+    }
+    return JsonImageRef(m_image, m_imageSize, static_cast<uint32_t>(field(3) + index * detail::ValueFields * sizeof(uint32_t)));
+}
+
+const char *microjson::JsonImageRef::name(size_t index, size_t &size) const {
+    if (type() != JsonObjectType || index >= this->size()) {
+        size = 0;
+        return nullptr;
+    }
+
+    const size_t member = field(3) + index * detail::MemberFields * sizeof(uint32_t);
+    const size_t name = detail::readField<uint32_t>(m_image, member);
+    size = detail::readField<uint32_t>(m_image, member + sizeof(uint32_t));
+    if (name > m_imageSize || size > m_imageSize - name) {
+        size = 0;
+        return nullptr;
+    }
+    return m_image + name;
+}
+
+microjson::JsonImageRef microjson::JsonImageRef::find(const char *name, size_t size) const {
+    if (type() != JsonObjectType) {
+        return JsonImageRef();
+    }
+
+    size_t low = 0;
+    size_t high = this->size();
+    while (low < high) {
+        const size_t middle = (low + high) / 2;
+        size_t middleSize = 0;
+        const char *middleName = this->name(middle, middleSize);
+        const int result = detail::compareNames(middleName, middleSize, name, size);
+        if (result == 0) {
+            return (*this)[middle];
+        }
+        if (result < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return JsonImageRef();
+}
+
+microjson::JsonImageRef microjson::JsonImageRef::at(const std::string &pointer) const {
+    if (!pointer.empty() && pointer[0] != '/') {
+        return JsonImageRef();
+    }
+
+    JsonImageRef current = *this;
+    std::string token;
+    size_t i = 0;
+    while (i < pointer.size() && current.type() != JsonInvalidType) {
+        size_t end = pointer.find('/', i + 1);
+        end = end != std::string::npos ? end : pointer.size();
+        if (!detail::unescapePointerSegment(pointer, i + 1, end, token)) {
+            return JsonImageRef();
+        }
+        i = end;
+
+        if (current.type() == JsonArrayType) {
+            size_t index = 0;
+            if (!detail::parsePointerIndex(token, index)) {
+                return JsonImageRef();
+            }
+            current = current[index];
+        } else {
+            current = current.find(token);
+        }
+    }
+    return current;
+}
+
+microjson::JsonImageFile::JsonImageFile(const std::string &imagePath, const std::string &sourcePath) : m_mapping(nullptr)
+  , m_mappingSize(0)
+  , m_rebuilt(false)
+{
+    //Image built from unknown source is accepted as is
+    struct stat sourceStat;
+    const bool sourceKnown = stat(sourcePath.c_str(), &sourceStat) == 0;
+    const uint64_t sourceSize = sourceKnown ? static_cast<uint64_t>(sourceStat.st_size) : UINT64_MAX;
+    const uint64_t sourceStamp = sourceKnown ? detail::modificationStamp(sourceStat) : UINT64_MAX;
+    if (map(imagePath, sourceSize, sourceStamp)) {
+        return;
+    }
+
+    std::string text;
+    if (!detail::readFile(sourcePath, text) || !buildJsonImage(text.data(), text.size(), m_buffer, sourceStamp)) {
+        return;
+    }
+    m_image.load(m_buffer.data(), m_buffer.size());
+    m_rebuilt = true;
+
+    //Written next to the target and renamed, so readers never map a partial image
+    const std::string temporaryPath = imagePath + ".tmp";
+    FILE *file = fopen(temporaryPath.c_str(), "wb");
+    if (file == nullptr) {
+        return;
+    }
+    const bool written = fwrite(m_buffer.data(), 1, m_buffer.size(), file) == m_buffer.size();
+    if (fclose(file) != 0 || !written || rename(temporaryPath.c_str(), imagePath.c_str()) != 0) {
+        remove(temporaryPath.c_str());
+    }
+}
+
+microjson::JsonImageFile::~JsonImageFile() {
+    unmap();
+}
+
+bool microjson::JsonImageFile::map(const std::string &imagePath, uint64_t sourceSize, uint64_t sourceStamp) {
+#ifdef MICROJSON_HAS_MMAP
+    const int descriptor = open(imagePath.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+
+    struct stat imageStat;
+    if (fstat(descriptor, &imageStat) == 0 && imageStat.st_size > 0) {
+        m_mappingSize = static_cast<size_t>(imageStat.st_size);
+        m_mapping = mmap(nullptr, m_mappingSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (m_mapping == MAP_FAILED) {
+            m_mapping = nullptr;
+        }
+    }
+    close(descriptor);
+    const bool loaded = m_mapping != nullptr && m_image.load(static_cast<const char *>(m_mapping), m_mappingSize);
+#else
+    const bool loaded = readFile(imagePath, m_buffer) && m_image.load(m_buffer.data(), m_buffer.size());
+#endif
+
+    if (loaded && (sourceSize == UINT64_MAX || (m_image.sourceSize() == sourceSize && m_image.sourceStamp() == sourceStamp))) {
+        return true;
+    }
+    m_image = JsonImage();
+    unmap();
+    return false;
+}
+
+void microjson::JsonImageFile::unmap() {
+#ifdef MICROJSON_HAS_MMAP
+    if (m_mapping != nullptr) {
+        munmap(m_mapping, m_mappingSize);
+    }
+#endif
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    m_buffer.clear();
+}
@@ -0,0 +1,158 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+namespace microjson {
+
+//Navigation handle into JsonImage, refs of missing values have JsonInvalidType. Nothing is parsed
+//or allocated by navigation, only toString and toValue copy text.
+class JsonImageRef {
+public:
+    JsonImageRef() : m_image(nullptr)
+      , m_imageSize(0)
+      , m_offset(0) {}
+    JsonImageRef(const char *image, uint32_t imageSize, uint32_t offset) : m_image(image)
+      , m_imageSize(imageSize)
+      , m_offset(offset) {}
+
+    //null is reported as JsonObjectType, same as for JsonValue
+    MICROJSON_INLINE JsonType type() const;
+    MICROJSON_INLINE bool isNull() const;
+
+    //Number of members or elements
+    MICROJSON_INLINE size_t size() const;
+
+    //Raw text of the value, same as JsonValue::value
+    MICROJSON_INLINE const char *data() const;
+    MICROJSON_INLINE size_t dataSize() const;
+    std::string toString() const {
+        return std::string(data(), dataSize());
+    }
+
+    JsonValue toValue() const {
+        return JsonValue(toString(), type());
+    }
+
+    //Element of array or value of object member, members are ordered by name
+    MICROJSON_INLINE JsonImageRef operator[](size_t index) const;
+    //Raw name of object member
+    MICROJSON_INLINE const char *name(size_t index, size_t &size) const;
+
+    MICROJSON_INLINE JsonImageRef find(const char *name, size_t size) const;
+    JsonImageRef find(const std::string &name) const {
+        return find(name.data(), name.size());
+    }
+
+    //Locates value by JSON pointer (RFC 6901) relative to this value
+    MICROJSON_INLINE JsonImageRef at(const std::string &pointer) const;
+
+private:
+    MICROJSON_INLINE uint32_t field(size_t index) const;
+    MICROJSON_INLINE bool textInBounds() const;
+
+    const char *m_image;
+    uint32_t m_imageSize;
+    uint32_t m_offset;//Offset of value record, 0 for missing values
+};
+
+//Position independent binary image of a parsed document: header with version, byte order and
+//checksum, source text and tables of values with members sorted by name. Offsets are 32-bit,
+//so sources larger than about 3GiB are not supported.
+class JsonImage {
+public:
+    static const uint32_t Version = 2;
+
+    JsonImage() : m_data(nullptr)
+      , m_size(0) {}
+
+    //Verifies header and checksum of header and tables, source text is not hashed. Checksum may be
+    //skipped for trusted images, record offsets are checked on access either way. Data is not
+    //copied and must outlive the image and its refs.
+    MICROJSON_INLINE bool load(const char *data, size_t size, bool verifyChecksum = true);
+
+    bool valid() const {
+        return m_data != nullptr;
+    }
+
+    MICROJSON_INLINE JsonImageRef root() const;
+
+    //Size and caller defined stamp of the source image was built from
+    MICROJSON_INLINE uint64_t sourceSize() const;
+    MICROJSON_INLINE uint64_t sourceStamp() const;
+
+private:
+    const char *m_data;
+    size_t m_size;
+};
+
+//Builds image of validated JSON text, returns false for invalid JSON or too large source
+MICROJSON_EXTERN bool buildJsonImage(const char *buffer, size_t size, std::string &image, uint64_t sourceStamp = 0);
+
+//Image file mapped into memory. When image is missing, corrupted, has different version or its
+//source size or modification time changed, source text is parsed instead and a fresh image is
+//written for the next start.
+class JsonImageFile {
+public:
+    MICROJSON_INLINE JsonImageFile(const std::string &imagePath, const std::string &sourcePath);
+    MICROJSON_INLINE ~JsonImageFile();
+
+    JsonImageFile(const JsonImageFile &) = delete;
+    JsonImageFile &operator=(const JsonImageFile &) = delete;
+
+    bool valid() const {
+        return m_image.valid();
+    }
+
+    //True if source text was parsed because image was not usable
+    bool rebuilt() const {
+        return m_rebuilt;
+    }
+
+    const JsonImage &image() const {
+        return m_image;
+    }
+
+    JsonImageRef root() const {
+        return m_image.root();
+    }
+
+private:
+    MICROJSON_INLINE bool map(const std::string &imagePath, uint64_t sourceSize, uint64_t sourceStamp);
+    MICROJSON_INLINE void unmap();
+
+    JsonImage m_image;
+    void *m_mapping;
+    size_t m_mappingSize;
+    std::string m_buffer;//Image built from source or read without mmap
+    bool m_rebuilt;
+};
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+    #include "microjsonimage.cpp"
+#endif
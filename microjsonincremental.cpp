@@ -0,0 +1,313 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjsonincremental.h"
+#include "microjsondetail.h"
+
+#include <string.h>
+
+microjson::JsonIncrementalDocument::JsonIncrementalDocument(const std::string &text) : m_text(text)
+  , m_root(InvalidNode)
+  , m_rootBegin(0)
+  , m_lastScanSize(0)
+{
+    rebuild();
+}
+
+uint32_t microjson::JsonIncrementalDocument::allocate(JsonType type) {
+    uint32_t node = 0;
+    if (m_freeNodes.empty()) {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.push_back(Node());
+    } else {
+        node = m_freeNodes.back();
+        m_freeNodes.pop_back();
+    }
+    m_nodes[node].size = 0;
+    m_nodes[node].type = type;
+    m_nodes[node].children.clear();
+    m_nodes[node].shifts.clear();
+    return node;
+}
+
+void microjson::JsonIncrementalDocument::release(uint32_t node) {
+    for (const auto &child : m_nodes[node].children) {
+        release(child.node);
+    }
+    m_nodes[node].children.clear();
+    m_nodes[node].shifts.clear();
+    m_freeNodes.push_back(node);
+}
+
+//Shift of child offset is the prefix sum of shifts up to the child
+ptrdiff_t microjson::JsonIncrementalDocument::shift(const Node &node, size_t child) const {
+    ptrdiff_t sum = 0;
+    if (node.shifts.empty()) {
+        return sum;
+    }
+    for (size_t i = child + 1; i > 0; i -= i & (~i + 1)) {
+        sum += node.shifts[i];
+    }
+    return sum;
+}
+
+//Shifts offsets of children from first to the last one
+void microjson::JsonIncrementalDocument::shiftChildren(Node &node, size_t first, ptrdiff_t delta) {
+    if (first >= node.children.size()) {
+        return;
+    }
+    if (node.shifts.empty()) {
+        node.shifts.assign(node.children.size() + 1, 0);
+    }
+    for (size_t i = first + 1; i < node.shifts.size(); i += i & (~i + 1)) {
+        node.shifts[i] += delta;
+    }
+}
+
+//Builds subtree of value that begins at begin in a single pass, end is set past the value
+uint32_t microjson::JsonIncrementalDocument::index(size_t begin, size_t &end) {
+    const char byte = m_text[begin];
+    uint32_t node = InvalidNode;
+    switch (byte) {
+    case '{':
+    case '[': {
+        const bool object = byte == '{';
+        node = allocate(object ? JsonObjectType : JsonArrayType);
+        const char *text = m_text.data();
+        const size_t size = m_text.size();
+        size_t i = begin + 1;
+        detail::skipWhiteSpaces(text, size, i);
+        while (m_text[i] != (object ? '}' : ']')) {
+            Child child;
+            child.nameBegin = SIZE_MAX;
+            child.nameSize = 0;
+            if (object) {
+                const size_t nameBegin = i + 1;
+                detail::skipString(text, size, i);
+                child.nameBegin = nameBegin - begin;
+                child.nameSize = i - nameBegin;
+                detail::skipWhiteSpaces(text, size, ++i);
+                detail::skipWhiteSpaces(text, size, ++i);//Skip ':'
+            }
+
+            child.begin = i - begin;
+            child.node = index(i, i);
+            m_nodes[node].children.push_back(child);
+            detail::skipWhiteSpaces(text, size, i);
+            if (m_text[i] == ',') {
+                detail::skipWhiteSpaces(text, size, ++i);
+            }
+        }
+        end = i + 1;
+    }
+        break;
+    case '"':
+        node = allocate(JsonStringType);
+        end = begin;
+        detail::skipString(m_text.data(), m_text.size(), end);
+        ++end;
+        break;
+    default:
+        node = allocate(byte == 't' || byte == 'f' ? JsonBoolType : byte == 'n' ? JsonObjectType : JsonNumberType);
+        end = begin;
+        detail::skipValue(m_text.data(), m_text.size(), end);
+        ++end;
+        break;
+    }
+
+    m_nodes[node].size = end - begin;
+    return node;
+}
+
+bool microjson::JsonIncrementalDocument::rebuild() {
+    if (m_root != InvalidNode) {
+        release(m_root);
+        m_root = InvalidNode;
+    }
+
+    m_lastScanSize = m_text.size();
+    if (!validateJson(m_text.data(), m_text.size()).valid()) {
+        return false;
+    }
+
+    size_t end = 0;
+    m_rootBegin = 0;
+    detail::skipWhiteSpaces(m_text.data(), m_text.size(), m_rootBegin);
+    m_root = index(m_rootBegin, end);
+    return true;
+}
+
+bool microjson::JsonIncrementalDocument::edit(size_t offset, size_t removed, const char *inserted, size_t insertedSize) {
+    if (offset > m_text.size() || removed > m_text.size() - offset) {
+        return false;
+    }
+
+    m_text.replace(offset, removed, inserted, insertedSize);
+    if (m_root == InvalidNode) {
+        return rebuild();
+    }
+
+    //Path from root to the deepest value that contains edited range
+    struct Step {
+        uint32_t node;
+        size_t begin;//Absolute
+        size_t childIndex;//Index in children of previous step
+    };
+    std::vector<Step> path;
+    const size_t editEnd = offset + (removed > 0 ? removed : 1);
+    auto contains = [&](size_t begin, uint32_t node) {
+        return begin <= offset && editEnd <= begin + m_nodes[node].size;
+    };
+
+    if (!contains(m_rootBegin, m_root)) {
+        return rebuild();
+    }
+    path.push_back(Step{m_root, m_rootBegin, 0});
+    while (true) {
+        const Step &step = path.back();
+        const Node &node = m_nodes[step.node];
+        const size_t relative = offset - step.begin;
+        //Last child that begins at or before the edit
+        size_t low = 0;
+        size_t high = node.children.size();
+        while (low < high) {
+            const size_t middle = low + (high - low) / 2;
+            if (node.children[middle].begin + shift(node, middle) <= relative) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        if (low == 0) {
+            break;
+        }
+        const size_t childIndex = low - 1;
+        const Child &child = node.children[childIndex];
+        const size_t childBegin = step.begin + child.begin + shift(node, childIndex);
+        if (!contains(childBegin, child.node)) {
+            break;
+        }
+        path.push_back(Step{child.node, childBegin, childIndex});
+    }
+
+    const ptrdiff_t delta = static_cast<ptrdiff_t>(insertedSize) - static_cast<ptrdiff_t>(removed);
+    for (size_t level = path.size(); level > 0; --level) {
+        const Step &step = path[level - 1];
+        const size_t size = m_nodes[step.node].size + delta;
+        if (size == 0 || skipWhiteSpace(m_text[step.begin]) || skipWhiteSpace(m_text[step.begin + size - 1])
+                || !validateJson(m_text.data() + step.begin, size).valid()) {
+            continue;
+        }
+
+        m_lastScanSize = size;
+        size_t end = 0;
+        const uint32_t node = index(step.begin, end);
+        release(step.node);
+        if (level == 1) {
+            m_root = node;
+            return true;
+        }
+
+        m_nodes[path[level - 2].node].children[step.childIndex].node = node;
+        for (size_t parentLevel = level - 1; parentLevel > 0 && delta != 0; --parentLevel) {
+            Node &parent = m_nodes[path[parentLevel - 1].node];
+            parent.size += delta;
+            shiftChildren(parent, path[parentLevel].childIndex + 1, delta);
+        }
+        return true;
+    }
+
+    release(m_root);
+    m_root = InvalidNode;
+    m_lastScanSize = m_nodes[path.front().node].size + delta;
+    return false;
+}
+
+bool microjson::JsonIncrementalDocument::find(const std::string &pointer, JsonProperty &property) const {
+    if (m_root == InvalidNode) {
+        return false;
+    }
+
+    uint32_t node = m_root;
+    size_t begin = m_rootBegin;
+    size_t nameBegin = SIZE_MAX;
+    size_t nameSize = 0;
+    std::string segment;
+    size_t position = 0;
+    while (position < pointer.size()) {
+        if (pointer[position] != '/') {
+            return false;
+        }
+
+        const size_t next = pointer.find('/', position + 1);
+        const size_t segmentEnd = next == std::string::npos ? pointer.size() : next;
+        if (!detail::unescapePointerSegment(pointer, position + 1, segmentEnd, segment)) {
+            return false;
+        }
+        position = segmentEnd;
+
+        const Node &current = m_nodes[node];
+        size_t found = SIZE_MAX;
+        if (current.type == JsonObjectType) {
+            for (size_t i = 0; i < current.children.size(); ++i) {
+                const Child &child = current.children[i];
+                if (child.nameSize == segment.size()
+                        && memcmp(m_text.data() + begin + child.nameBegin + shift(current, i), segment.data(), segment.size()) == 0) {
+                    found = i;
+                    break;
+                }
+            }
+        } else if (current.type == JsonArrayType) {
+            size_t index = 0;
+            if (detail::parsePointerIndex(segment, index) && index < current.children.size()) {
+                found = index;
+            }
+        }
+
+        if (found == SIZE_MAX) {
+            return false;
+        }
+
+        const Child &child = current.children[found];
+        const ptrdiff_t childShift = shift(current, found);
+        nameBegin = child.nameBegin == SIZE_MAX ? SIZE_MAX : begin + child.nameBegin + childShift;
+        nameSize = child.nameSize;
+        begin += child.begin + childShift;
+        node = child.node;
+    }
+
+    const Node &value = m_nodes[node];
+    property = JsonProperty();
+    property.type = value.type;
+    property.nameBegin = nameBegin;
+    property.nameEnd = nameBegin == SIZE_MAX ? SIZE_MAX : nameBegin + nameSize;
+    property.valueBegin = begin;
+    property.valueEnd = begin + value.size - 1;
+    if (value.type == JsonStringType) {
+        ++property.valueBegin;
+        --property.valueEnd;
+    }
+    return true;
+}
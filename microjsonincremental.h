@@ -0,0 +1,99 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+namespace microjson {
+
+//Document text with a cached tree of value boundaries. An edit re-scans only the smallest value
+//that encloses it and still is valid JSON after the edit, boundaries of other values are kept and
+//offsets of the following siblings on the path to the root are shifted in logarithmic time.
+//Document must be valid JSON, validateJson rules apply.
+class JsonIncrementalDocument {
+public:
+    MICROJSON_INLINE explicit JsonIncrementalDocument(const std::string &text);
+
+    //Replaces removed bytes at offset with inserted text. Returns false if document is not valid
+    //JSON after the edit, text is edited anyway and is re-scanned fully by the next edit.
+    MICROJSON_INLINE bool edit(size_t offset, size_t removed, const char *inserted, size_t insertedSize);
+
+    bool edit(size_t offset, size_t removed, const std::string &inserted) {
+        return edit(offset, removed, inserted.data(), inserted.size());
+    }
+
+    //Locates value by JSON pointer using cached boundaries, offsets are absolute in text()
+    MICROJSON_INLINE bool find(const std::string &pointer, JsonProperty &property) const;
+
+    const std::string &text() const {
+        return m_text;
+    }
+
+    bool valid() const {
+        return m_root != InvalidNode;
+    }
+
+    //Bytes re-scanned by the last edit
+    size_t lastScanSize() const {
+        return m_lastScanSize;
+    }
+
+private:
+    static const uint32_t InvalidNode = UINT32_MAX;
+
+    struct Child {
+        size_t begin;//Offsets are relative to begin of the parent, shift is not included
+        size_t nameBegin;//SIZE_MAX for array elements
+        size_t nameSize;
+        uint32_t node;
+    };
+
+    struct Node {
+        size_t size;//Including quotes of strings
+        JsonType type;
+        std::vector<Child> children;
+        std::vector<ptrdiff_t> shifts;//Fenwick tree of shifts of children offsets, empty until first shift
+    };
+
+    MICROJSON_INLINE bool rebuild();
+    MICROJSON_INLINE ptrdiff_t shift(const Node &node, size_t child) const;
+    MICROJSON_INLINE void shiftChildren(Node &node, size_t first, ptrdiff_t delta);
+    MICROJSON_INLINE uint32_t index(size_t begin, size_t &end);
+    MICROJSON_INLINE uint32_t allocate(JsonType type);
+    MICROJSON_INLINE void release(uint32_t node);
+
+    std::string m_text;
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_freeNodes;
+    uint32_t m_root;
+    size_t m_rootBegin;
+    size_t m_lastScanSize;
+};
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+    #include "microjsonincremental.cpp"
+#endif
@@ -0,0 +1,552 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjsoningest.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#ifdef MICROJSON_HAS_IO_URING
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <linux/io_uring.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <sys/uio.h>
+    #include <unistd.h>
+#endif
+
+namespace microjson {
+namespace detail {
+//Recycles read buffers, at most count buffers are handed out at a time
+class BufferPool {
+public:
+    BufferPool(size_t count, size_t bufferSize) : m_bufferSize(bufferSize > 0 ? bufferSize : 1)
+      , m_available(count) {}
+
+    std::vector<char> acquire() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this] { return m_available > 0; });
+        --m_available;
+        if (m_buffers.empty()) {
+            return std::vector<char>(m_bufferSize);
+        }
+
+        std::vector<char> buffer = std::move(m_buffers.back());
+        m_buffers.pop_back();
+        return buffer;
+    }
+
+    void release(std::vector<char> &&buffer) {
+        //Buffers grown for a large file are not kept
+        if (buffer.size() > 4 * m_bufferSize) {
+            buffer.resize(m_bufferSize);
+            buffer.shrink_to_fit();
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffers.push_back(std::move(buffer));
+        ++m_available;
+        m_condition.notify_one();
+    }
+
+private:
+    size_t m_bufferSize;
+    size_t m_available;
+    std::vector<std::vector<char>> m_buffers;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+inline void parseFile(const char *buffer, size_t size, microjson::JsonObject &object, microjson::JsonError &error) {
+    size_t i = 0;
+    for (; i < size && microjson::skipWhiteSpace(buffer[i]); ++i);
+    if (i == size || buffer[i] != '{' || !microjson::isValidJson(buffer, size)) {
+        object.clear();
+        error = microjson::JsonSyntaxError;
+        return;
+    }
+    object = microjson::parseJsonObject(buffer, size);
+    error = microjson::JsonNoError;
+}
+
+inline bool readFile(const std::string &path, std::vector<char> &buffer, size_t &size) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    size = 0;
+    while (true) {
+        if (size == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+        const size_t requested = buffer.size() - size;
+        const size_t readSize = fread(buffer.data() + size, 1, requested, file);
+        size += readSize;
+        if (readSize < requested) {
+            break;
+        }
+    }
+
+    const bool ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+
+inline void ingestWithThreads(const std::vector<std::string> &paths, std::vector<microjson::JsonObject> &objects,
+                              std::vector<microjson::JsonError> &errors, size_t threads, size_t bufferSize) {
+    BufferPool pool(threads, bufferSize);
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        std::vector<char> buffer = pool.acquire();
+        for (size_t i = next++; i < paths.size(); i = next++) {
+            size_t size = 0;
+            if (readFile(paths[i], buffer, size)) {
+                parseFile(buffer.data(), size, objects[i], errors[i]);
+            }
+        }
+        pool.release(std::move(buffer));
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+}
+
+#ifdef MICROJSON_HAS_IO_URING
+//Minimal io_uring wrapper over raw system calls, so liburing is not required
+class IoUring {
+public:
+    IoUring() : m_fd(-1)
+      , m_sq(nullptr)
+      , m_cq(nullptr)
+      , m_sqes(nullptr)
+      , m_sqSize(0)
+      , m_cqSize(0)
+      , m_sqesSize(0)
+      , m_sqTail(0)
+      , m_pending(0) {}
+
+    ~IoUring() {
+        if (m_sqes != nullptr) {
+            munmap(m_sqes, m_sqesSize);
+        }
+        if (m_cq != nullptr && m_cq != m_sq) {
+            munmap(m_cq, m_cqSize);
+        }
+        if (m_sq != nullptr) {
+            munmap(m_sq, m_sqSize);
+        }
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    bool init(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (m_fd < 0) {
+            return false;
+        }
+
+        m_sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            m_sqSize = m_cqSize = m_sqSize > m_cqSize ? m_sqSize : m_cqSize;
+        }
+
+        m_sq = map(m_sqSize, IORING_OFF_SQ_RING);
+        m_cq = singleMap ? m_sq : map(m_cqSize, IORING_OFF_CQ_RING);
+        m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = static_cast<io_uring_sqe *>(map(m_sqesSize, IORING_OFF_SQES));
+        if (m_sq == nullptr || m_cq == nullptr || m_sqes == nullptr) {
+            return false;
+        }
+
+        char *sq = static_cast<char *>(m_sq);
+        m_sqHeadPtr = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+        m_sqTailPtr = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+        m_sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+        m_sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+        m_sqEntries = params.sq_entries;
+        m_sqTail = *m_sqTailPtr;
+
+        char *cq = static_cast<char *>(m_cq);
+        m_cqHeadPtr = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+        m_cqTailPtr = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+        m_cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    unsigned entries() const {
+        return m_sqEntries;
+    }
+
+    bool readv(int fd, iovec *iov, uint64_t offset, uint64_t userData) {
+        io_uring_sqe *sqe = queue();
+        if (sqe == nullptr) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = fd;
+        sqe->off = offset;
+        sqe->addr = reinterpret_cast<uint64_t>(iov);
+        sqe->len = 1;
+        sqe->user_data = userData;
+        return true;
+    }
+
+    //Requests cancellation of the request with targetData, completes with own userData
+    bool cancel(uint64_t targetData, uint64_t userData) {
+        io_uring_sqe *sqe = queue();
+        if (sqe == nullptr) {
+            return false;
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = targetData;
+        sqe->user_data = userData;
+        return true;
+    }
+
+    //Submits queued reads and waits for at least waitCount completions
+    bool submit(unsigned waitCount) {
+        __atomic_store_n(m_sqTailPtr, m_sqTail, __ATOMIC_RELEASE);
+        while (true) {
+            const long submitted = syscall(__NR_io_uring_enter, m_fd, m_pending, waitCount,
+                                           waitCount > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (submitted >= 0) {
+                m_pending -= static_cast<unsigned>(submitted);
+                return true;
+            }
+            if (errno != EINTR) {
+                return false;
+            }
+        }
+    }
+
+    template<typename F>
+    void reap(F f) {
+        unsigned head = *m_cqHeadPtr;
+        const unsigned tail = __atomic_load_n(m_cqTailPtr, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            const io_uring_cqe &cqe = m_cqes[head & m_cqMask];
+            f(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(m_cqHeadPtr, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    io_uring_sqe *queue() {
+        const unsigned head = __atomic_load_n(m_sqHeadPtr, __ATOMIC_ACQUIRE);
+        if (m_sqTail - head >= m_sqEntries) {
+            return nullptr;
+        }
+
+        const unsigned index = m_sqTail & m_sqMask;
+        io_uring_sqe *sqe = m_sqes + index;
+        memset(sqe, 0, sizeof(*sqe));
+        m_sqArray[index] = index;
+        ++m_sqTail;
+        ++m_pending;
+        return sqe;
+    }
+
+    void *map(size_t size, off_t offset) {
+        void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, offset);
+        return address == MAP_FAILED ? nullptr : address;
+    }
+
+    int m_fd;
+    void *m_sq;
+    void *m_cq;
+    io_uring_sqe *m_sqes;
+    size_t m_sqSize;
+    size_t m_cqSize;
+    size_t m_sqesSize;
+
+    unsigned *m_sqHeadPtr;
+    unsigned *m_sqTailPtr;
+    unsigned *m_sqArray;
+    unsigned m_sqMask;
+    unsigned m_sqEntries;
+    unsigned m_sqTail;
+    unsigned m_pending;
+
+    unsigned *m_cqHeadPtr;
+    unsigned *m_cqTailPtr;
+    unsigned m_cqMask;
+    io_uring_cqe *m_cqes;
+};
+
+struct ReadSlot {
+    ReadSlot() : index(0)
+      , fd(-1)
+      , size(0)
+      , cancelled(false) {}
+
+    size_t index;
+    int fd;
+    std::vector<char> buffer;
+    size_t size;//Bytes read so far, a read continues until it returns 0
+    iovec iov;
+    bool cancelled;
+};
+
+struct ParseTask {
+    size_t index;
+    std::vector<char> buffer;
+    size_t size;
+};
+
+//Calling thread opens files and drives io_uring, completed buffers are parsed by worker threads.
+//Indices of files that were not read because the ring failed are stored to retry.
+inline bool ingestWithIoUring(const std::vector<std::string> &paths, std::vector<microjson::JsonObject> &objects,
+                              std::vector<microjson::JsonError> &errors, size_t threads, size_t queueDepth, size_t bufferSize,
+                              std::vector<size_t> &retry) {
+    IoUring ring;
+    if (!ring.init(static_cast<unsigned>(queueDepth))) {
+        return false;
+    }
+
+    const size_t slotCount = ring.entries() < queueDepth ? ring.entries() : queueDepth;
+    BufferPool pool(slotCount + 2 * threads, bufferSize);
+    //Kernel writes into slot buffers and reads slot iovecs until the read completes, slots are
+    //released only after every read in flight is reaped
+    std::unique_ptr<ReadSlot[]> slots(new ReadSlot[slotCount]);
+    std::vector<size_t> freeSlots;
+    for (size_t i = slotCount; i > 0; --i) {
+        freeSlots.push_back(i - 1);
+    }
+
+    std::deque<ParseTask> tasks;
+    bool finished = false;
+    std::mutex mutex;
+    std::condition_variable condition;
+    auto worker = [&]() {
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&] { return finished || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            ParseTask task = std::move(tasks.front());
+            tasks.pop_front();
+            lock.unlock();
+
+            parseFile(task.buffer.data(), task.size, objects[task.index], errors[task.index]);
+            pool.release(std::move(task.buffer));
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(worker);
+    }
+
+    //Completions of cancel requests carry this bit, they only report the outcome of cancellation
+    const uint64_t CancelData = 1ull << 63;
+    bool ok = true;
+    size_t inFlight = 0;
+    auto queueRead = [&](size_t slotIndex) {
+        ReadSlot &slot = slots[slotIndex];
+        if (slot.size == slot.buffer.size()) {
+            slot.buffer.resize(slot.buffer.size() * 2);
+        }
+        slot.iov.iov_base = slot.buffer.data() + slot.size;
+        slot.iov.iov_len = slot.buffer.size() - slot.size;
+        return ring.readv(slot.fd, &slot.iov, slot.size, slotIndex);
+    };
+
+    auto finish = [&](size_t slotIndex, bool read) {
+        ReadSlot &slot = slots[slotIndex];
+        close(slot.fd);
+        slot.fd = -1;
+        freeSlots.push_back(slotIndex);
+        --inFlight;
+        if (!read) {
+            pool.release(std::move(slot.buffer));
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(ParseTask{slot.index, std::move(slot.buffer), slot.size});
+        }
+        condition.notify_one();
+    };
+
+    auto complete = [&](uint64_t userData, int result) {
+        if ((userData & CancelData) != 0) {
+            return;
+        }
+
+        ReadSlot &slot = slots[userData];
+        if (result == -ECANCELED || (result < 0 && !ok)) {
+            retry.push_back(slot.index);
+            finish(userData, false);
+            return;
+        }
+        if (result <= 0) {
+            finish(userData, result == 0);
+            return;
+        }
+
+        //Short read is not the end of file, the rest is read until a read returns 0
+        slot.size += static_cast<size_t>(result);
+        if (!ok || !queueRead(userData)) {
+            retry.push_back(slot.index);
+            finish(userData, false);
+        }
+    };
+
+    size_t next = 0;
+    while (ok && (next < paths.size() || inFlight > 0)) {
+        for (; next < paths.size() && !freeSlots.empty(); ++next) {
+            const int fd = open(paths[next].c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+
+            const size_t slotIndex = freeSlots.back();
+            ReadSlot &slot = slots[slotIndex];
+            slot.index = next;
+            slot.fd = fd;
+            slot.buffer = pool.acquire();
+            slot.size = 0;
+            slot.cancelled = false;
+            if (!queueRead(slotIndex)) {
+                close(fd);
+                slot.fd = -1;
+                pool.release(std::move(slot.buffer));
+                break;
+            }
+            freeSlots.pop_back();
+            ++inFlight;
+        }
+
+        if (inFlight == 0) {
+            break;
+        }
+
+        if (!ring.submit(1)) {
+            ok = false;
+            break;
+        }
+        ring.reap(complete);
+    }
+
+    //Ring failed with reads in flight, they are cancelled and reaped before fds are closed and
+    //buffers are released. Cancelled and failed reads are retried without the ring
+    const int MaxSubmitFailures = 64;
+    for (int failures = 0; !ok && inFlight > 0 && failures < MaxSubmitFailures;) {
+        for (size_t i = 0; i < slotCount; ++i) {
+            if (slots[i].fd >= 0 && !slots[i].cancelled && ring.cancel(i, CancelData | i)) {
+                slots[i].cancelled = true;
+            }
+        }
+        if (!ring.submit(1)) {
+            ++failures;
+        }
+        ring.reap(complete);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    condition.notify_all();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+
+    if (!ok) {
+        if (inFlight > 0) {
+            //Kernel may still write into buffers of reads that could not be reaped, slots are
+            //leaked rather than freed under it. Their fds stay open too, a read that was not
+            //consumed from the queue yet would otherwise read whatever file reuses the fd
+            for (size_t i = 0; i < slotCount; ++i) {
+                if (slots[i].fd >= 0) {
+                    retry.push_back(slots[i].index);
+                }
+            }
+            slots.release();
+        }
+        for (; next < paths.size(); ++next) {
+            retry.push_back(next);
+        }
+    }
+    return true;
+}
+#endif
+}
+}
+
+microjson::JsonIngestBackend microjson::ingestJsonFiles(const std::vector<std::string> &paths, std::vector<JsonObject> &objects,
+                                                        std::vector<JsonError> &errors, const JsonIngestOptions &options) {
+    objects.assign(paths.size(), JsonObject());
+    errors.assign(paths.size(), JsonSyntaxError);
+
+    size_t threads = options.threads > 0 ? options.threads : std::thread::hardware_concurrency();
+    if (threads == 0) {
+        threads = 1;
+    }
+
+#ifdef MICROJSON_HAS_IO_URING
+    if (options.backend != JsonIngestThreadPool) {
+        const size_t queueDepth = options.queueDepth > 0 ? options.queueDepth : 1;
+        std::vector<size_t> retry;
+        if (detail::ingestWithIoUring(paths, objects, errors, threads, queueDepth, options.bufferSize, retry)) {
+            std::vector<char> buffer(options.bufferSize > 0 ? options.bufferSize : 1);
+            for (size_t index : retry) {
+                size_t size = 0;
+                if (detail::readFile(paths[index], buffer, size)) {
+                    detail::parseFile(buffer.data(), size, objects[index], errors[index]);
+                }
+            }
+            return JsonIngestIoUring;
+        }
+    }
+#endif
+
+    detail::ingestWithThreads(paths, objects, errors, threads, options.bufferSize);
+    return JsonIngestThreadPool;
+}
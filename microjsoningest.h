@@ -0,0 +1,61 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+namespace microjson {
+
+enum JsonIngestBackend {
+    JsonIngestAuto,
+    JsonIngestIoUring,//Linux only, reads are batched through io_uring submission queue
+    JsonIngestThreadPool
+};
+
+struct JsonIngestOptions {
+    JsonIngestOptions() : backend(JsonIngestAuto)
+      , threads(0)
+      , queueDepth(64)
+      , bufferSize(64 * 1024) {}
+
+    JsonIngestBackend backend;
+    size_t threads;//Parsing threads, 0 uses hardware concurrency
+    size_t queueDepth;//Reads in flight for io_uring backend
+    size_t bufferSize;//Size of pooled read buffers, larger files grow their buffer
+};
+
+//Reads and parses many small JSON object files. Files are read through io_uring when it is
+//available and parsed on worker threads, otherwise each worker thread reads and parses files
+//on its own. Read buffers are recycled from a pool. objects and errors are resized to the size
+//of paths, unreadable or malformed files get JsonSyntaxError and an empty object.
+//Returns backend that was used.
+MICROJSON_EXTERN JsonIngestBackend ingestJsonFiles(const std::vector<std::string> &paths, std::vector<JsonObject> &objects,
+                                                   std::vector<JsonError> &errors, const JsonIngestOptions &options = JsonIngestOptions());
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+    #include "microjsoningest.cpp"
+#endif
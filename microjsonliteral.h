@@ -0,0 +1,587 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+#if !defined(__cpp_constexpr) || __cpp_constexpr < 201603L
+    #error "microjsonliteral.h requires C++17 constexpr lambdas support"
+#endif
+
+#include <limits>
+#include <string_view>
+
+namespace microjson {
+
+static const size_t MaxLiteralDepth = 64;
+
+//Value of parsed literal, children are linked as siblings in document order
+struct JsonLiteralNode {
+    JsonType type = JsonInvalidType;
+    bool null = false;
+    bool boolean = false;
+    bool integer = false;//Number without fraction and exponent that fits int64_t
+    int64_t intValue = 0;
+    double doubleValue = 0;
+    size_t nameOffset = 0;//Decoded name of object member
+    size_t nameSize = 0;
+    size_t stringOffset = 0;//Decoded string value
+    size_t stringSize = 0;
+    size_t count = 0;
+    size_t firstChild = SIZE_MAX;
+    size_t nextSibling = SIZE_MAX;
+};
+
+//Strict RFC 8259 parser that runs in constant expressions. Without storage it only counts nodes
+//and decoded string bytes, so the storage of the second pass can be sized at compile time. Text
+//that doesn't fit into the storage fails at the value that needs more of it.
+class JsonLiteralParser {
+public:
+    constexpr explicit JsonLiteralParser(std::string_view text) : m_text(text) {}
+    constexpr JsonLiteralParser(std::string_view text, JsonLiteralNode *nodes, size_t nodeCapacity, char *chars, size_t charCapacity) : m_text(text)
+      , m_nodes(nodes)
+      , m_chars(chars)
+      , m_nodeCapacity(nodeCapacity)
+      , m_charCapacity(charCapacity)
+      , m_store(true) {}
+
+    constexpr bool parse() {
+        skipSpaces();
+        value(0);
+        skipSpaces();
+        if (m_error == SIZE_MAX && m_i != m_text.size()) {
+            fail();
+        }
+        return m_error == SIZE_MAX;
+    }
+
+    constexpr size_t nodeCount() const {
+        return m_nodeCount;
+    }
+
+    constexpr size_t charCount() const {
+        return m_charCount;
+    }
+
+    //Offset of the first invalid byte
+    constexpr size_t errorOffset() const {
+        return m_error;
+    }
+
+private:
+    constexpr size_t fail() {
+        if (m_error == SIZE_MAX) {
+            m_error = m_i;
+        }
+        return SIZE_MAX;
+    }
+
+    constexpr void skipSpaces() {
+        for (; m_i < m_text.size() && (m_text[m_i] == ' ' || m_text[m_i] == '\n' || m_text[m_i] == '\r' || m_text[m_i] == '\t'); ++m_i) {}
+    }
+
+    constexpr bool next(char byte) {
+        if (m_i < m_text.size() && m_text[m_i] == byte) {
+            ++m_i;
+            return true;
+        }
+        return false;
+    }
+
+    constexpr size_t allocate(JsonType type) {
+        if (m_store) {
+            if (m_nodeCount >= m_nodeCapacity) {
+                return fail();
+            }
+            m_nodes[m_nodeCount].type = type;
+        }
+        return m_nodeCount++;
+    }
+
+    constexpr void put(char byte) {
+        if (m_store) {
+            if (m_charCount >= m_charCapacity) {
+                fail();
+                return;
+            }
+            m_chars[m_charCount] = byte;
+        }
+        ++m_charCount;
+    }
+
+    constexpr void putCodePoint(uint32_t code) {
+        if (code < 0x80) {
+            put(char(code));
+        } else if (code < 0x800) {
+            put(char(0xc0 | (code >> 6)));
+            put(char(0x80 | (code & 0x3f)));
+        } else if (code < 0x10000) {
+            put(char(0xe0 | (code >> 12)));
+            put(char(0x80 | ((code >> 6) & 0x3f)));
+            put(char(0x80 | (code & 0x3f)));
+        } else {
+            put(char(0xf0 | (code >> 18)));
+            put(char(0x80 | ((code >> 12) & 0x3f)));
+            put(char(0x80 | ((code >> 6) & 0x3f)));
+            put(char(0x80 | (code & 0x3f)));
+        }
+    }
+
+    constexpr bool hex(uint32_t &code) {
+        code = 0;
+        for (int digit = 0; digit < 4; ++digit, ++m_i) {
+            if (m_i >= m_text.size()) {
+                return false;
+            }
+            const char byte = m_text[m_i];
+            code <<= 4;
+            if (byte >= '0' && byte <= '9') {
+                code |= byte - '0';
+            } else if (byte >= 'a' && byte <= 'f') {
+                code |= byte - 'a' + 10;
+            } else if (byte >= 'A' && byte <= 'F') {
+                code |= byte - 'A' + 10;
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //Decodes string that begins at the opening quote, offset is set to the first decoded byte
+    constexpr bool string(size_t &offset, size_t &size) {
+        ++m_i;
+        offset = m_charCount;
+        while (m_i < m_text.size()) {
+            const char byte = m_text[m_i];
+            if (byte == '"') {
+                ++m_i;
+                size = m_charCount - offset;
+                return true;
+            }
+            if (static_cast<unsigned char>(byte) < 0x20) {
+                return false;
+            }
+            if (byte != '\\') {
+                put(byte);
+                ++m_i;
+                continue;
+            }
+
+            if (++m_i >= m_text.size()) {
+                return false;
+            }
+            const char escaped = m_text[m_i++];
+            switch (escaped) {
+            case '"': put('"'); break;
+            case '\\': put('\\'); break;
+            case '/': put('/'); break;
+            case 'b': put('\b'); break;
+            case 'f': put('\f'); break;
+            case 'n': put('\n'); break;
+            case 'r': put('\r'); break;
+            case 't': put('\t'); break;
+            case 'u': {
+                uint32_t code = 0;
+                if (!hex(code) || (code >= 0xdc00 && code <= 0xdfff)) {
+                    return false;
+                }
+                if (code >= 0xd800 && code <= 0xdbff) {
+                    uint32_t low = 0;
+                    if (!next('\\') || !next('u') || !hex(low) || low < 0xdc00 || low > 0xdfff) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                putCodePoint(code);
+            }
+                break;
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    //Decimal digits of a number, up to 19 significant ones fit into mantissa
+    struct Decimal {
+        uint64_t mantissa = 0;
+        int significant = 0;//Leading zeros are not counted
+        bool truncated = false;//Non-zero digits didn't fit into mantissa
+    };
+
+    //Digits that fit are appended to mantissa, the rest are counted in dropped
+    constexpr bool digits(Decimal &decimal, int &appended, int &dropped) {
+        const size_t begin = m_i;
+        for (; m_i < m_text.size() && m_text[m_i] >= '0' && m_text[m_i] <= '9'; ++m_i) {
+            const int digit = m_text[m_i] - '0';
+            if (decimal.significant < 19) {
+                decimal.mantissa = decimal.mantissa * 10 + uint64_t(digit);
+                decimal.significant += decimal.mantissa != 0 ? 1 : 0;
+                ++appended;
+            } else {
+                decimal.truncated = decimal.truncated || digit != 0;
+                ++dropped;
+            }
+        }
+        return m_i > begin;
+    }
+
+    //Mantissa of at most 53 bits and |exponent| <= 22 take a single correctly rounded multiplication
+    //or division by an exact power of ten, so the result is the same as of strtod. Other numbers
+    //are scaled in steps that round each and may differ from strtod in the last bits.
+    constexpr bool number(JsonLiteralNode &node) {
+        const bool negative = next('-');
+        if (m_i >= m_text.size() || m_text[m_i] < '0' || m_text[m_i] > '9'
+                || (m_text[m_i] == '0' && m_i + 1 < m_text.size() && m_text[m_i + 1] >= '0' && m_text[m_i + 1] <= '9')) {
+            return false;
+        }
+
+        Decimal decimal;
+        int appended = 0;
+        int dropped = 0;
+        digits(decimal, appended, dropped);
+        int exponent = dropped;
+        bool integer = dropped == 0;
+        if (next('.')) {
+            appended = 0;
+            dropped = 0;
+            if (!digits(decimal, appended, dropped)) {
+                return false;
+            }
+            exponent -= appended;
+            integer = false;
+        }
+        if (next('e') || next('E')) {
+            const bool negativeExponent = next('-');
+            if (!negativeExponent) {
+                next('+');
+            }
+            const size_t begin = m_i;
+            int explicitExponent = 0;
+            for (; m_i < m_text.size() && m_text[m_i] >= '0' && m_text[m_i] <= '9'; ++m_i) {
+                explicitExponent = explicitExponent < 1000 ? explicitExponent * 10 + (m_text[m_i] - '0') : explicitExponent;
+            }
+            if (m_i == begin) {
+                return false;
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            integer = false;
+        }
+
+        if (integer && decimal.mantissa <= (negative ? uint64_t(INT64_MAX) + 1 : uint64_t(INT64_MAX))) {
+            node.integer = true;
+            node.intValue = negative ? int64_t(0 - decimal.mantissa) : int64_t(decimal.mantissa);
+        }
+
+        double value = double(decimal.mantissa);
+        if (!decimal.truncated && decimal.mantissa <= (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+            value = exponent < 0 ? value / PowersOfTen[-exponent] : value * PowersOfTen[exponent];
+        } else {
+            //Overflow is not a constant expression, too large numbers are infinite like with strtod
+            while (exponent > 0 && value != 0) {
+                const int step = exponent > 22 ? 22 : exponent;
+                if (value > std::numeric_limits<double>::max() / PowersOfTen[step]) {
+                    value = std::numeric_limits<double>::infinity();
+                    break;
+                }
+                value *= PowersOfTen[step];
+                exponent -= step;
+            }
+            while (exponent < 0 && value != 0) {
+                const int step = exponent < -22 ? 22 : -exponent;
+                value /= PowersOfTen[step];
+                exponent += step;
+            }
+        }
+        node.doubleValue = negative ? -value : value;
+        return true;
+    }
+
+    constexpr bool literal(std::string_view expected) {
+        if (m_text.substr(m_i, expected.size()) != expected) {
+            return false;
+        }
+        m_i += expected.size();
+        return true;
+    }
+
+    constexpr size_t value(size_t depth) {
+        if (m_i >= m_text.size() || depth > MaxLiteralDepth) {
+            return fail();
+        }
+
+        const char byte = m_text[m_i];
+        switch (byte) {
+        case '{':
+        case '[': {
+            const bool object = byte == '{';
+            const size_t node = allocate(object ? JsonObjectType : JsonArrayType);
+            if (node == SIZE_MAX) {
+                return SIZE_MAX;
+            }
+            ++m_i;
+            skipSpaces();
+            if (next(object ? '}' : ']')) {
+                return node;
+            }
+
+            size_t previous = SIZE_MAX;
+            while (true) {
+                size_t nameOffset = 0;
+                size_t nameSize = 0;
+                if (object) {
+                    if (m_i >= m_text.size() || m_text[m_i] != '"' || !string(nameOffset, nameSize)) {
+                        return fail();
+                    }
+                    skipSpaces();
+                    if (!next(':')) {
+                        return fail();
+                    }
+                    skipSpaces();
+                }
+
+                const size_t child = value(depth + 1);
+                if (child == SIZE_MAX) {
+                    return SIZE_MAX;
+                }
+                if (m_store) {
+                    m_nodes[child].nameOffset = nameOffset;
+                    m_nodes[child].nameSize = nameSize;
+                    if (previous == SIZE_MAX) {
+                        m_nodes[node].firstChild = child;
+                    } else {
+                        m_nodes[previous].nextSibling = child;
+                    }
+                    ++m_nodes[node].count;
+                }
+                previous = child;
+
+                skipSpaces();
+                if (next(object ? '}' : ']')) {
+                    return node;
+                }
+                if (!next(',')) {
+                    return fail();
+                }
+                skipSpaces();
+            }
+        }
+        case '"': {
+            const size_t node = allocate(JsonStringType);
+            size_t offset = 0;
+            size_t size = 0;
+            if (node == SIZE_MAX || !string(offset, size)) {
+                return fail();
+            }
+            if (m_store) {
+                m_nodes[node].stringOffset = offset;
+                m_nodes[node].stringSize = size;
+            }
+            return node;
+        }
+        case 't':
+        case 'f': {
+            const size_t node = allocate(JsonBoolType);
+            if (node == SIZE_MAX || !literal(byte == 't' ? "true" : "false")) {
+                return fail();
+            }
+            if (m_store) {
+                m_nodes[node].boolean = byte == 't';
+            }
+            return node;
+        }
+        case 'n': {
+            const size_t node = allocate(JsonObjectType);//Same as JsonValue
+            if (node == SIZE_MAX || !literal("null")) {
+                return fail();
+            }
+            if (m_store) {
+                m_nodes[node].null = true;
+            }
+            return node;
+        }
+        default: {
+            const size_t node = allocate(JsonNumberType);
+            JsonLiteralNode scratch;
+            if (node == SIZE_MAX || !number(m_store ? m_nodes[node] : scratch)) {
+                return fail();
+            }
+            return node;
+        }
+        }
+    }
+
+    //Powers of ten that doubles hold exactly
+    static constexpr double PowersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    std::string_view m_text;
+    JsonLiteralNode *m_nodes = nullptr;
+    char *m_chars = nullptr;
+    size_t m_nodeCapacity = 0;
+    size_t m_charCapacity = 0;
+    bool m_store = false;//Counting pass only when false
+    size_t m_i = 0;
+    size_t m_nodeCount = 0;
+    size_t m_charCount = 0;
+    size_t m_error = SIZE_MAX;
+};
+
+//Navigation handle into JsonLiteral, refs of missing values have JsonInvalidType
+class JsonLiteralRef {
+public:
+    constexpr JsonLiteralRef() = default;
+    constexpr JsonLiteralRef(const JsonLiteralNode *nodes, const char *chars, size_t index) : m_nodes(nodes)
+      , m_chars(chars)
+      , m_index(index) {}
+
+    //null is reported as JsonObjectType, same as for JsonValue
+    constexpr JsonType type() const {
+        return m_index != SIZE_MAX ? m_nodes[m_index].type : JsonInvalidType;
+    }
+
+    constexpr bool isNull() const {
+        return m_index != SIZE_MAX && m_nodes[m_index].null;
+    }
+
+    constexpr bool toBool() const {
+        return m_index != SIZE_MAX && m_nodes[m_index].boolean;
+    }
+
+    //Numbers out of int64_t range are saturated
+    constexpr int64_t toInt() const {
+        if (m_index == SIZE_MAX || m_nodes[m_index].integer) {
+            return m_index != SIZE_MAX ? m_nodes[m_index].intValue : 0;
+        }
+
+        const double value = m_nodes[m_index].doubleValue;
+        return value >= 9223372036854775808.0 ? INT64_MAX : value <= -9223372036854775808.0 ? INT64_MIN : int64_t(value);
+    }
+
+    constexpr double toDouble() const {
+        return m_index != SIZE_MAX ? m_nodes[m_index].doubleValue : 0;
+    }
+
+    //Decoded string, empty for other types
+    constexpr std::string_view toString() const {
+        return type() == JsonStringType ? std::string_view(m_chars + m_nodes[m_index].stringOffset, m_nodes[m_index].stringSize)
+                                        : std::string_view();
+    }
+
+    //Name of object member this value belongs to
+    constexpr std::string_view name() const {
+        return m_index != SIZE_MAX ? std::string_view(m_chars + m_nodes[m_index].nameOffset, m_nodes[m_index].nameSize)
+                                  : std::string_view();
+    }
+
+    //Number of members or elements
+    constexpr size_t size() const {
+        return m_index != SIZE_MAX ? m_nodes[m_index].count : 0;
+    }
+
+    //Element of array or object member in document order
+    constexpr JsonLiteralRef operator[](size_t index) const {
+        size_t child = m_index != SIZE_MAX ? m_nodes[m_index].firstChild : SIZE_MAX;
+        for (; child != SIZE_MAX && index > 0; --index) {
+            child = m_nodes[child].nextSibling;
+        }
+        return child != SIZE_MAX ? JsonLiteralRef(m_nodes, m_chars, child) : JsonLiteralRef();
+    }
+
+    //The last of duplicated members is found, same as parseJsonObject keeps
+    constexpr JsonLiteralRef operator[](std::string_view name) const {
+        if (type() != JsonObjectType) {
+            return JsonLiteralRef();
+        }
+
+        size_t found = SIZE_MAX;
+        for (size_t child = m_nodes[m_index].firstChild; child != SIZE_MAX; child = m_nodes[child].nextSibling) {
+            if (std::string_view(m_chars + m_nodes[child].nameOffset, m_nodes[child].nameSize) == name) {
+                found = child;
+            }
+        }
+        return found != SIZE_MAX ? JsonLiteralRef(m_nodes, m_chars, found) : JsonLiteralRef();
+    }
+
+private:
+    const JsonLiteralNode *m_nodes = nullptr;
+    const char *m_chars = nullptr;
+    size_t m_index = SIZE_MAX;
+};
+
+//Immutable document parsed at compile time, constexpr instances are placed in read-only data
+template<size_t Nodes, size_t Chars>
+class JsonLiteral {
+public:
+    constexpr explicit JsonLiteral(std::string_view text) {
+        JsonLiteralParser parser(text, m_nodes, Nodes, m_chars, Chars);
+        m_error = parser.parse() ? SIZE_MAX : parser.errorOffset();
+    }
+
+    constexpr bool valid() const {
+        return m_error == SIZE_MAX;
+    }
+
+    constexpr size_t errorOffset() const {
+        return m_error;
+    }
+
+    constexpr JsonLiteralRef root() const {
+        return valid() ? JsonLiteralRef(m_nodes, m_chars, 0) : JsonLiteralRef();
+    }
+
+    constexpr JsonLiteralRef operator[](std::string_view name) const {
+        return root()[name];
+    }
+
+    constexpr JsonLiteralRef operator[](size_t index) const {
+        return root()[index];
+    }
+
+private:
+    JsonLiteralNode m_nodes[Nodes > 0 ? Nodes : 1] = {};
+    char m_chars[Chars > 0 ? Chars : 1] = {};
+    size_t m_error = SIZE_MAX;
+};
+
+//Source is a constexpr callable returning the text, so the text stays a constant expression
+//inside of the function; MICROJSON_LITERAL wraps a string literal into such callable.
+//Malformed text fails to compile.
+template<typename Source>
+constexpr auto parseJsonLiteral(Source source) {
+    constexpr std::string_view text = source();
+    constexpr JsonLiteralParser counter = [](std::string_view text) {
+        JsonLiteralParser parser(text);
+        parser.parse();
+        return parser;
+    }(text);
+    static_assert(counter.errorOffset() == SIZE_MAX, "Malformed JSON literal");
+    return JsonLiteral<counter.nodeCount(), counter.charCount()>(text);
+}
+}
+
+#define MICROJSON_LITERAL(text) ::microjson::parseJsonLiteral([]() { return std::string_view(text); })
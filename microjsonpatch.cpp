@@ -0,0 +1,329 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjsonpatch.h"
+#include "microjsondetail.h"
+
+#include <algorithm>
+
+microjson::JsonPatch::JsonPatch(const char *buffer, size_t size) : m_buffer(buffer)
+  , m_size(size)
+{
+}
+
+namespace microjson {
+namespace detail {
+//Splits pointer to the pointer of parent and unescaped last token
+inline bool splitPointer(const std::string &pointer, std::string &parent, std::string &token) {
+    const size_t separator = pointer.rfind('/');
+    if (separator == std::string::npos) {
+        return false;
+    }
+
+    parent = pointer.substr(0, separator);
+    return unescapePointerSegment(pointer, separator + 1, pointer.size(), token);
+}
+
+//Appends token to pointer, '~' and '/' are escaped
+inline void appendPointerToken(std::string &pointer, const std::string &token) {
+    pointer += '/';
+    for (const char byte : token) {
+        if (byte == '~') {
+            pointer += "~0";
+        } else if (byte == '/') {
+            pointer += "~1";
+        } else {
+            pointer += byte;
+        }
+    }
+}
+}
+}
+
+//Insertions are ordered before edits that begin at the same position and after earlier insertions
+//there, so each added member keeps its own edit
+bool microjson::JsonPatch::addEdit(size_t begin, size_t end, std::string &&text, size_t container, const std::string &name) {
+    auto it = std::lower_bound(m_edits.begin(), m_edits.end(), begin, [](const Edit &edit, size_t position) {
+        return edit.begin < position || (edit.begin == position && edit.end == position);
+    });
+
+    if (it != m_edits.end() && it->begin == begin && it->end == end && begin != end) {
+        it->text = std::move(text);
+        it->container = container;
+        it->name = name;
+        return true;
+    }
+
+    if ((it != m_edits.end() && it->begin < end) || (it != m_edits.begin() && std::prev(it)->end > begin)) {
+        return false;//Overlaps with another edit, e.g. parent of already patched value
+    }
+
+    m_edits.insert(it, Edit{begin, end, std::move(text), container, name});
+    return true;
+}
+
+bool microjson::JsonPatch::replace(const std::string &pointer, const std::string &json) {
+    JsonProperty property;
+    if (!findJsonValue(m_buffer, m_size, pointer, property)) {
+        return false;
+    }
+
+    size_t begin = property.valueBegin;
+    size_t end = property.valueEnd + 1;
+    if (property.type == JsonStringType) {
+        --begin;//Include quotes
+        ++end;
+    }
+    return addEdit(begin, end, std::string(json));
+}
+
+bool microjson::JsonPatch::replaceString(const std::string &pointer, const std::string &value) {
+    return replace(pointer, escapeJsonString(value.data(), value.size()));
+}
+
+//Removals are merged with removals they overlap, so dropping neighbour members doesn't conflict on
+//the separator between them. Edits inside of removed range are discarded.
+bool microjson::JsonPatch::addRemoval(size_t begin, size_t end) {
+    for (;;) {
+        for (const auto &edit : m_edits) {
+            if (edit.begin >= end) {
+                break;
+            }
+            if (edit.text.empty() && edit.end > begin) {
+                begin = std::min(begin, edit.begin);
+                end = std::max(end, edit.end);
+            }
+        }
+
+        //Range that reaches the closing bracket takes the separator in front of it
+        size_t next = end;
+        detail::skipWhiteSpaces(m_buffer, m_size, next);
+        size_t previous = begin;
+        for (; previous > 0 && isJsonWhiteSpace(m_buffer[previous - 1]); --previous);
+        if (next >= m_size || (m_buffer[next] != '}' && m_buffer[next] != ']')
+                || previous == 0 || m_buffer[previous - 1] != ',') {
+            break;
+        }
+        for (--previous; previous > 0 && isJsonWhiteSpace(m_buffer[previous - 1]); --previous);
+        begin = previous;
+    }
+
+    for (const auto &edit : m_edits) {
+        if (edit.begin < end && edit.end > begin && (edit.begin < begin || edit.end > end)) {
+            return false;
+        }
+    }
+
+    //Insertions at the boundaries are kept
+    m_edits.erase(std::remove_if(m_edits.begin(), m_edits.end(), [begin, end](const Edit &edit) {
+        return edit.begin >= begin && edit.end <= end && edit.begin < end && edit.end > begin;
+    }), m_edits.end());
+    auto it = std::lower_bound(m_edits.begin(), m_edits.end(), begin, [](const Edit &edit, size_t position) {
+        return edit.begin < position || (edit.begin == position && edit.end == position);
+    });
+    m_edits.insert(it, Edit{begin, end, std::string(), SIZE_MAX, std::string()});
+    return true;
+}
+
+bool microjson::JsonPatch::remove(const std::string &pointer) {
+    JsonProperty property;
+    if (pointer.empty() || !findJsonValue(m_buffer, m_size, pointer, property)) {
+        return false;
+    }
+
+    size_t begin = property.nameBegin != SIZE_MAX ? property.nameBegin - 1 : property.valueBegin;
+    size_t end = property.valueEnd + 1;
+    if (property.type == JsonStringType) {
+        end += 1;
+        if (property.nameBegin == SIZE_MAX) {
+            --begin;
+        }
+    }
+
+    size_t next = end;
+    detail::skipWhiteSpaces(m_buffer, m_size, next);
+    if (next < m_size && m_buffer[next] == ',') {
+        //Up to the beginning of the next member
+        detail::skipWhiteSpaces(m_buffer, m_size, ++next);
+        end = next;
+    }
+    return addRemoval(begin, end);
+}
+
+//Looks up member of object that begins at container by the name it has after pending edits. edit is
+//the rename or addition that gives the name, or m_edits.end() with property of untouched member.
+bool microjson::JsonPatch::findMember(const std::string &parentPointer, size_t container, const std::string &name,
+                                      std::vector<Edit>::iterator &edit, JsonProperty &property) {
+    edit = std::find_if(m_edits.begin(), m_edits.end(), [container, &name](const Edit &candidate) {
+        return candidate.container == container && candidate.name == name;
+    });
+    if (edit != m_edits.end()) {
+        return true;
+    }
+
+    std::string pointer = parentPointer;
+    detail::appendPointerToken(pointer, name);
+    if (!findJsonValue(m_buffer, m_size, pointer, property)) {
+        return false;
+    }
+
+    //Renamed and removed members don't have their source name anymore
+    const size_t nameBegin = property.nameBegin - 1;
+    return std::none_of(m_edits.begin(), m_edits.end(), [nameBegin](const Edit &candidate) {
+        return candidate.begin <= nameBegin && candidate.end > nameBegin;
+    });
+}
+
+bool microjson::JsonPatch::rename(const std::string &pointer, const std::string &name) {
+    std::string parentPointer;
+    std::string token;
+    JsonProperty parent;
+    JsonProperty property;
+    if (!detail::splitPointer(pointer, parentPointer, token) || !findJsonValue(m_buffer, m_size, parentPointer, parent)
+            || !findJsonValue(m_buffer, m_size, pointer, property) || property.nameBegin == SIZE_MAX) {
+        return false;
+    }
+
+    std::vector<Edit>::iterator edit;
+    JsonProperty existing;
+    if (name != token && findMember(parentPointer, parent.valueBegin, name, edit, existing)) {
+        return false;
+    }
+    return addEdit(property.nameBegin - 1, property.nameEnd + 1, escapeJsonString(name.data(), name.size()), parent.valueBegin, name);
+}
+
+bool microjson::JsonPatch::add(const std::string &pointer, const std::string &json) {
+    std::string parentPointer;
+    std::string token;
+    JsonProperty parent;
+    if (!detail::splitPointer(pointer, parentPointer, token) || !findJsonValue(m_buffer, m_size, parentPointer, parent)
+            || (parent.type != JsonObjectType && parent.type != JsonArrayType)) {
+        return false;
+    }
+
+    const bool object = parent.type == JsonObjectType;
+    if (!object && token != "-") {
+        return false;
+    }
+
+    std::vector<Edit>::iterator edit;
+    JsonProperty existing;
+    if (object && findMember(parentPointer, parent.valueBegin, token, edit, existing)) {
+        if (edit == m_edits.end()) {
+            return replace(pointer, json);
+        }
+        if (edit->begin == edit->end) {
+            edit->text = (edit->text[0] == ',' ? std::string(",") : std::string()) + escapeJsonString(token.data(), token.size()) + ':' + json;
+            return true;
+        }
+
+        //Value of renamed member follows its name
+        size_t begin = edit->end;
+        detail::skipWhiteSpaces(m_buffer, m_size, begin);
+        detail::skipWhiteSpaces(m_buffer, m_size, ++begin);//Skip ':'
+        size_t last = begin;
+        detail::skipValue(m_buffer, m_size, last);
+        return addEdit(begin, last + 1, std::string(json));
+    }
+
+    //Inserted after the last member, or right after the opening bracket of empty container
+    size_t position = parent.valueEnd;
+    for (; position > parent.valueBegin && isJsonWhiteSpace(m_buffer[position - 1]); --position);
+
+    //Container is empty when every member is removed and nothing is inserted yet
+    bool empty = true;
+    size_t i = parent.valueBegin + 1;
+    for (const auto &edit : m_edits) {
+        if (edit.end < parent.valueBegin + 1 || edit.begin > position) {
+            continue;
+        }
+        if (!edit.text.empty()) {
+            empty = false;
+            break;
+        }
+        for (; empty && i < edit.begin; ++i) {
+            empty = isJsonWhiteSpace(m_buffer[i]);
+        }
+        i = std::max(i, edit.end);
+    }
+    for (; empty && i < position; ++i) {
+        empty = isJsonWhiteSpace(m_buffer[i]);
+    }
+
+    std::string text = empty ? std::string() : std::string(",");
+    if (object) {
+        text += escapeJsonString(token.data(), token.size());
+        text += ':';
+    }
+    text += json;
+    return addEdit(position, position, std::move(text), object ? parent.valueBegin : SIZE_MAX, object ? token : std::string());
+}
+
+std::vector<microjson::JsonSlice> microjson::JsonPatch::slices() const {
+    std::vector<JsonSlice> returnValue;
+    returnValue.reserve(m_edits.size() * 2 + 1);
+    size_t position = 0;
+    for (const auto &edit : m_edits) {
+        if (edit.begin > position) {
+            returnValue.push_back({m_buffer + position, edit.begin - position});
+        }
+        if (!edit.text.empty()) {
+            returnValue.push_back({edit.text.data(), edit.text.size()});
+        }
+        position = edit.end;
+    }
+
+    if (position < m_size) {
+        returnValue.push_back({m_buffer + position, m_size - position});
+    }
+    return returnValue;
+}
+
+#ifdef MICROJSON_HAS_IOVEC
+std::vector<iovec> microjson::JsonPatch::iovecs() const {
+    std::vector<iovec> returnValue;
+    for (const auto &slice : slices()) {
+        returnValue.push_back({const_cast<char *>(slice.data), slice.size});
+    }
+    return returnValue;
+}
+#endif
+
+size_t microjson::JsonPatch::size() const {
+    size_t returnValue = m_size;
+    for (const auto &edit : m_edits) {
+        returnValue = returnValue - (edit.end - edit.begin) + edit.text.size();
+    }
+    return returnValue;
+}
+
+std::string microjson::JsonPatch::toString() const {
+    std::string returnValue;
+    returnValue.reserve(size());
+    for (const auto &slice : slices()) {
+        returnValue.append(slice.data, slice.size);
+    }
+    return returnValue;
+}
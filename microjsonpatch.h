@@ -0,0 +1,100 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <sys/uio.h>
+    #define MICROJSON_HAS_IOVEC
+#endif
+
+namespace microjson {
+
+struct JsonSlice {
+    const char *data;
+    size_t size;
+};
+
+//Rewrites values in place by their byte ranges. Untouched regions of the source buffer are never
+//copied, result is a gather list of source ranges and replacement texts, so forwarding a document
+//with a few members dropped, renamed or added costs only the changed bytes. Source buffer must outlive
+//the patch, slices are valid until the patch is modified.
+class JsonPatch {
+public:
+    MICROJSON_INLINE JsonPatch(const char *buffer, size_t size);
+
+    //Replaces value located by JSON pointer with raw JSON text
+    MICROJSON_INLINE bool replace(const std::string &pointer, const std::string &json);
+    MICROJSON_INLINE bool replaceString(const std::string &pointer, const std::string &value);
+
+    //Drops object member or array element together with its separator
+    MICROJSON_INLINE bool remove(const std::string &pointer);
+    //Renames object member, value is kept as is. Fails if the object has a member with that name
+    //after pending edits.
+    MICROJSON_INLINE bool rename(const std::string &pointer, const std::string &name);
+    //Adds object member or replaces one that has that name after pending edits, "-" as the last
+    //pointer token appends to array
+    MICROJSON_INLINE bool add(const std::string &pointer, const std::string &json);
+
+    MICROJSON_INLINE std::vector<JsonSlice> slices() const;
+#ifdef MICROJSON_HAS_IOVEC
+    //writev ready list of slices
+    MICROJSON_INLINE std::vector<iovec> iovecs() const;
+#endif
+
+    //Size of the patched document
+    MICROJSON_INLINE size_t size() const;
+    MICROJSON_INLINE std::string toString() const;
+
+    void clear() {
+        m_edits.clear();
+    }
+
+private:
+    struct Edit {
+        size_t begin;
+        size_t end;//Past the last replaced byte, equals to begin for insertions
+        std::string text;//Empty for removals
+        size_t container;//Object of renamed or added member, SIZE_MAX for other edits
+        std::string name;//New name of renamed or added member
+    };
+
+    MICROJSON_INLINE bool addEdit(size_t begin, size_t end, std::string &&text, size_t container = SIZE_MAX,
+                                  const std::string &name = std::string());
+    MICROJSON_INLINE bool addRemoval(size_t begin, size_t end);
+    MICROJSON_INLINE bool findMember(const std::string &parentPointer, size_t container, const std::string &name,
+                                     std::vector<Edit>::iterator &edit, JsonProperty &property);
+
+    const char *m_buffer;
+    size_t m_size;
+    std::vector<Edit> m_edits;//Sorted and not overlapping
+};
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+    #include "microjsonpatch.cpp"
+#endif
@@ -0,0 +1,377 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjsonstream.h"
+
+#include <string.h>
+
+#include <chrono>
+
+namespace microjson {
+namespace detail {
+//Short waits are spent yielding, longer ones sleeping, so a stalled stage does not burn a core
+inline void backoff(unsigned &spins) {
+    if (++spins < 64) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+}
+}
+}
+
+microjson::JsonFileSource::~JsonFileSource() {
+    if (m_owned && m_file != nullptr) {
+        fclose(m_file);
+    }
+}
+
+size_t microjson::JsonFileSource::read(char *buffer, size_t size) {
+    return m_file != nullptr ? fread(buffer, 1, size, m_file) : 0;
+}
+
+bool microjson::JsonFileSource::failed() const {
+    return m_file == nullptr || ferror(m_file) != 0;
+}
+
+#ifdef MICROJSON_HAS_ZLIB
+microjson::JsonGzipSource::JsonGzipSource(const std::string &path) : m_file(gzopen(path.c_str(), "rb"))
+  , m_failed(m_file == nullptr)
+{
+    if (m_file != nullptr) {
+        gzbuffer(m_file, 128 * 1024);
+    }
+}
+
+microjson::JsonGzipSource::~JsonGzipSource() {
+    if (m_file != nullptr) {
+        gzclose(m_file);
+    }
+}
+
+size_t microjson::JsonGzipSource::read(char *buffer, size_t size) {
+    if (m_failed) {
+        return 0;
+    }
+
+    const int readSize = gzread(m_file, buffer, static_cast<unsigned>(size));
+    if (readSize < 0) {
+        m_failed = true;
+        return 0;
+    }
+    return static_cast<size_t>(readSize);
+}
+
+bool microjson::JsonGzipSource::failed() const {
+    return m_failed;
+}
+#endif
+
+std::unique_ptr<microjson::JsonStreamSource> microjson::openJsonSource(const std::string &path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return nullptr;
+    }
+
+#ifdef MICROJSON_HAS_ZLIB
+    unsigned char magic[2] = {0, 0};
+    const bool gzip = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && magic[0] == 0x1f && magic[1] == 0x8b;
+    if (gzip) {
+        fclose(file);
+        return std::unique_ptr<JsonStreamSource>(new JsonGzipSource(path));
+    }
+    rewind(file);
+#endif
+    return std::unique_ptr<JsonStreamSource>(new JsonFileSource(file, true));
+}
+
+microjson::JsonBlockRing::JsonBlockRing(size_t blockSize, size_t blockCount) : m_blocks(blockSize * blockCount)
+  , m_sizes(blockCount, 0)
+  , m_blockSize(blockSize)
+  , m_head(0)
+  , m_tail(0)
+  , m_stopped(false)
+{
+}
+
+char *microjson::JsonBlockRing::acquire() {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    unsigned spins = 0;
+    while (tail - m_head.load(std::memory_order_acquire) == m_sizes.size()) {
+        if (m_stopped.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        detail::backoff(spins);
+    }
+    return m_stopped.load(std::memory_order_acquire) ? nullptr : m_blocks.data() + (tail % m_sizes.size()) * m_blockSize;
+}
+
+void microjson::JsonBlockRing::commit(size_t size) {
+    const size_t tail = m_tail.load(std::memory_order_relaxed);
+    m_sizes[tail % m_sizes.size()] = size;
+    m_tail.store(tail + 1, std::memory_order_release);
+}
+
+const char *microjson::JsonBlockRing::front(size_t &size) {
+    const size_t head = m_head.load(std::memory_order_relaxed);
+    unsigned spins = 0;
+    while (head == m_tail.load(std::memory_order_acquire)) {
+        if (m_stopped.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        detail::backoff(spins);
+    }
+
+    const size_t index = head % m_sizes.size();
+    size = m_sizes[index];
+    return m_blocks.data() + index * m_blockSize;
+}
+
+void microjson::JsonBlockRing::release() {
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void microjson::JsonBlockRing::stop() {
+    m_stopped.store(true, std::memory_order_release);
+}
+
+microjson::JsonArrayStream::JsonArrayStream(const std::string &path, size_t chunkSize, size_t chunkCount) :
+    JsonArrayStream(openJsonSource(path), chunkSize, chunkCount)
+{
+}
+
+microjson::JsonArrayStream::JsonArrayStream(FILE *file, size_t chunkSize, size_t chunkCount) :
+    JsonArrayStream(std::unique_ptr<JsonStreamSource>(file != nullptr ? new JsonFileSource(file) : nullptr), chunkSize, chunkCount)
+{
+}
+
+microjson::JsonArrayStream::JsonArrayStream(std::unique_ptr<JsonStreamSource> source, size_t chunkSize, size_t chunkCount) :
+    m_source(std::move(source))
+  , m_ring(chunkSize > 0 ? chunkSize : DefaultChunkSize, chunkCount > 1 ? chunkCount : 2)
+  , m_sourceFailed(false)
+{
+    start();
+}
+
+microjson::JsonArrayStream::~JsonArrayStream() {
+    m_ring.stop();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+void microjson::JsonArrayStream::start() {
+    m_windowOffset = 0;
+    m_position = 0;
+    m_elementBegin = 0;
+    m_elementEnd = 0;
+    m_separator = 0;
+    m_depth = 0;
+    m_count = 0;
+    m_state = BeforeArray;
+    m_stringScope = false;
+    m_escape = false;
+    m_expectElement = false;
+    m_eof = false;
+    m_error = JsonNoError;
+
+    if (!m_source) {
+        m_error = JsonSyntaxError;
+        m_eof = true;
+        return;
+    }
+
+    m_window.reserve(2 * m_ring.blockSize());
+    m_thread = std::thread(&JsonArrayStream::produce, this);
+}
+
+//Producer thread, empty block marks the end of input
+void microjson::JsonArrayStream::produce() {
+    while (char *block = m_ring.acquire()) {
+        const size_t readSize = m_source->read(block, m_ring.blockSize());
+        if (readSize == 0) {
+            m_sourceFailed.store(m_source->failed(), std::memory_order_relaxed);
+        }
+        m_ring.commit(readSize);
+        if (readSize == 0) {
+            return;
+        }
+    }
+}
+
+//Drops consumed bytes and appends the next block to the window
+bool microjson::JsonArrayStream::fill() {
+    if (m_eof) {
+        return false;
+    }
+
+    const size_t keep = m_state == InElement ? m_elementBegin : m_position;
+    if (keep > 0) {
+        const size_t remaining = m_window.size() - keep;
+        if (remaining > 0) {
+            memmove(m_window.data(), m_window.data() + keep, remaining);
+        }
+        m_window.resize(remaining);
+        m_windowOffset += keep;
+        m_position -= keep;
+        m_elementBegin = m_state == InElement ? 0 : m_position;
+        m_elementEnd = m_elementBegin;
+    }
+
+    size_t readSize = 0;
+    const char *block = m_ring.front(readSize);
+    if (block == nullptr || readSize == 0) {
+        m_eof = true;
+        if (m_sourceFailed.load(std::memory_order_relaxed)) {
+            m_error = JsonSyntaxError;
+        }
+        return false;
+    }
+
+    const size_t windowSize = m_window.size();
+    m_window.resize(windowSize + readSize);
+    memcpy(m_window.data() + windowSize, block, readSize);
+    m_ring.release();
+    return true;
+}
+
+bool microjson::JsonArrayStream::fail() {
+    m_error = JsonSyntaxError;
+    m_state = AfterArray;
+    m_elementBegin = m_elementEnd = m_position;
+    return false;
+}
+
+bool microjson::JsonArrayStream::next() {
+    if (m_error != JsonNoError) {
+        return false;
+    }
+
+    while (true) {
+        const char *window = m_window.data();
+        const size_t windowSize = m_window.size();
+        for (; m_position < windowSize; ++m_position) {
+            const char byte = window[m_position];
+            switch (m_state) {
+            case BeforeArray:
+                if (byte == '[') {
+                    m_state = BeforeElement;
+                } else if (!skipWhiteSpace(byte)) {
+                    return fail();
+                }
+                continue;
+            case BeforeElement:
+                if (skipWhiteSpace(byte)) {
+                    continue;
+                }
+                if (byte == ']') {
+                    if (m_expectElement) {
+                        return fail();
+                    }
+                    m_state = AfterArray;
+                    ++m_position;
+                    m_elementBegin = m_elementEnd = m_position;
+                    return false;
+                }
+                if (byte == ',') {
+                    return fail();
+                }
+                m_state = InElement;
+                m_elementBegin = m_position;
+                break;
+            case InElement:
+                break;
+            case AfterArray:
+                if (!skipWhiteSpace(byte)) {
+                    return fail();
+                }
+                continue;
+            }
+
+            if (m_stringScope) {
+                if (m_escape) {
+                    m_escape = false;
+                } else if (byte == '\\') {
+                    m_escape = true;
+                } else if (byte == '"') {
+                    m_stringScope = false;
+                }
+                continue;
+            }
+
+            switch (byte) {
+            case '"':
+                m_stringScope = true;
+                break;
+            case '{':
+            case '[':
+                ++m_depth;
+                break;
+            case '}':
+            case ']':
+                if (m_depth > 0) {
+                    --m_depth;
+                    break;
+                }
+                if (byte == '}') {
+                    return fail();
+                }
+                //fallthrough
+            case ',':
+                if (m_depth > 0) {
+                    break;
+                }
+                m_elementEnd = m_position;
+                for (; m_elementEnd > m_elementBegin && skipWhiteSpace(window[m_elementEnd - 1]); --m_elementEnd);
+                m_separator = m_position;
+                m_expectElement = byte == ',';
+                m_state = byte == ',' ? BeforeElement : AfterArray;
+                ++m_position;
+                ++m_count;
+                return true;
+            default:
+                break;
+            }
+        }
+
+        if (!fill()) {
+            if (m_state != AfterArray) {
+                return fail();
+            }
+            m_elementBegin = m_elementEnd = m_position;
+            return false;
+        }
+    }
+}
+
+microjson::JsonValue microjson::JsonArrayStream::value() const {
+    JsonProperty property;
+    size_t i = 0;
+    //Separator is included, so value is terminated exactly like inside of parseJsonArray
+    if (size() == 0 || !extractValue(m_window.data() + m_elementBegin, m_separator - m_elementBegin + 1, i, ']', property)) {
+        return JsonValue();
+    }
+    return JsonValue(std::string(data() + property.valueBegin, property.valueSize()), property.type);
+}
@@ -0,0 +1,223 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "microjson.h"
+
+#include <stdio.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#ifdef MICROJSON_HAS_ZLIB
+    #include <zlib.h>
+#endif
+
+namespace microjson {
+
+//Sequential byte source, read on the producer thread of a stream
+class JsonStreamSource {
+public:
+    virtual ~JsonStreamSource() = default;
+
+    //Returns number of bytes read, 0 at the end of input or on error
+    virtual size_t read(char *buffer, size_t size) = 0;
+
+    virtual bool failed() const {
+        return false;
+    }
+};
+
+class JsonFileSource : public JsonStreamSource {
+public:
+    //file is not closed by source unless owned
+    explicit JsonFileSource(FILE *file, bool owned = false) : m_file(file)
+      , m_owned(owned) {}
+    MICROJSON_INLINE ~JsonFileSource();
+
+    MICROJSON_INLINE size_t read(char *buffer, size_t size) override;
+    MICROJSON_INLINE bool failed() const override;
+
+private:
+    FILE *m_file;
+    bool m_owned;
+};
+
+#ifdef MICROJSON_HAS_ZLIB
+//Decompresses gzip file, concatenated members are supported
+class JsonGzipSource : public JsonStreamSource {
+public:
+    MICROJSON_INLINE explicit JsonGzipSource(const std::string &path);
+    MICROJSON_INLINE ~JsonGzipSource();
+
+    MICROJSON_INLINE size_t read(char *buffer, size_t size) override;
+    MICROJSON_INLINE bool failed() const override;
+
+private:
+    gzFile m_file;
+    bool m_failed;
+};
+#endif
+
+//Opens file at path, gzip files are decompressed when zlib support is built in.
+//Returns nullptr if file is not readable.
+MICROJSON_EXTERN std::unique_ptr<JsonStreamSource> openJsonSource(const std::string &path);
+
+//Lock-free single producer single consumer ring of fixed size blocks
+class JsonBlockRing {
+public:
+    MICROJSON_INLINE JsonBlockRing(size_t blockSize, size_t blockCount);
+
+    JsonBlockRing(const JsonBlockRing &) = delete;
+    JsonBlockRing &operator=(const JsonBlockRing &) = delete;
+
+    size_t blockSize() const {
+        return m_blockSize;
+    }
+
+    size_t blockCount() const {
+        return m_sizes.size();
+    }
+
+    //Producer side, waits for a free block, returns nullptr once ring is stopped
+    MICROJSON_INLINE char *acquire();
+    MICROJSON_INLINE void commit(size_t size);
+
+    //Consumer side, waits for a filled block, returns nullptr once ring is stopped
+    MICROJSON_INLINE const char *front(size_t &size);
+    MICROJSON_INLINE void release();
+
+    MICROJSON_INLINE void stop();
+
+private:
+    std::vector<char> m_blocks;
+    std::vector<size_t> m_sizes;
+    size_t m_blockSize;
+    alignas(64) std::atomic<size_t> m_head;//Next block to consume
+    alignas(64) std::atomic<size_t> m_tail;//Next block to fill
+    std::atomic<bool> m_stopped;
+};
+
+//Iterates elements of a top-level JSON array without loading the whole input. Source is read on
+//a producer thread into a ring of blocks, while the consumer scans blocks through a sliding window.
+//Memory use is bounded by the largest element plus the ring size.
+class JsonArrayStream {
+public:
+    static constexpr size_t DefaultChunkSize = 1024 * 1024;
+    static constexpr size_t DefaultChunkCount = 4;
+
+    MICROJSON_INLINE explicit JsonArrayStream(const std::string &path, size_t chunkSize = DefaultChunkSize,
+                                              size_t chunkCount = DefaultChunkCount);
+    //file is not closed by stream
+    MICROJSON_INLINE explicit JsonArrayStream(FILE *file, size_t chunkSize = DefaultChunkSize,
+                                              size_t chunkCount = DefaultChunkCount);
+    MICROJSON_INLINE explicit JsonArrayStream(std::unique_ptr<JsonStreamSource> source, size_t chunkSize = DefaultChunkSize,
+                                              size_t chunkCount = DefaultChunkCount);
+    MICROJSON_INLINE ~JsonArrayStream();
+
+    JsonArrayStream(const JsonArrayStream &) = delete;
+    JsonArrayStream &operator=(const JsonArrayStream &) = delete;
+
+    //Moves to next element, returns false at the end of array or on error
+    MICROJSON_INLINE bool next();
+
+    //Raw element text without surrounding whitespace, valid until next call of next()
+    const char *data() const {
+        return m_window.data() + m_elementBegin;
+    }
+
+    size_t size() const {
+        return m_elementEnd - m_elementBegin;
+    }
+
+    //Offset of current element in file
+    size_t offset() const {
+        return m_windowOffset + m_elementBegin;
+    }
+
+    MICROJSON_INLINE JsonValue value() const;
+
+    JsonObject object() const {
+        return parseJsonObject(data(), size());
+    }
+
+    JsonArray array() const {
+        return parseJsonArray(data(), size());
+    }
+
+    //JsonSyntaxError if array is malformed or file is not readable
+    JsonError error() const {
+        return m_error;
+    }
+
+    size_t count() const {
+        return m_count;
+    }
+
+    //Allocated window size, grows only when an element does not fit
+    size_t windowCapacity() const {
+        return m_window.capacity();
+    }
+
+private:
+    enum State {
+        BeforeArray,
+        BeforeElement,
+        InElement,
+        AfterArray
+    };
+
+    MICROJSON_INLINE void start();
+    MICROJSON_INLINE void produce();
+    MICROJSON_INLINE bool fill();
+    MICROJSON_INLINE bool fail();
+
+    std::unique_ptr<JsonStreamSource> m_source;
+    JsonBlockRing m_ring;
+    std::atomic<bool> m_sourceFailed;
+    std::thread m_thread;
+
+    std::vector<char> m_window;
+    size_t m_windowOffset;
+    size_t m_position;
+    size_t m_elementBegin;
+    size_t m_elementEnd;
+    size_t m_separator;
+    size_t m_depth;
+    size_t m_count;
+    State m_state;
+    bool m_stringScope;
+    bool m_escape;
+    bool m_expectElement;
+    bool m_eof;
+    JsonError m_error;
+};
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+    #include "microjsonstream.cpp"
+#endif
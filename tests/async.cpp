@@ -0,0 +1,169 @@
+#include "microjsonasync.h"
+
+#include <string.h>
+#include <gtest/gtest.h>
+
+namespace {
+//Delivers chunks only when the test loop resumes the reader, like an event loop would
+struct ChunkedSource {
+    explicit ChunkedSource(std::vector<std::string> chunks) : chunks(std::move(chunks)) {}
+
+    std::vector<std::string> chunks;
+    size_t index = 0;
+    std::coroutine_handle<> waiting;
+
+    auto read() {
+        struct ReadAwaiter {
+            ChunkedSource &source;
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) noexcept { source.waiting = handle; }
+            std::string_view await_resume() noexcept {
+                return source.index < source.chunks.size() ? std::string_view(source.chunks[source.index++]) : std::string_view();
+            }
+        };
+        return ReadAwaiter{*this};
+    }
+};
+
+struct EventLoop {
+    std::coroutine_handle<> yielded;
+    size_t yields = 0;
+
+    auto yield() {
+        struct YieldAwaiter {
+            EventLoop &loop;
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) noexcept {
+                loop.yielded = handle;
+                ++loop.yields;
+            }
+            void await_resume() noexcept {}
+        };
+        return YieldAwaiter{*this};
+    }
+
+    template<typename Task>
+    void run(Task &task, ChunkedSource &source) {
+        while (!task.handle.done()) {
+            if (yielded) {
+                std::exchange(yielded, nullptr).resume();
+            } else if (source.waiting) {
+                std::exchange(source.waiting, nullptr).resume();
+            } else {
+                FAIL() << "Nothing to resume";
+            }
+        }
+    }
+};
+
+struct Task {
+    struct promise_type {
+        Task get_return_object() { return Task{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    ~Task() { handle.destroy(); }
+    std::coroutine_handle<promise_type> handle;
+};
+
+Task collectProperties(ChunkedSource &source, EventLoop &loop, size_t budget, microjson::JsonObject &obj, microjson::JsonAsyncStatus &result) {
+    auto properties = microjson::parseJsonObjectAsync(source, budget);
+    while (true) {
+        result = co_await properties.next();
+        if (result == microjson::JsonAsyncPending) {
+            co_await loop.yield();
+            continue;
+        }
+        if (result != microjson::JsonAsyncValue) {
+            break;
+        }
+        obj.insert(std::move(properties.value()));
+    }
+}
+
+Task collectValues(ChunkedSource &source, EventLoop &loop, microjson::JsonArray &arr, microjson::JsonAsyncStatus &result) {
+    auto values = microjson::parseJsonArrayAsync(source, 4);
+    while ((result = co_await values.next()) != microjson::JsonAsyncFinished && result != microjson::JsonAsyncFailed) {
+        if (result == microjson::JsonAsyncPending) {
+            co_await loop.yield();
+            continue;
+        }
+        arr.push_back(std::move(values.value()));
+    }
+}
+}
+
+class MicrojsonAsyncTest : public ::testing::Test
+{
+public:
+    MicrojsonAsyncTest() = default;
+};
+
+TEST_F(MicrojsonAsyncTest, ObjectProperties)
+{
+    ChunkedSource source{{" {\"testFi", "eld1\":\"te,}st\\\"\", \"testField2\":[1,{\"a\":", "\"]\"}], \"testField3\":12", ".5}", " "}};
+    EventLoop loop;
+    microjson::JsonObject obj;
+    microjson::JsonAsyncStatus result = microjson::JsonAsyncPending;
+    Task task = collectProperties(source, loop, 8, obj, result);
+    loop.run(task, source);
+
+    EXPECT_EQ(result, microjson::JsonAsyncFinished);
+    EXPECT_GT(loop.yields, 0);
+    ASSERT_EQ(obj.size(), 3);
+    EXPECT_EQ(obj["testField1"].type, microjson::JsonStringType);
+    EXPECT_STREQ(obj["testField1"].value.c_str(), "te,}st\\\"");
+    EXPECT_EQ(obj["testField2"].type, microjson::JsonArrayType);
+    EXPECT_STREQ(obj["testField2"].value.c_str(), "[1,{\"a\":\"]\"}]");
+    EXPECT_EQ(obj["testField3"].type, microjson::JsonNumberType);
+    EXPECT_STREQ(obj["testField3"].value.c_str(), "12.5");
+}
+
+TEST_F(MicrojsonAsyncTest, ArrayValues)
+{
+    ChunkedSource source{{"[1,", "\"two\",tr", "ue,[3]", ",{}]"}};
+    EventLoop loop;
+    microjson::JsonArray arr;
+    microjson::JsonAsyncStatus result = microjson::JsonAsyncPending;
+    Task task = collectValues(source, loop, arr, result);
+    loop.run(task, source);
+
+    EXPECT_EQ(result, microjson::JsonAsyncFinished);
+    ASSERT_EQ(arr.size(), 5);
+    EXPECT_STREQ(arr[1].value.c_str(), "two");
+    EXPECT_EQ(arr[2].type, microjson::JsonBoolType);
+    EXPECT_STREQ(arr[3].value.c_str(), "[3]");
+    EXPECT_STREQ(arr[4].value.c_str(), "{}");
+}
+
+TEST_F(MicrojsonAsyncTest, InvalidInput)
+{
+    ChunkedSource source{{"{\"testField1\":1,", "\"testField2\":"}};
+    EventLoop loop;
+    microjson::JsonObject obj;
+    microjson::JsonAsyncStatus result = microjson::JsonAsyncPending;
+    Task task = collectProperties(source, loop, SIZE_MAX, obj, result);
+    loop.run(task, source);
+    EXPECT_EQ(result, microjson::JsonAsyncFailed);
+    EXPECT_EQ(obj.size(), 1);
+
+    ChunkedSource emptySource{{"{ ", "}"}};
+    obj.clear();
+    Task emptyTask = collectProperties(emptySource, loop, SIZE_MAX, obj, result);
+    loop.run(emptyTask, emptySource);
+    EXPECT_EQ(result, microjson::JsonAsyncFinished);
+    EXPECT_TRUE(obj.empty());
+
+    //Zero budget means no budget
+    ChunkedSource unlimitedSource{{"{\"testField1\":1}"}};
+    obj.clear();
+    loop.yields = 0;
+    Task unlimitedTask = collectProperties(unlimitedSource, loop, 0, obj, result);
+    loop.run(unlimitedTask, unlimitedSource);
+    EXPECT_EQ(result, microjson::JsonAsyncFinished);
+    EXPECT_EQ(loop.yields, 0);
+    EXPECT_EQ(obj.size(), 1);
+}
@@ -0,0 +1,43 @@
+# Smoke test of microjson-grep, run as cmake -DGREP=<path to microjson-grep> -DWORK_DIR=<dir> -P grep.cmake
+
+function(expect_grep expectedResult expectedOutput)
+    execute_process(COMMAND ${GREP} ${ARGN} INPUT_FILE ${INPUT}
+                    RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_QUIET)
+    if(NOT result STREQUAL expectedResult OR NOT output STREQUAL expectedOutput)
+        string(SUBSTRING "${output}" 0 200 output)
+        message(FATAL_ERROR "microjson-grep ${ARGN}: expected ${expectedResult} '${expectedOutput}', got ${result} '${output}'")
+    endif()
+endfunction()
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+set(INPUT ${WORK_DIR}/records.json)
+set(RECORD1 "{\"id\":1,\"s\":\"a\\\\\"}\n")
+set(RECORD2 "{\"id\":2,\"s\":\"b\",\"n\":{\"x\":true}}\n")
+set(RECORD3 "{\"id\":3}\n")
+set(RECORD4 "{\"id\":10,\"s\":\"a\"}\n")
+file(WRITE ${INPUT} "${RECORD1}${RECORD2}\n${RECORD3}${RECORD4}")
+
+expect_grep(0 "${RECORD1}" "s==\"a\\\\\"")
+expect_grep(0 "${RECORD4}" "s==a")
+expect_grep(0 "${RECORD2}${RECORD3}${RECORD4}" "id>=2")
+expect_grep(0 "${RECORD2}${RECORD3}" -m 2 "id>=2")
+expect_grep(0 "${RECORD3}" -v s)
+expect_grep(0 "${RECORD2}" n.x==true -e /id!=1)
+expect_grep(0 "1\n" -c /n/x)
+expect_grep(1 "" "id<0")
+expect_grep(2 "" "id=1")
+expect_grep(2 "" "id==")
+
+# Chunks matched on threads are written in input order
+set(PADDING "")
+string(REPEAT "x" 200 PADDING)
+set(LARGE "")
+foreach(segment RANGE 5)
+    string(REPEAT "{\"id\":${segment},\"pad\":\"${PADDING}\"}\n" 10000 block)
+    string(APPEND LARGE "${block}")
+endforeach()
+file(WRITE ${INPUT} "${LARGE}")
+expect_grep(0 "${LARGE}" -t 4 "id>=0")
+expect_grep(0 "60000\n" -t 4 -c pad)
+expect_grep(0 "{\"id\":5,\"pad\":\"${PADDING}\"}\n" -t 4 -m 1 "id==5")
+file(REMOVE ${INPUT})
@@ -0,0 +1,91 @@
+#include "microjsonliteral.h"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <limits>
+#include <string>
+
+namespace {
+constexpr auto settings = MICROJSON_LITERAL(R"({
+    "name": "grid\u00e9\ud83d\ude00",
+    "size": [1920, 1080],
+    "scale": 1.25e1,
+    "min": -9223372036854775808,
+    "enabled": true,
+    "parent": null,
+    "tags": [],
+    "nested": {"level": {"deep": "\"quoted\"\n"}},
+    "size": [640, 480]
+})");
+
+static_assert(settings.valid(), "");
+static_assert(settings.root().type() == microjson::JsonObjectType, "");
+static_assert(settings["name"].toString() == "grid\xc3\xa9\xf0\x9f\x98\x80", "");
+static_assert(settings["size"].size() == 2 && settings["size"][0].toInt() == 640, "");
+static_assert(settings["scale"].toDouble() == 12.5, "");
+
+//Short decimals are rounded correctly, same as by strtod
+constexpr auto decimals = MICROJSON_LITERAL("[0.0003, 1e-6, 0.000001, 0.1, 123.456, 9007199254740993, 1e22, 1e400, 0.00000000000000000000000123]");
+static_assert(decimals[0].toDouble() == 0.0003 && decimals[1].toDouble() == 1e-6 && decimals[2].toDouble() == 0.000001, "");
+static_assert(decimals[3].toDouble() == 0.1 && decimals[4].toDouble() == 123.456, "");
+static_assert(decimals[5].toInt() == 9007199254740993 && decimals[6].toDouble() == 1e22, "");
+static_assert(decimals[7].toDouble() == std::numeric_limits<double>::infinity() && decimals[8].toDouble() > 1.2e-24, "");
+static_assert(settings["enabled"].toBool(), "");
+static_assert(settings["parent"].isNull(), "");
+static_assert(settings["nested"]["level"]["deep"].toString() == "\"quoted\"\n", "");
+static_assert(settings["missing"].type() == microjson::JsonInvalidType, "");
+
+constexpr microjson::JsonLiteral<4, 0> malformed(R"([1, 2,])");
+static_assert(!malformed.valid() && malformed.errorOffset() == 6, "");
+
+//Storage smaller than the text needs
+constexpr microjson::JsonLiteral<1, 0> fewNodes("[1,2]");
+static_assert(!fewNodes.valid() && fewNodes.errorOffset() == 1, "");
+constexpr microjson::JsonLiteral<2, 1> fewChars(R"(["ab"])");
+static_assert(!fewChars.valid() && fewChars.errorOffset() == 3, "");
+constexpr microjson::JsonLiteral<2, 2> exactStorage(R"(["ab"])");
+static_assert(exactStorage.valid() && exactStorage[0].toString() == "ab", "");
+}
+
+TEST(MicrojsonLiteralTest, Values)
+{
+    EXPECT_EQ(settings.root().size(), 9u);
+    EXPECT_EQ(settings[0].name(), "name");
+    EXPECT_EQ(settings[1].name(), "size");
+    EXPECT_EQ(settings[1][1].toInt(), 1080);
+    EXPECT_EQ(settings["min"].toInt(), INT64_MIN);
+    EXPECT_EQ(settings["scale"].type(), microjson::JsonNumberType);
+    EXPECT_EQ(settings["tags"].type(), microjson::JsonArrayType);
+    EXPECT_EQ(settings["tags"].size(), 0u);
+    EXPECT_EQ(settings["tags"][0].type(), microjson::JsonInvalidType);
+    EXPECT_EQ(settings["size"][5].type(), microjson::JsonInvalidType);
+    EXPECT_FALSE(settings["name"].isNull());
+    EXPECT_EQ(settings["size"]["x"].type(), microjson::JsonInvalidType);
+
+    constexpr auto scalar = MICROJSON_LITERAL(" 0.1 ");
+    EXPECT_EQ(scalar.root().toDouble(), 0.1);
+    EXPECT_EQ(scalar.root().toInt(), 0);
+    constexpr auto large = MICROJSON_LITERAL("[1e19, -1e300, 1e400, 9223372036854775808]");
+    static_assert(large[0].toInt() == INT64_MAX && large[1].toInt() == INT64_MIN, "");
+    EXPECT_EQ(large[2].toInt(), INT64_MAX);
+    EXPECT_EQ(large[3].toInt(), INT64_MAX);
+
+    for (int mantissa = 1; mantissa < 100000; mantissa += 7) {
+        for (int exponent = -22; exponent <= 22; ++exponent) {
+            const std::string text = std::to_string(mantissa) + "e" + std::to_string(exponent);
+            microjson::JsonLiteralNode node;
+            microjson::JsonLiteralParser parser(text, &node, 1, nullptr, 0);
+            ASSERT_TRUE(parser.parse()) << text;
+            ASSERT_EQ(node.doubleValue, strtod(text.c_str(), nullptr)) << text;
+        }
+    }
+
+    const char *invalid[] = { "", "{", "[1 2]", "{\"a\" 1}", "01", "1.", "-", "1e", "tru", "\"\\x\"", "\"\\ud800\"",
+                              "\"\x01\"", "[1] x", "{\"a\":1,}" };
+    for (const char *text : invalid) {
+        microjson::JsonLiteralParser parser(text);
+        EXPECT_FALSE(parser.parse()) << text;
+    }
+}
@@ -0,0 +1,9 @@
+#include "microjsonliteral.h"
+
+//Must not compile, checked by microjson_literal_malformed_test
+constexpr auto malformed = MICROJSON_LITERAL(R"({"a": [1, 2,]})");
+
+int main()
+{
+    return malformed.valid() ? 0 : 1;
+}
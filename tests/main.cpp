@@ -1,9 +1,51 @@
 #include "microjson.h"
-
+#include "microjsoncache.h"
+#include "microjsonpatch.h"
+#include "microjsonstream.h"
+#include "microjsoningest.h"
+#include "microjsonincremental.h"
+#include "microjsonimage.h"
+#include "microjsoncolumns.h"
+#include "microjsondiff.h"
+
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <new>
+#include <thread>
+#include <unistd.h>
+#include <locale.h>
+#include <stdlib.h>
 #include <string.h>
 #include <gtest/gtest.h>
 
+namespace {
+std::atomic<size_t> allocationCount(0);
+}
+
+//Counts heap allocations of the whole test binary, tests compare the counter around calls
+void *operator new(size_t size) {
+    ++allocationCount;
+    void *memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    ++allocationCount;
+    return malloc(size > 0 ? size : 1);
+}
+
+void operator delete(void *memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    free(memory);
+}
+
 class MicrojsonDeserializationTest : public ::testing::Test
 {
 public:
@@ -826,3 +868,1309 @@ TEST_F(MicrojsonDeserializationTest, TestInvalidValues) {
     EXPECT_EQ(it->second.type, microjson::JsonStringType);
     EXPECT_STREQ(it->second.value.c_str(), "-Infinity");
 }
+
+TEST_F(MicrojsonDeserializationTest, ProjectionValues) {
+    const char *buffer1 = "{\"skipped1\":{\"testField1\":\"}\\\"{[\",\"nested\":[1,{\"a\":\"]\"}]},\"testField1\":\"test1\","
+                          "\"skipped2\":[\"[[\",\"\\\\\"], \"testField2\" : 12.5 ,\"skipped3\":true,\"testField3\":[1,2]}";
+    size_t size = strlen(buffer1);
+    microjson::JsonProjection projection{"testField1", "testField2", "testField3", "missingField"};
+    microjson::JsonObject obj = microjson::parseJsonObject(buffer1, size, projection);
+    ASSERT_EQ(obj.size(), 3);
+    auto it = obj.find("testField1");
+    ASSERT_TRUE(it != obj.end());
+    EXPECT_EQ(it->second.type, microjson::JsonStringType);
+    EXPECT_STREQ(it->second.value.c_str(), "test1");
+
+    it = obj.find("testField2");
+    ASSERT_TRUE(it != obj.end());
+    EXPECT_EQ(it->second.type, microjson::JsonNumberType);
+    EXPECT_STREQ(it->second.value.c_str(), "12.5");
+
+    it = obj.find("testField3");
+    ASSERT_TRUE(it != obj.end());
+    EXPECT_EQ(it->second.type, microjson::JsonArrayType);
+    EXPECT_STREQ(it->second.value.c_str(), "[1,2]");
+
+    microjson::JsonArray values = microjson::getMany(buffer1, size, {"testField3", "missingField", "testField1"});
+    ASSERT_EQ(values.size(), 3);
+    EXPECT_EQ(values[0].type, microjson::JsonArrayType);
+    EXPECT_STREQ(values[0].value.c_str(), "[1,2]");
+    EXPECT_EQ(values[1].type, microjson::JsonInvalidType);
+    EXPECT_EQ(values[2].type, microjson::JsonStringType);
+    EXPECT_STREQ(values[2].value.c_str(), "test1");
+
+    const char *duplicates = "{\"testField1\":1,\"testField1\":2}";
+    values = microjson::getMany(duplicates, strlen(duplicates), projection);
+    EXPECT_STREQ(values[0].value.c_str(), "2");
+    EXPECT_STREQ(microjson::parseJsonObject(duplicates, strlen(duplicates), projection)["testField1"].value.c_str(), "2");
+
+    const char *buffer2 = "{\"skipped\":-1,\"testField1\":false}";
+    size = strlen(buffer2);
+    values = microjson::getMany(buffer2, size, projection);
+    ASSERT_EQ(values.size(), 4);
+    EXPECT_EQ(values[0].type, microjson::JsonBoolType);
+    EXPECT_STREQ(values[0].value.c_str(), "false");
+    EXPECT_EQ(values[1].type, microjson::JsonInvalidType);
+}
+
+TEST_F(MicrojsonDeserializationTest, FixedCapacityValues) {
+    const char *buffer1 = " {\"testField1\":\"test1\", \"testField2\":[1,2],\"testField3\":null}";
+    size_t size = strlen(buffer1);
+    microjson::JsonFixedObject<4> obj;
+    ASSERT_EQ(microjson::parseJsonObject(buffer1, size, obj), microjson::JsonNoError);
+    ASSERT_EQ(obj.size, 3);
+    const microjson::JsonProperty *property = obj.find(buffer1, "testField2", 10);
+    ASSERT_TRUE(property != nullptr);
+    EXPECT_EQ(property->type, microjson::JsonArrayType);
+    EXPECT_EQ(std::string(buffer1 + property->valueBegin, property->valueSize()), "[1,2]");
+    property = obj.find(buffer1, "testField1", 10);
+    ASSERT_TRUE(property != nullptr);
+    EXPECT_EQ(property->type, microjson::JsonStringType);
+    EXPECT_EQ(std::string(buffer1 + property->valueBegin, property->valueSize()), "test1");
+    EXPECT_TRUE(obj.find(buffer1, "testField4", 10) == nullptr);
+
+    microjson::JsonFixedObject<2> smallObj;
+    EXPECT_EQ(microjson::parseJsonObject(buffer1, size, smallObj), microjson::JsonOverflowError);
+    EXPECT_EQ(smallObj.size, 2);
+
+    const char *buffer2 = "{ }";
+    EXPECT_EQ(microjson::parseJsonObject(buffer2, strlen(buffer2), obj), microjson::JsonNoError);
+    EXPECT_EQ(obj.size, 0);
+
+    const char *buffer3 = "{\"testField1\" \"test1\"}";
+    EXPECT_EQ(microjson::parseJsonObject(buffer3, strlen(buffer3), obj), microjson::JsonSyntaxError);
+
+    const char *buffer4 = "[\"test1\",5,{\"testField1\":true}]";
+    size = strlen(buffer4);
+    microjson::JsonFixedArray<3> arr;
+    ASSERT_EQ(microjson::parseJsonArray(buffer4, size, arr), microjson::JsonNoError);
+    ASSERT_EQ(arr.size, 3);
+    EXPECT_EQ(arr.properties[1].type, microjson::JsonNumberType);
+    EXPECT_EQ(std::string(buffer4 + arr.properties[1].valueBegin, arr.properties[1].valueSize()), "5");
+    EXPECT_EQ(arr.properties[2].type, microjson::JsonObjectType);
+    EXPECT_EQ(std::string(buffer4 + arr.properties[2].valueBegin, arr.properties[2].valueSize()), "{\"testField1\":true}");
+}
+
+TEST_F(MicrojsonDeserializationTest, FixedCapacityAllocations) {
+    //Names and values are longer than any small string buffer
+    const std::string buffer1 = "{\"a property name that is long enough\":\"and a value that is long enough too\","
+                                "\"second property name of some length\":[\"element of the array of some length\"]}";
+    microjson::JsonFixedObject<4> obj;
+    microjson::JsonFixedArray<4> arr;
+    const size_t allocations = allocationCount;
+    const microjson::JsonError objectError = microjson::parseJsonObject(buffer1.data(), buffer1.size(), obj);
+    const size_t begin = buffer1.rfind('[');
+    const microjson::JsonError arrayError = microjson::parseJsonArray(buffer1.data() + begin, buffer1.size() - begin - 1, arr);
+    EXPECT_EQ(allocationCount - allocations, 0u);
+    EXPECT_EQ(objectError, microjson::JsonNoError);
+    EXPECT_EQ(obj.size, 2);
+    EXPECT_EQ(arrayError, microjson::JsonNoError);
+    EXPECT_EQ(arr.size, 1);
+}
+
+#ifdef MICROJSON_HEADER_ONLY
+struct ValidatingConfig {
+    using Object = microjson::JsonObject;
+    using Array = microjson::JsonArray;
+    static constexpr bool validate = true;
+};
+
+TEST_F(MicrojsonDeserializationTest, ConfiguredContainers) {
+    struct OrderedConfig {
+        using Object = std::map<std::string, microjson::JsonValue>;
+        using Array = std::vector<microjson::JsonValue>;
+    };
+
+    const char *buffer1 = "{\"testField2\":5,\"testField1\":\"test1\"}";
+    OrderedConfig::Object obj = microjson::parseJsonObject<OrderedConfig>(buffer1, strlen(buffer1));
+    ASSERT_EQ(obj.size(), 2);
+    EXPECT_EQ(obj.begin()->first, "testField1");
+    EXPECT_STREQ(obj.begin()->second.value.c_str(), "test1");
+    const char *array = "[1,\"two\"]";
+    OrderedConfig::Array arr = microjson::parseJsonArray<OrderedConfig>(array, strlen(array));
+    ASSERT_EQ(arr.size(), 2);
+    EXPECT_STREQ(arr[1].value.c_str(), "two");
+
+    const char *buffer2 = "{\"testField1\":01}";
+    EXPECT_EQ(microjson::parseJsonObject<microjson::JsonDefaultConfig>(buffer2, strlen(buffer2)).size(), 1);
+    EXPECT_TRUE(microjson::parseJsonObject<ValidatingConfig>(buffer2, strlen(buffer2)).empty());
+    EXPECT_EQ(microjson::parseJsonObject<ValidatingConfig>(buffer1, strlen(buffer1)).size(), 2);
+    const char *buffer3 = "[1,2,]";
+    EXPECT_TRUE(microjson::parseJsonArray<ValidatingConfig>(buffer3, strlen(buffer3)).empty());
+}
+#endif
+
+TEST_F(MicrojsonDeserializationTest, NumberArrayValues) {
+    const char *buffer1 = "[1, -2.5, 0.125,1e3, 12345678901.5, -0.0000001, 3.14159265358979323846, 1.7976931348623157e308 ]";
+    size_t size = strlen(buffer1);
+    std::vector<double> doubles;
+    ASSERT_TRUE(microjson::parseJsonNumberArray(buffer1, size, doubles));
+    ASSERT_EQ(doubles.size(), 8);
+    EXPECT_EQ(doubles[0], 1.0);
+    EXPECT_EQ(doubles[1], -2.5);
+    EXPECT_EQ(doubles[2], 0.125);
+    EXPECT_EQ(doubles[3], 1000.0);
+    EXPECT_EQ(doubles[4], 12345678901.5);
+    EXPECT_EQ(doubles[5], -0.0000001);
+    EXPECT_EQ(doubles[6], 3.14159265358979323846);
+    EXPECT_EQ(doubles[7], 1.7976931348623157e308);
+
+    std::vector<int64_t> integers;
+    EXPECT_FALSE(microjson::parseJsonNumberArray(buffer1, size, integers));
+    EXPECT_TRUE(integers.empty());
+
+    const char *buffer2 = "[1234567890123, -9223372036854775808, 9223372036854775807, 0]";
+    size = strlen(buffer2);
+    ASSERT_TRUE(microjson::parseJsonNumberArray(buffer2, size, integers));
+    ASSERT_EQ(integers.size(), 4);
+    EXPECT_EQ(integers[0], 1234567890123);
+    EXPECT_EQ(integers[1], INT64_MIN);
+    EXPECT_EQ(integers[2], INT64_MAX);
+    EXPECT_EQ(integers[3], 0);
+
+    const char *buffer3 = "[[1.5,2],[ 3 , 4.25 ],[5,6]]";
+    size = strlen(buffer3);
+    doubles.clear();
+    ASSERT_TRUE(microjson::parseJsonNumberArray(buffer3, size, doubles, 2));
+    ASSERT_EQ(doubles.size(), 6);
+    EXPECT_EQ(doubles[1], 2.0);
+    EXPECT_EQ(doubles[3], 4.25);
+    EXPECT_EQ(doubles[5], 6.0);
+    EXPECT_FALSE(microjson::parseJsonNumberArray(buffer3, size, doubles, 3));
+    EXPECT_FALSE(microjson::parseJsonNumberArray(buffer3, size, doubles));
+    EXPECT_EQ(doubles.size(), 6);
+
+    const char *buffer4 = "[1,2,\"3\",4]";
+    size = strlen(buffer4);
+    doubles.clear();
+    EXPECT_FALSE(microjson::parseJsonNumberArray(buffer4, size, doubles));
+    EXPECT_TRUE(doubles.empty());
+    microjson::JsonArray arr = microjson::parseJsonArray(buffer4, size);
+    EXPECT_EQ(arr.size(), 4);
+
+    const char *buffer5 = "[10,20,30]";
+    size = strlen(buffer5);
+    int64_t values[3];
+    EXPECT_EQ(microjson::parseJsonNumberArray(buffer5, size, values, 3), 3);
+    EXPECT_EQ(values[2], 30);
+    EXPECT_EQ(microjson::parseJsonNumberArray(buffer5, size, values, 2), SIZE_MAX);
+
+    const char *buffer6 = " [ ] ";
+    EXPECT_EQ(microjson::parseJsonNumberArray(buffer6, strlen(buffer6), values, 3), 0);
+}
+
+//Numbers are read and written with '.' whatever locale the application has set
+TEST_F(MicrojsonDeserializationTest, NumbersIgnoreLocale) {
+    const std::string previous = setlocale(LC_NUMERIC, nullptr);
+    const char *locales[] = {"de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "ru_RU.UTF-8"};
+    bool decimalComma = false;
+    for (const char *locale : locales) {
+        if (setlocale(LC_NUMERIC, locale) != nullptr && strcmp(localeconv()->decimal_point, ".") != 0) {
+            decimalComma = true;
+            break;
+        }
+    }
+    if (!decimalComma) {
+        setlocale(LC_NUMERIC, previous.c_str());
+        GTEST_SKIP() << "No locale with decimal comma is installed";
+    }
+
+    //Long mantissa is converted by the slow path
+    const char *buffer1 = "[2.5, 0.1, 1234567890.12345678901234567]";
+    std::vector<double> numbers;
+    const bool parsed = microjson::parseJsonNumberArray(buffer1, strlen(buffer1), numbers);
+    const char *buffer2 = "[0.1,-2.5e-08,0.30000000000000004]";
+    std::vector<uint8_t> msgpack;
+    std::string json;
+    const bool transcoded = microjson::jsonToMessagePack(buffer2, strlen(buffer2), msgpack)
+            && microjson::messagePackToJson(msgpack.data(), msgpack.size(), json);
+    setlocale(LC_NUMERIC, previous.c_str());
+
+    ASSERT_TRUE(parsed);
+    ASSERT_EQ(numbers.size(), 3);
+    EXPECT_EQ(numbers[0], 2.5);
+    EXPECT_EQ(numbers[1], 0.1);
+    EXPECT_EQ(numbers[2], 1234567890.12345678901234567);
+    ASSERT_TRUE(transcoded);
+    EXPECT_EQ(json, buffer2);
+}
+
+TEST_F(MicrojsonDeserializationTest, BinaryTranscoding) {
+    const char *buffer1 = "{\"testField1\":\"test\\n\\u00e9\\ud83d\\ude00\",\"testField2\":[1,-1,300,-200,70000,5000000000,2.5],"
+                          "\"testField3\":{\"testField4\":true,\"testField5\":null},\"testField6\":false}";
+    size_t size = strlen(buffer1);
+    std::vector<uint8_t> msgpack;
+    ASSERT_TRUE(microjson::jsonToMessagePack(buffer1, size, msgpack));
+    EXPECT_EQ(msgpack[0], 0x84);
+    EXPECT_EQ(msgpack[1], 0xaa);
+
+    std::string json;
+    ASSERT_TRUE(microjson::messagePackToJson(msgpack.data(), msgpack.size(), json));
+    microjson::JsonObject obj = microjson::parseJsonObject(json.data(), json.size());
+    ASSERT_EQ(obj.size(), 4);
+    EXPECT_STREQ(obj["testField1"].value.c_str(), "test\\n\xc3\xa9\xf0\x9f\x98\x80");
+    EXPECT_STREQ(obj["testField2"].value.c_str(), "[1,-1,300,-200,70000,5000000000,2.5]");
+    EXPECT_STREQ(obj["testField3"].value.c_str(), "{\"testField4\":true,\"testField5\":null}");
+    EXPECT_STREQ(obj["testField6"].value.c_str(), "false");
+
+    std::vector<uint8_t> cbor;
+    ASSERT_TRUE(microjson::jsonToCbor(buffer1, size, cbor));
+    EXPECT_EQ(cbor[0], 0xbf);
+    EXPECT_EQ(cbor.back(), 0xff);
+    std::string cborJson;
+    ASSERT_TRUE(microjson::cborToJson(cbor.data(), cbor.size(), cborJson));
+    EXPECT_EQ(cborJson, json);
+
+    const char *buffer2 = "[1, -24, -25, \"a\", 1.5]";
+    size = strlen(buffer2);
+    cbor.clear();
+    ASSERT_TRUE(microjson::jsonToCbor(buffer2, size, cbor));
+    const std::vector<uint8_t> expectedCbor{0x9f, 0x01, 0x37, 0x38, 0x18, 0x61, 0x61,
+                                            0xfb, 0x3f, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff};
+    EXPECT_EQ(cbor, expectedCbor);
+
+    std::string largeArray = "[";
+    for (int i = 0; i < 20; ++i) {
+        largeArray += i > 0 ? ",[]" : "[]";
+    }
+    largeArray += "]";
+    msgpack.clear();
+    ASSERT_TRUE(microjson::jsonToMessagePack(largeArray.data(), largeArray.size(), msgpack));
+    ASSERT_EQ(msgpack.size(), 23);
+    EXPECT_EQ(msgpack[0], 0xdc);
+    EXPECT_EQ(msgpack[2], 20);
+    EXPECT_EQ(msgpack[3], 0x90);
+    json.clear();
+    ASSERT_TRUE(microjson::messagePackToJson(msgpack.data(), msgpack.size(), json));
+    EXPECT_EQ(json.size(), largeArray.size());
+
+    //Unused header bytes of nested containers are removed, output before them is kept
+    const char *nested = "[[1],{\"a\":[2,3]},[]]";
+    msgpack.assign(1, 0xff);
+    ASSERT_TRUE(microjson::jsonToMessagePack(nested, strlen(nested), msgpack));
+    const std::vector<uint8_t> expectedMsgpack{0xff, 0x93, 0x91, 0x01, 0x81, 0xa1, 'a', 0x92, 0x02, 0x03, 0x90};
+    EXPECT_EQ(msgpack, expectedMsgpack);
+
+    //Long chain of tags is rejected like too deep nesting
+    std::vector<uint8_t> tagged(100, 0xc0);
+    tagged.push_back(0x00);
+    json.clear();
+    ASSERT_TRUE(microjson::cborToJson(tagged.data(), tagged.size(), json));
+    EXPECT_EQ(json, "0");
+    tagged.assign(2000000, 0xc0);
+    tagged.push_back(0x00);
+    EXPECT_FALSE(microjson::cborToJson(tagged.data(), tagged.size(), json));
+
+    const char *buffer4 = "[0.1, 1.5e300, -2.5e-8, 0.30000000000000004]";
+    msgpack.clear();
+    ASSERT_TRUE(microjson::jsonToMessagePack(buffer4, strlen(buffer4), msgpack));
+    json.clear();
+    ASSERT_TRUE(microjson::messagePackToJson(msgpack.data(), msgpack.size(), json));
+    EXPECT_EQ(json, "[0.1,1.5e+300,-2.5e-08,0.30000000000000004]");
+
+    const char *buffer3 = "{\"testField1\":\"\\x\"}";
+    msgpack.clear();
+    EXPECT_FALSE(microjson::jsonToMessagePack(buffer3, strlen(buffer3), msgpack));
+    EXPECT_TRUE(msgpack.empty());
+
+    const uint8_t truncated[] = {0x92, 0x01};
+    json.clear();
+    EXPECT_FALSE(microjson::messagePackToJson(truncated, sizeof(truncated), json));
+    EXPECT_TRUE(json.empty());
+}
+
+TEST_F(MicrojsonDeserializationTest, CompactArrayValues) {
+    EXPECT_EQ(sizeof(microjson::JsonCompactValue), 16);
+
+    const char *buffer1 = "[12, -3.5, \"short\", \"long string value\", true, false, null, [1,2], {\"testField1\":1}, 9007199254740993]";
+    size_t size = strlen(buffer1);
+    microjson::JsonCompactArray arr = microjson::parseJsonCompactArray(buffer1, size);
+    ASSERT_EQ(arr.size(), 10);
+
+    EXPECT_EQ(arr[0].type(), microjson::JsonNumberType);
+    EXPECT_EQ(arr[0].toString(), "12");
+    EXPECT_EQ(arr[0].toInt(), 12);
+    EXPECT_EQ(arr[0].toInt(), 12);
+    EXPECT_EQ(arr[0].toDouble(), 12.0);
+
+    EXPECT_EQ(arr[1].toDouble(), -3.5);
+    EXPECT_EQ(arr[1].toInt(), -3);
+    EXPECT_EQ(arr[1].type(), microjson::JsonNumberType);
+
+    EXPECT_EQ(arr[2].type(), microjson::JsonStringType);
+    EXPECT_EQ(arr[2].toString(), "short");
+    EXPECT_EQ(arr[3].type(), microjson::JsonStringType);
+    EXPECT_EQ(arr[3].toString(), "long string value");
+
+    EXPECT_EQ(arr[4].type(), microjson::JsonBoolType);
+    EXPECT_TRUE(arr[4].toBool());
+    EXPECT_FALSE(arr[5].toBool());
+    EXPECT_TRUE(arr[6].isNull());
+    EXPECT_EQ(arr[6].type(), microjson::JsonObjectType);
+
+    EXPECT_EQ(arr[7].type(), microjson::JsonArrayType);
+    EXPECT_EQ(arr[7].toString(), "[1,2]");
+    EXPECT_EQ(arr[8].type(), microjson::JsonObjectType);
+    EXPECT_EQ(arr[8].toString(), "{\"testField1\":1}");
+
+    EXPECT_EQ(arr[9].toInt(), 9007199254740993);
+
+    //Converted numbers keep their text
+    const char *buffer3 = "[1e2, 1.50, 1e300, -1e300]";
+    microjson::JsonCompactArray numbers = microjson::parseJsonCompactArray(buffer3, strlen(buffer3));
+    ASSERT_EQ(numbers.size(), 4);
+    EXPECT_EQ(numbers[0].toInt(), 100);
+    EXPECT_EQ(numbers[0].toString(), "1e2");
+    EXPECT_EQ(numbers[1].toDouble(), 1.5);
+    EXPECT_EQ(numbers[1].toString(), "1.50");
+    EXPECT_EQ(numbers[1].toInt(), 1);
+    EXPECT_EQ(numbers[2].toInt(), INT64_MAX);
+    EXPECT_EQ(numbers[3].toInt(), INT64_MIN);
+
+    //Const access converts without caching
+    const microjson::JsonCompactArray &constNumbers = numbers;
+    EXPECT_EQ(constNumbers[1].toDouble(), 1.5);
+    EXPECT_EQ(constNumbers[2].toDouble(), 1e300);
+    EXPECT_EQ(constNumbers[2].toString(), "1e300");
+
+    const char *buffer2 = "[1 2]";
+    EXPECT_EQ(microjson::parseJsonCompactArray(buffer2, strlen(buffer2)).size(), 0);
+}
+
+TEST_F(MicrojsonDeserializationTest, ParseCache) {
+    microjson::JsonParseCache cache;
+    const std::string buffer1 = "{\"testField1\":\"test1\",\"testField2\":[1,2]}";
+    std::shared_ptr<const microjson::JsonObject> obj1 = cache.parseJsonObject(buffer1.data(), buffer1.size());
+    ASSERT_EQ(obj1->size(), 2);
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_EQ(cache.hits(), 0);
+
+    const std::string buffer1Copy = buffer1;
+    std::shared_ptr<const microjson::JsonObject> obj2 = cache.parseJsonObject(buffer1Copy.data(), buffer1Copy.size());
+    EXPECT_EQ(obj1.get(), obj2.get());
+    EXPECT_EQ(cache.hits(), 1);
+
+    const std::string buffer2 = "{\"testField1\":\"test2\",\"testField2\":[1,2]}";
+    std::shared_ptr<const microjson::JsonObject> obj3 = cache.parseJsonObject(buffer2.data(), buffer2.size());
+    EXPECT_NE(obj1.get(), obj3.get());
+    EXPECT_STREQ(obj3->at("testField1").value.c_str(), "test2");
+    EXPECT_EQ(cache.misses(), 2);
+
+    std::shared_ptr<const microjson::JsonArray> arr = cache.parseJsonArray("[1,2,3]", 7);
+    EXPECT_EQ(arr->size(), 3);
+    EXPECT_EQ(cache.size(), 3);
+
+    cache.setMemoryLimit(cache.memoryUsage() - 1);
+    EXPECT_EQ(cache.size(), 2);
+    obj2 = cache.parseJsonObject(buffer1.data(), buffer1.size());
+    EXPECT_EQ(cache.misses(), 4);
+    EXPECT_EQ(obj1->size(), 2);
+    EXPECT_LE(cache.memoryUsage(), cache.memoryLimit());
+
+    cache.clear();
+    EXPECT_EQ(cache.size(), 0);
+    EXPECT_EQ(cache.memoryUsage(), 0);
+    EXPECT_NE(microjson::hashBuffer(buffer1.data(), buffer1.size()), microjson::hashBuffer(buffer2.data(), buffer2.size()));
+}
+
+TEST_F(MicrojsonDeserializationTest, FindValue) {
+    const char *buffer1 = " {\"testField1\":{\"test/Field~2\":[1,\"two\",{\"testField3\":true}]},\"testField4\":\"test4\"} ";
+    size_t size = strlen(buffer1);
+    microjson::JsonProperty property;
+    ASSERT_TRUE(microjson::findJsonValue(buffer1, size, "/testField1/test~1Field~02/2/testField3", property));
+    EXPECT_EQ(property.type, microjson::JsonBoolType);
+    EXPECT_EQ(std::string(buffer1 + property.valueBegin, property.valueSize()), "true");
+    EXPECT_EQ(std::string(buffer1 + property.nameBegin, property.nameSize()), "testField3");
+
+    ASSERT_TRUE(microjson::findJsonValue(buffer1, size, "/testField1/test~1Field~02/1", property));
+    EXPECT_EQ(property.type, microjson::JsonStringType);
+    EXPECT_EQ(std::string(buffer1 + property.valueBegin, property.valueSize()), "two");
+
+    ASSERT_TRUE(microjson::findJsonValue(buffer1, size, "", property));
+    EXPECT_EQ(property.type, microjson::JsonObjectType);
+    EXPECT_EQ(property.valueBegin, 1);
+
+    EXPECT_FALSE(microjson::findJsonValue(buffer1, size, "/testField1/test~1Field~02/3", property));
+    EXPECT_FALSE(microjson::findJsonValue(buffer1, size, "/testField4/0", property));
+    EXPECT_FALSE(microjson::findJsonValue(buffer1, size, "testField4", property));
+    EXPECT_FALSE(microjson::findJsonValue(buffer1, size, "/testField1/test~1Field~02/01", property));
+    EXPECT_FALSE(microjson::findJsonValue(buffer1, size, "/testField1/test~1Field~2", property));
+    EXPECT_FALSE(microjson::findJsonValue(buffer1, size, "/testField1/test~", property));
+
+    //Escaped backslash before the closing quote
+    const char *buffer2 = "{\"s\":\"a\\\\\",\"t\":1,\"u\\\"v\":[\"]\\\"\",2]}";
+    size = strlen(buffer2);
+    ASSERT_TRUE(microjson::findJsonValue(buffer2, size, "/s", property));
+    EXPECT_EQ(property.type, microjson::JsonStringType);
+    EXPECT_EQ(std::string(buffer2 + property.valueBegin, property.valueSize()), "a\\\\");
+    ASSERT_TRUE(microjson::findJsonValue(buffer2, size, "/t", property));
+    EXPECT_EQ(std::string(buffer2 + property.valueBegin, property.valueSize()), "1");
+    EXPECT_EQ(std::string(buffer2 + property.nameBegin, property.nameSize()), "t");
+    ASSERT_TRUE(microjson::findJsonValue(buffer2, size, "/u\"v/1", property));
+    EXPECT_EQ(property.type, microjson::JsonNumberType);
+    EXPECT_EQ(std::string(buffer2 + property.valueBegin, property.valueSize()), "2");
+
+    const char *buffer3 = "{\"s\":\"a\\\\\"}";
+    ASSERT_TRUE(microjson::findJsonValue(buffer3, strlen(buffer3), "/s", property));
+    EXPECT_EQ(std::string(buffer3 + property.valueBegin, property.valueSize()), "a\\\\");
+}
+
+TEST_F(MicrojsonDeserializationTest, InternStore) {
+    microjson::JsonInternStore store;
+    const std::string buffer1 = "{\"id\":1,\"kind\":\"enum-like-value-0123456789\",\"meta\":{\"source\":\"catalog\",\"version\":3}}";
+    const std::string buffer2 = "{\"id\":2,\"kind\":\"enum-like-value-0123456789\",\"meta\":{\"source\":\"catalog\",\"version\":3}}";
+    std::shared_ptr<const microjson::JsonInternedObject> obj1 = store.parseJsonObject(buffer1.data(), buffer1.size());
+    std::shared_ptr<const microjson::JsonInternedObject> obj2 = store.parseJsonObject(buffer2.data(), buffer2.size());
+    std::shared_ptr<const microjson::JsonInternedObject> obj3 = store.parseJsonObject(buffer1.data(), buffer1.size());
+    ASSERT_TRUE(obj1 && obj2);
+    EXPECT_NE(obj1, obj2);
+    EXPECT_EQ(obj1, obj3);
+    EXPECT_EQ(obj1->find("kind")->value, obj2->find("kind")->value);
+    EXPECT_EQ(obj1->find("meta")->value, obj2->find("meta")->value);
+    EXPECT_EQ(obj1->find("meta")->type, microjson::JsonObjectType);
+    EXPECT_EQ(*obj2->find("id")->value, "2");
+    EXPECT_EQ(obj1->find("missing"), nullptr);
+    microjson::JsonObject plain = obj1->toObject();
+    ASSERT_EQ(plain.size(), 3);
+    EXPECT_EQ(plain["meta"].value, "{\"source\":\"catalog\",\"version\":3}");
+
+    EXPECT_EQ(store.intern(microjson::parseJsonObject(buffer2.data(), buffer2.size())), obj2);
+    EXPECT_EQ(store.parseJsonObject("{\"id\":", 6), nullptr);
+    std::shared_ptr<const microjson::JsonInternedObject> duplicated = store.parseJsonObject("{\"a\":1,\"a\":2}", 13);
+    ASSERT_EQ(duplicated->size(), 1);
+    EXPECT_EQ(*duplicated->find("a")->value, "2");
+
+    microjson::JsonInternStats stats = store.stats();
+    EXPECT_EQ(stats.objects, 3);
+    EXPECT_EQ(stats.references, 4);
+    EXPECT_GT(stats.savedBytes(), 0);
+
+    duplicated.reset();
+    obj2.reset();
+    EXPECT_EQ(store.collect(), 4);//Two objects and strings "a", "2"
+    stats = store.stats();
+    EXPECT_EQ(stats.objects, 1);
+    EXPECT_EQ(stats.strings, 6);
+}
+
+TEST_F(MicrojsonDeserializationTest, MinifyPrettify) {
+    const std::string buffer1 = "{ \"z\" : [1, 2,\t{}], \"a\":\r\n{\"s\": \"x y \\\" , : {\", \"e\":[ ] },\n \"n\": null , \"long string without specials\": -1.5e3 }";
+    const std::string minified = "{\"z\":[1,2,{}],\"a\":{\"s\":\"x y \\\" , : {\",\"e\":[]},\"n\":null,\"long string without specials\":-1.5e3}";
+    std::string formatted;
+    ASSERT_TRUE(microjson::minifyJson(buffer1.data(), buffer1.size(), formatted));
+    EXPECT_EQ(formatted, minified);
+
+    const std::string pretty = "{\n"
+                               "  \"z\": [\n"
+                               "    1,\n"
+                               "    2,\n"
+                               "    {}\n"
+                               "  ],\n"
+                               "  \"a\": {\n"
+                               "    \"s\": \"x y \\\" , : {\",\n"
+                               "    \"e\": []\n"
+                               "  },\n"
+                               "  \"n\": null,\n"
+                               "  \"long string without specials\": -1.5e3\n"
+                               "}";
+    ASSERT_TRUE(microjson::prettifyJson(buffer1.data(), buffer1.size(), formatted, 2));
+    EXPECT_EQ(formatted, pretty);
+    ASSERT_TRUE(microjson::minifyJson(pretty.data(), pretty.size(), formatted));
+    EXPECT_EQ(formatted, minified);
+    EXPECT_TRUE(microjson::isValidJson(pretty.data(), pretty.size()));
+
+    //In place and truncated output
+    std::string inPlace = buffer1;
+    EXPECT_EQ(microjson::minifyJson(&inPlace[0], inPlace.size(), &inPlace[0], inPlace.size()), minified.size());
+    EXPECT_EQ(inPlace.substr(0, minified.size()), minified);
+    char small[8];
+    EXPECT_EQ(microjson::prettifyJson(buffer1.data(), buffer1.size(), small, sizeof(small), 2), pretty.size());
+    EXPECT_EQ(std::string(small, sizeof(small)), pretty.substr(0, sizeof(small)));
+    EXPECT_EQ(microjson::minifyJson("[\"abc", 5, small, sizeof(small)), SIZE_MAX);
+
+    //Errors are told apart from empty input
+    EXPECT_FALSE(microjson::minifyJson("[\"abc", 5, formatted));
+    EXPECT_TRUE(formatted.empty());
+    EXPECT_FALSE(microjson::prettifyJson("{\"a", 3, formatted));
+    EXPECT_TRUE(microjson::minifyJson("", 0, formatted));
+    EXPECT_TRUE(formatted.empty());
+}
+
+TEST_F(MicrojsonDeserializationTest, DiffJson) {
+    const std::string buffer1 = "{\"id\":1,\"name\":\"a/b\",\"tags\":[\"x\",\"y\",\"z\"],\"nested\":{\"k\":[1,2],\"m\":null},\"gone\":true}";
+    const std::string buffer2 = "{ \"id\": 2, \"name\": \"a/b\", \"tags\": [\"x\", \"w\", \"v\", \"z\"],\n"
+                                "  \"nested\": {\"k\": [1], \"m\": null}, \"new~\": {\"a\": []} }";
+    std::vector<microjson::JsonDiffChange> changes;
+    ASSERT_TRUE(microjson::diffJson(buffer1.data(), buffer1.size(), buffer2.data(), buffer2.size(), changes));
+    ASSERT_EQ(changes.size(), 6);
+    EXPECT_EQ(changes[0].operation, microjson::JsonDiffRemove);
+    EXPECT_EQ(changes[0].path, "/gone");
+    EXPECT_EQ(changes[1].operation, microjson::JsonDiffReplace);
+    EXPECT_EQ(changes[1].path, "/id");
+    EXPECT_EQ(changes[1].value, "2");
+    EXPECT_EQ(changes[2].path, "/nested/k/1");
+    EXPECT_EQ(changes[2].operation, microjson::JsonDiffRemove);
+    EXPECT_EQ(changes[3].path, "/new~0");
+    EXPECT_EQ(changes[3].value, "{\"a\": []}");
+    EXPECT_EQ(changes[4].path, "/tags/1");
+    EXPECT_EQ(changes[4].value, "\"w\"");
+    EXPECT_EQ(changes[5].path, "/tags/2");
+    EXPECT_EQ(changes[5].operation, microjson::JsonDiffAdd);
+    EXPECT_EQ(changes[5].value, "\"v\"");
+
+    EXPECT_EQ(microjson::toJsonPatch({changes[0], changes[3]}),
+              "[{\"op\":\"remove\",\"path\":\"/gone\"},{\"op\":\"add\",\"path\":\"/new~0\",\"value\":{\"a\": []}}]");
+    EXPECT_EQ(microjson::toJsonPatch({}), "[]");
+    const std::string patch = microjson::toJsonPatch(changes);
+    EXPECT_TRUE(microjson::isValidJson(patch.data(), patch.size()));
+
+    //Elements are aligned across insertions
+    const std::string array1 = "[1, {\"a\": 2}, [3], \"4\", 5]";
+    const std::string array2 = "[1, 9, {\"a\":2}, [3], \"4\", 6]";
+    ASSERT_TRUE(microjson::diffJson(array1.data(), array1.size(), array2.data(), array2.size(), changes));
+    ASSERT_EQ(changes.size(), 2);
+    EXPECT_EQ(changes[0].operation, microjson::JsonDiffAdd);
+    EXPECT_EQ(changes[0].path, "/1");
+    EXPECT_EQ(changes[0].value, "9");
+    EXPECT_EQ(changes[1].operation, microjson::JsonDiffReplace);
+    EXPECT_EQ(changes[1].path, "/5");
+    ASSERT_TRUE(microjson::diffJson(array2.data(), array2.size(), array1.data(), array1.size(), changes));
+    ASSERT_EQ(changes.size(), 2);
+    EXPECT_EQ(changes[0].operation, microjson::JsonDiffRemove);
+    EXPECT_EQ(changes[0].path, "/1");
+    EXPECT_EQ(changes[1].path, "/4");
+
+    //Formatting and member order
+    const std::string ordered1 = "{\"a\":[1,{\"b\":2}],\"c\":\"d\"}";
+    const std::string ordered2 = "{\n  \"a\": [1, {\"b\": 2}],\n  \"c\": \"d\"\n}";
+    const std::string reordered = "{\"c\":\"d\",\"a\":[1,{\"b\":2}]}";
+    EXPECT_TRUE(microjson::equalJson(ordered1.data(), ordered1.size(), ordered2.data(), ordered2.size()));
+    EXPECT_FALSE(microjson::equalJson(ordered1.data(), ordered1.size(), reordered.data(), reordered.size()));
+    EXPECT_TRUE(microjson::equalJson(ordered1.data(), ordered1.size(), reordered.data(), reordered.size(), true));
+    EXPECT_FALSE(microjson::equalJson(ordered1.data(), ordered1.size(), buffer1.data(), buffer1.size(), true));
+    ASSERT_TRUE(microjson::diffJson(ordered1.data(), ordered1.size(), reordered.data(), reordered.size(), changes));
+    ASSERT_EQ(changes.size(), 1);
+    EXPECT_EQ(changes[0].path, "");
+    EXPECT_EQ(changes[0].value, reordered);
+    ASSERT_TRUE(microjson::diffJson(ordered1.data(), ordered1.size(), reordered.data(), reordered.size(), changes, true));
+    EXPECT_TRUE(changes.empty());
+    const std::string reorderedChanged = "{\"c\":\"d\",\"a\":[1,{\"b\":3}]}";
+    ASSERT_TRUE(microjson::diffJson(ordered1.data(), ordered1.size(), reorderedChanged.data(), reorderedChanged.size(), changes, true));
+    ASSERT_EQ(changes.size(), 1);
+    EXPECT_EQ(changes[0].path, "/a/1/b");
+    EXPECT_EQ(changes[0].value, "3");
+
+    //Duplicated names, the last one wins
+    const std::string duplicated = "{\"a\":[1,{\"b\":2}],\"c\":\"x\",\"c\":\"d\"}";
+    EXPECT_TRUE(microjson::equalJson(ordered1.data(), ordered1.size(), duplicated.data(), duplicated.size()));
+
+    EXPECT_TRUE(microjson::equalJson(buffer1.data(), buffer1.size(), buffer1.data(), buffer1.size()));
+    EXPECT_FALSE(microjson::equalJson("{\"a\":", 5, "{\"a\":", 5));
+    EXPECT_FALSE(microjson::diffJson(buffer1.data(), buffer1.size(), "[1,", 3, changes));
+}
+
+TEST_F(MicrojsonDeserializationTest, PatchValues) {
+    const std::string buffer1 = "{\"testField1\":\"test1\",\"testField2\":{\"testField3\":[1,2,3],\"testField4\":null},\"testField5\":5}";
+    microjson::JsonPatch patch(buffer1.data(), buffer1.size());
+    ASSERT_TRUE(patch.replaceString("/testField1", "new \"value\""));
+    ASSERT_TRUE(patch.replace("/testField2/testField3/1", "42"));
+    ASSERT_TRUE(patch.replace("/testField5", "{\"a\":true}"));
+    EXPECT_FALSE(patch.replace("/testField2", "0"));
+    EXPECT_FALSE(patch.replace("/missing", "0"));
+
+    const std::string expected = "{\"testField1\":\"new \\\"value\\\"\",\"testField2\":{\"testField3\":[1,42,3],\"testField4\":null},\"testField5\":{\"a\":true}}";
+    EXPECT_EQ(patch.toString(), expected);
+    EXPECT_EQ(patch.size(), expected.size());
+
+    std::vector<microjson::JsonSlice> slices = patch.slices();
+    ASSERT_EQ(slices.size(), 7);
+    EXPECT_EQ(slices[0].data, buffer1.data());
+    EXPECT_EQ(slices[2].data, buffer1.data() + buffer1.find(",\"testField2\""));
+
+    ASSERT_TRUE(patch.replace("/testField5", "6"));
+    EXPECT_EQ(patch.toString().substr(patch.size() - 15), "\"testField5\":6}");
+
+    patch.clear();
+    EXPECT_EQ(patch.toString(), buffer1);
+}
+
+TEST_F(MicrojsonDeserializationTest, PatchMembers) {
+    const std::string buffer1 = "{ \"a\": 1, \"b\": \"two\", \"c\": [1, 2, 3], \"d\": {}, \"e\": null }";
+    microjson::JsonPatch patch(buffer1.data(), buffer1.size());
+    ASSERT_TRUE(patch.remove("/b"));
+    ASSERT_TRUE(patch.remove("/c/2"));
+    ASSERT_TRUE(patch.rename("/a", "first"));
+    ASSERT_TRUE(patch.add("/d/x", "true"));
+    ASSERT_TRUE(patch.add("/d/y", "[]"));
+    ASSERT_TRUE(patch.add("/c/-", "4"));
+    ASSERT_TRUE(patch.add("/first", "10"));
+    EXPECT_FALSE(patch.add("/c/0", "0"));
+    EXPECT_FALSE(patch.rename("/c/0", "x"));
+    EXPECT_FALSE(patch.remove(""));
+
+    const std::string expected = "{ \"first\": 10, \"c\": [1, 2,4], \"d\": {\"x\":true,\"y\":[]}, \"e\": null }";
+    EXPECT_EQ(patch.toString(), expected);
+    EXPECT_EQ(patch.size(), expected.size());
+    EXPECT_TRUE(microjson::isValidJson(expected.data(), expected.size()));
+
+    //Neighbour removals share separators
+    ASSERT_TRUE(patch.remove("/e"));
+    ASSERT_TRUE(patch.remove("/d"));
+    EXPECT_EQ(patch.toString(), "{ \"first\": 10, \"c\": [1, 2,4] }");
+    ASSERT_TRUE(patch.remove("/a"));
+    ASSERT_TRUE(patch.remove("/c"));
+    EXPECT_EQ(patch.toString(), "{  }");
+    ASSERT_EQ(patch.slices().size(), 2);
+    EXPECT_EQ(patch.slices()[0].data, buffer1.data());
+
+    //Member names are looked up after pending renames, removals and additions
+    patch.clear();
+    EXPECT_FALSE(patch.rename("/a", "b"));
+    EXPECT_TRUE(patch.rename("/a", "a"));
+    patch.clear();
+    ASSERT_TRUE(patch.rename("/a", "f"));
+    ASSERT_TRUE(patch.add("/f", "9"));
+    ASSERT_TRUE(patch.add("/a", "\"a\""));
+    EXPECT_FALSE(patch.rename("/b", "f"));
+    EXPECT_FALSE(patch.rename("/b", "a"));
+    EXPECT_EQ(patch.toString(), "{ \"f\": 9, \"b\": \"two\", \"c\": [1, 2, 3], \"d\": {}, \"e\": null,\"a\":\"a\" }");
+    ASSERT_TRUE(patch.add("/a", "3"));
+    EXPECT_EQ(patch.toString(), "{ \"f\": 9, \"b\": \"two\", \"c\": [1, 2, 3], \"d\": {}, \"e\": null,\"a\":3 }");
+    patch.clear();
+    ASSERT_TRUE(patch.remove("/b"));
+    ASSERT_TRUE(patch.add("/b", "2"));
+    ASSERT_TRUE(patch.add("/b", "[2]"));
+    EXPECT_EQ(patch.toString(), "{ \"a\": 1, \"c\": [1, 2, 3], \"d\": {}, \"e\": null,\"b\":[2] }");
+
+    patch.clear();
+    ASSERT_TRUE(patch.remove("/c/1"));
+    ASSERT_TRUE(patch.remove("/c/0"));
+    ASSERT_TRUE(patch.remove("/c/2"));
+    EXPECT_NE(patch.toString().find("\"c\": [],"), std::string::npos);
+    ASSERT_TRUE(patch.add("/c/-", "5"));
+    EXPECT_NE(patch.toString().find("\"c\": [5],"), std::string::npos);
+
+    //Members added after removing every member need no separator
+    const std::string buffer2 = "{\"a\":1}";
+    microjson::JsonPatch patch2(buffer2.data(), buffer2.size());
+    ASSERT_TRUE(patch2.remove("/a"));
+    ASSERT_TRUE(patch2.add("/b", "2"));
+    EXPECT_EQ(patch2.toString(), "{\"b\":2}");
+
+    const std::string buffer3 = "[1]";
+    microjson::JsonPatch patch3(buffer3.data(), buffer3.size());
+    ASSERT_TRUE(patch3.remove("/0"));
+    ASSERT_TRUE(patch3.add("/-", "2"));
+    ASSERT_TRUE(patch3.add("/-", "3"));
+    EXPECT_EQ(patch3.toString(), "[2,3]");
+}
+
+TEST_F(MicrojsonDeserializationTest, SchemaValidation) {
+    microjson::JsonSchema schema;
+    schema.property("id", microjson::JsonNumberType).range(1, 1000)
+          .property("name", microjson::JsonStringType).length(1, 8)
+          .property("kind", microjson::JsonStringType, false).oneOf({"a", "b"})
+          .property("parent", microjson::JsonObjectType, false).nullable()
+          .property("tags", microjson::JsonInvalidType, false);
+
+    const char *buffer1 = "{\"id\":12,\"name\":\"test\",\"kind\":\"b\",\"parent\":null,\"extra\":[1]}";
+    microjson::JsonSchemaResult result;
+    microjson::JsonObject obj = microjson::parseJsonObject(buffer1, strlen(buffer1), schema, result);
+    EXPECT_TRUE(result.valid());
+    EXPECT_EQ(obj.size(), 5);
+    EXPECT_STREQ(obj["name"].value.c_str(), "test");
+
+    const char *buffer2 = "{\"id\":1200,\"name\":\"test\"}";
+    result = microjson::validateJsonObject(buffer2, strlen(buffer2), schema);
+    EXPECT_EQ(result.error, microjson::JsonSchemaOutOfRange);
+    EXPECT_EQ(result.offset, 6);
+    EXPECT_EQ(result.property, 0);
+
+    const char *buffer3 = "{\"id\":\"12\",\"name\":\"test\"}";
+    obj = microjson::parseJsonObject(buffer3, strlen(buffer3), schema, result);
+    EXPECT_EQ(result.error, microjson::JsonSchemaTypeMismatch);
+    EXPECT_TRUE(obj.empty());
+
+    const char *buffer4 = "{\"id\":12,\"name\":\"too long name\"}";
+    EXPECT_EQ(microjson::validateJsonObject(buffer4, strlen(buffer4), schema).error, microjson::JsonSchemaLengthMismatch);
+
+    const char *buffer5 = "{\"id\":12,\"kind\":\"c\",\"name\":\"test\"}";
+    EXPECT_EQ(microjson::validateJsonObject(buffer5, strlen(buffer5), schema).error, microjson::JsonSchemaNotInEnum);
+
+    //Escapes are resolved before length and enum checks
+    const char *buffer8 = "{\"id\":12,\"kind\":\"\\u0062\",\"name\":\"\\u00e9\\n\\t\\\"12\"}";
+    EXPECT_TRUE(microjson::validateJsonObject(buffer8, strlen(buffer8), schema).valid());
+    const char *buffer9 = "{\"id\":12,\"name\":\"\\u0041\\u0042\\u0043\\u0044\\u0045\\u0046\\u0047\\u0048\\u0049\"}";
+    EXPECT_EQ(microjson::validateJsonObject(buffer9, strlen(buffer9), schema).error, microjson::JsonSchemaLengthMismatch);
+
+    const char *buffer6 = "{\"id\":12 }";
+    result = microjson::validateJsonObject(buffer6, strlen(buffer6), schema);
+    EXPECT_EQ(result.error, microjson::JsonSchemaMissingProperty);
+    EXPECT_EQ(result.property, 1);
+    EXPECT_EQ(result.offset, 9);
+
+    schema.additionalProperties(false);
+    result = microjson::validateJsonObject(buffer1, strlen(buffer1), schema);
+    EXPECT_EQ(result.error, microjson::JsonSchemaUnexpectedProperty);
+    EXPECT_EQ(result.offset, strlen("{\"id\":12,\"name\":\"test\",\"kind\":\"b\",\"parent\":null,\""));
+
+    const char *buffer7 = "{\"id\":12 \"name\":\"test\"}";
+    EXPECT_EQ(microjson::validateJsonObject(buffer7, strlen(buffer7), schema).error, microjson::JsonSchemaSyntaxError);
+}
+
+TEST_F(MicrojsonDeserializationTest, ArrayStream) {
+    std::string source = " [ {\"id\":0,\"name\":\"a,]}\\\"\"} ,";
+    for (int i = 1; i < 1000; ++i) {
+        source += "{\"id\":" + std::to_string(i) + ",\"nested\":[1,[2],{\"x\":3}]},\n";
+    }
+    source += "\"last\", [ ] ]  \n";
+
+    FILE *file = tmpfile();
+    ASSERT_NE(file, nullptr);
+    fwrite(source.data(), 1, source.size(), file);
+    rewind(file);
+
+    microjson::JsonArrayStream stream(file, 64);
+    ASSERT_TRUE(stream.next());
+    microjson::JsonObject obj = stream.object();
+    EXPECT_STREQ(obj["name"].value.c_str(), "a,]}\\\"");
+    EXPECT_EQ(stream.offset(), 3);
+
+    for (int i = 1; i < 1000; ++i) {
+        ASSERT_TRUE(stream.next());
+        EXPECT_EQ(std::string(stream.data(), stream.size()), "{\"id\":" + std::to_string(i) + ",\"nested\":[1,[2],{\"x\":3}]}");
+    }
+    ASSERT_TRUE(stream.next());
+    microjson::JsonValue value = stream.value();
+    EXPECT_EQ(value.type, microjson::JsonStringType);
+    EXPECT_STREQ(value.value.c_str(), "last");
+    ASSERT_TRUE(stream.next());
+    EXPECT_EQ(stream.value().type, microjson::JsonArrayType);
+    EXPECT_TRUE(stream.array().empty());
+
+    EXPECT_FALSE(stream.next());
+    EXPECT_EQ(stream.error(), microjson::JsonNoError);
+    EXPECT_EQ(stream.count(), 1002);
+    EXPECT_LE(stream.windowCapacity(), 256);
+    fclose(file);
+
+    microjson::JsonArrayStream missing("/nonexistent/file.json");
+    EXPECT_FALSE(missing.next());
+    EXPECT_EQ(missing.error(), microjson::JsonSyntaxError);
+
+    file = tmpfile();
+    const char *broken = "[1,2,{\"a\":3";
+    fwrite(broken, 1, strlen(broken), file);
+    rewind(file);
+    microjson::JsonArrayStream truncated(file, 4);
+    EXPECT_TRUE(truncated.next());
+    EXPECT_TRUE(truncated.next());
+    EXPECT_FALSE(truncated.next());
+    EXPECT_EQ(truncated.error(), microjson::JsonSyntaxError);
+    fclose(file);
+
+    file = tmpfile();
+    fwrite("[]", 1, 2, file);
+    rewind(file);
+    microjson::JsonArrayStream empty(file);
+    EXPECT_FALSE(empty.next());
+    EXPECT_EQ(empty.error(), microjson::JsonNoError);
+    fclose(file);
+}
+
+TEST_F(MicrojsonDeserializationTest, BlockRing) {
+    microjson::JsonBlockRing ring(16, 3);
+    const size_t blocks = 10000;
+    std::thread producer([&ring, blocks]() {
+        for (size_t i = 0; i < blocks; ++i) {
+            char *block = ring.acquire();
+            ASSERT_NE(block, nullptr);
+            memset(block, char(i), 16);
+            ring.commit(i % 16 + 1);
+        }
+    });
+
+    for (size_t i = 0; i < blocks; ++i) {
+        size_t size = 0;
+        const char *block = ring.front(size);
+        ASSERT_NE(block, nullptr);
+        ASSERT_EQ(size, i % 16 + 1);
+        ASSERT_EQ(block[size - 1], char(i));
+        ring.release();
+    }
+    producer.join();
+
+    ring.stop();
+    size_t size = 0;
+    EXPECT_EQ(ring.front(size), nullptr);
+}
+
+#ifdef MICROJSON_HAS_ZLIB
+TEST_F(MicrojsonDeserializationTest, GzipArrayStream) {
+    char path[] = "/tmp/microjson_testXXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    gzFile file = gzdopen(fd, "wb");
+    ASSERT_NE(file, nullptr);
+    gzputs(file, "[");
+    for (int i = 0; i < 10000; ++i) {
+        const std::string element = (i > 0 ? "," : "") + std::string("{\"id\":") + std::to_string(i) + "}";
+        gzputs(file, element.c_str());
+    }
+    gzputs(file, "]");
+    gzclose(file);
+
+    microjson::JsonArrayStream stream(path, 256, 3);
+    int count = 0;
+    while (stream.next()) {
+        microjson::JsonObject obj = stream.object();
+        ASSERT_EQ(obj["id"].value, std::to_string(count));
+        ++count;
+    }
+    EXPECT_EQ(stream.error(), microjson::JsonNoError);
+    EXPECT_EQ(count, 10000);
+    EXPECT_LE(stream.windowCapacity(), 512);
+    unlink(path);
+}
+#endif
+
+TEST_F(MicrojsonDeserializationTest, IngestFiles) {
+    char directory[] = "/tmp/microjson_ingestXXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+
+    std::vector<std::string> paths;
+    for (int i = 0; i < 300; ++i) {
+        paths.push_back(std::string(directory) + "/" + std::to_string(i) + ".json");
+        FILE *file = fopen(paths.back().c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        std::string content = "{\"id\":" + std::to_string(i) + ",\"payload\":\"" + std::string(size_t(i) * 7, 'x') + "\"}";
+        if (i == 13) {
+            content = "{\"id\":13,";
+        } else if (i == 14) {
+            content = "{\"id\":14,\"payload\":tru}";
+        }
+        fwrite(content.data(), 1, content.size(), file);
+        fclose(file);
+    }
+    paths.push_back(std::string(directory) + "/missing.json");
+
+    const microjson::JsonIngestBackend backends[] = {microjson::JsonIngestAuto, microjson::JsonIngestThreadPool};
+    for (auto backend : backends) {
+        microjson::JsonIngestOptions options;
+        options.backend = backend;
+        options.threads = 3;
+        options.queueDepth = 8;
+        options.bufferSize = 256;
+        std::vector<microjson::JsonObject> objects;
+        std::vector<microjson::JsonError> errors;
+        const microjson::JsonIngestBackend used = microjson::ingestJsonFiles(paths, objects, errors, options);
+        if (backend == microjson::JsonIngestThreadPool) {
+            EXPECT_EQ(used, microjson::JsonIngestThreadPool);
+        }
+
+        ASSERT_EQ(objects.size(), paths.size());
+        ASSERT_EQ(errors.size(), paths.size());
+        for (int i = 0; i < 300; ++i) {
+            if (i == 13 || i == 14) {
+                EXPECT_EQ(errors[i], microjson::JsonSyntaxError);
+                EXPECT_TRUE(objects[i].empty());
+                continue;
+            }
+            ASSERT_EQ(errors[i], microjson::JsonNoError) << i;
+            EXPECT_EQ(objects[i]["id"].value, std::to_string(i));
+            EXPECT_EQ(objects[i]["payload"].value.size(), size_t(i) * 7);
+        }
+        EXPECT_EQ(errors.back(), microjson::JsonSyntaxError);
+    }
+
+    for (const auto &path : paths) {
+        unlink(path.c_str());
+    }
+    rmdir(directory);
+}
+
+TEST_F(MicrojsonDeserializationTest, ResourceLimits) {
+    const char *buffer1 = "{\"a\":[1,2,{\"b\":[3]}],\"name\":\"value\",\"c\":{}}";
+    const size_t size1 = strlen(buffer1);
+    microjson::JsonLimits limits;
+    microjson::JsonError error = microjson::JsonSyntaxError;
+    microjson::JsonObject obj = microjson::parseJsonObject(buffer1, size1, limits, error);
+    EXPECT_EQ(error, microjson::JsonNoError);
+    EXPECT_EQ(obj.size(), 3);
+
+    limits.maxDepth = 4;
+    EXPECT_EQ(microjson::checkJsonLimits(buffer1, size1, limits), microjson::JsonNoError);
+    limits.maxDepth = 3;
+    obj = microjson::parseJsonObject(buffer1, size1, limits, error);
+    EXPECT_EQ(error, microjson::JsonDepthLimitError);
+    EXPECT_TRUE(obj.empty());
+
+    limits = microjson::JsonLimits();
+    limits.maxMembers = 3;
+    EXPECT_EQ(microjson::checkJsonLimits(buffer1, size1, limits), microjson::JsonNoError);
+    limits.maxMembers = 2;
+    EXPECT_EQ(microjson::checkJsonLimits(buffer1, size1, limits), microjson::JsonMembersLimitError);
+    limits.maxMembers = 0;
+    EXPECT_EQ(microjson::checkJsonLimits("[1]", 3, limits), microjson::JsonMembersLimitError);
+    EXPECT_EQ(microjson::checkJsonLimits("{\"a\":1}", 7, limits), microjson::JsonMembersLimitError);
+    EXPECT_EQ(microjson::checkJsonLimits("[ ]", 3, limits), microjson::JsonNoError);
+    limits.maxMembers = 1;
+    EXPECT_EQ(microjson::checkJsonLimits("[[1],{}]", 8, limits), microjson::JsonMembersLimitError);
+    EXPECT_EQ(microjson::checkJsonLimits("[[1,2]]", 7, limits), microjson::JsonMembersLimitError);
+    EXPECT_EQ(microjson::checkJsonLimits("[{\"a\":[1]}]", 11, limits), microjson::JsonNoError);
+
+    limits = microjson::JsonLimits();
+    limits.maxStringSize = 5;
+    EXPECT_EQ(microjson::checkJsonLimits(buffer1, size1, limits), microjson::JsonNoError);
+    limits.maxStringSize = 4;
+    EXPECT_EQ(microjson::checkJsonLimits(buffer1, size1, limits), microjson::JsonStringLimitError);
+
+    limits = microjson::JsonLimits();
+    limits.maxSize = size1 - 1;
+    EXPECT_EQ(microjson::checkJsonLimits(buffer1, size1, limits), microjson::JsonSizeLimitError);
+
+    limits = microjson::JsonLimits();
+    limits.deadline = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    EXPECT_EQ(microjson::checkJsonLimits(buffer1, size1, limits), microjson::JsonDeadlineError);
+
+    const std::string deep = std::string(100000, '[') + std::string(100000, ']');
+    limits = microjson::JsonLimits();
+    limits.maxDepth = 64;
+    microjson::JsonArray arr = microjson::parseJsonArray(deep.data(), deep.size(), limits, error);
+    EXPECT_EQ(error, microjson::JsonDepthLimitError);
+    EXPECT_TRUE(arr.empty());
+
+    const std::string longString = "[\"" + std::string(1000000, 'x');
+    limits.maxStringSize = 16;
+    EXPECT_EQ(microjson::checkJsonLimits(longString.data(), longString.size(), limits), microjson::JsonStringLimitError);
+
+    const char *buffer2 = "[1,\"two\",[3]]";
+    arr = microjson::parseJsonArray(buffer2, strlen(buffer2), limits, error);
+    EXPECT_EQ(error, microjson::JsonNoError);
+    ASSERT_EQ(arr.size(), 3);
+    EXPECT_STREQ(arr[1].value.c_str(), "two");
+
+    const char *buffer3 = "{\"a\":[1,2}";
+    obj = microjson::parseJsonObject(buffer3, strlen(buffer3), limits, error);
+    EXPECT_EQ(error, microjson::JsonSyntaxError);
+}
+
+TEST_F(MicrojsonDeserializationTest, FrozenObject) {
+    const char *buffer1 = "{\"testField1\":\"test1\",\"testField2\":42,\"testField3\":{\"a\":true},\"\":null}";
+    const microjson::JsonFrozenObject frozen = microjson::freeze(microjson::parseJsonObject(buffer1, strlen(buffer1)));
+    EXPECT_EQ(frozen.size(), 3);
+    EXPECT_EQ(frozen.capacity(), 3);
+    ASSERT_NE(frozen.find("testField1"), nullptr);
+    EXPECT_STREQ(frozen.find("testField1")->value.c_str(), "test1");
+    EXPECT_EQ(frozen.find("testField2")->type, microjson::JsonNumberType);
+    EXPECT_STREQ(frozen.find("testField3")->value.c_str(), "{\"a\":true}");
+    EXPECT_EQ(frozen.find("testField4"), nullptr);
+    EXPECT_EQ(frozen.find("testField"), nullptr);
+    EXPECT_EQ(frozen.find(""), nullptr);
+
+    microjson::JsonObject large;
+    for (int i = 0; i < 20000; ++i) {
+        large["key" + std::to_string(i)] = microjson::JsonValue(std::to_string(i), microjson::JsonNumberType);
+    }
+    const microjson::JsonFrozenObject frozenLarge(large);
+    EXPECT_EQ(frozenLarge.size(), large.size());
+    EXPECT_LE(frozenLarge.capacity(), large.size() * 2);
+    for (int i = 0; i < 20000; ++i) {
+        const microjson::JsonValue *value = frozenLarge.find("key" + std::to_string(i));
+        ASSERT_NE(value, nullptr);
+        ASSERT_EQ(value->value, std::to_string(i));
+    }
+    EXPECT_EQ(frozenLarge.find("key20000"), nullptr);
+
+    //Distinct hashes of these keys select the same slot for every displacement
+    microjson::JsonObject colliding;
+    colliding["k10952752"] = microjson::JsonValue("1", microjson::JsonNumberType);
+    colliding["k17957804"] = microjson::JsonValue("2", microjson::JsonNumberType);
+    const microjson::JsonFrozenObject frozenColliding(colliding);
+    ASSERT_NE(frozenColliding.find("k10952752"), nullptr);
+    EXPECT_EQ(frozenColliding.find("k10952752")->value, "1");
+    ASSERT_NE(frozenColliding.find("k17957804"), nullptr);
+    EXPECT_EQ(frozenColliding.find("k17957804")->value, "2");
+    EXPECT_EQ(frozenColliding.find("k1"), nullptr);
+
+    const microjson::JsonFrozenObject empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.find("a"), nullptr);
+}
+
+TEST_F(MicrojsonDeserializationTest, ValidateJson) {
+    const char *valid[] = {
+        "{}", " [ ] ", "0", "-0.5e+10", "\"\"", "true", "null",
+        "{\"a\":[1,2.5,-3e2,{\"b\":null}],\"c\":\"\\u00e9\\n\\\"\",\"d\":false}",
+        "[\"\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80 long enough string for word scanning\"]",
+        "\n{\"a\" : { \"b\" : [ [ ] , { } ] } }\n"
+    };
+    for (const char *buffer : valid) {
+        EXPECT_TRUE(microjson::isValidJson(buffer, strlen(buffer))) << buffer;
+    }
+
+    struct Invalid {
+        const char *buffer;
+        size_t offset;
+    };
+    const Invalid invalid[] = {
+        {"", 0}, {"{", 1}, {"{\"a\":1,}", 7}, {"[1,]", 3}, {"[1 2]", 3}, {"01", 1}, {"1.", 2}, {"-", 1},
+        {"1e", 2}, {"tru", 3}, {"nul1", 3}, {"{\"a\" 1}", 5}, {"{a:1}", 1}, {"\"\\x\"", 2}, {"\"\\u12g4\"", 5},
+        {"\"tab\there\"", 4}, {"\"\xc3\x28\"", 2}, {"\"\xed\xa0\x80\"", 2}, {"[1]]", 3}, {"{\"a\":1]", 6},
+        {"[\"unterminated string that is long", 34}, {"{} {}", 3}, {"{\v}", 1}, {"[1,\f2]", 3}, {"\f1", 0}
+    };
+    for (const auto &entry : invalid) {
+        const microjson::JsonValidationResult result = microjson::validateJson(entry.buffer, strlen(entry.buffer));
+        EXPECT_EQ(result.error, microjson::JsonSyntaxError) << entry.buffer;
+        EXPECT_EQ(result.offset, entry.offset) << entry.buffer;
+    }
+
+    const std::string deep = std::string(microjson::MaxValidationDepth, '[') + std::string(microjson::MaxValidationDepth, ']');
+    EXPECT_TRUE(microjson::isValidJson(deep.data(), deep.size()));
+    const std::string tooDeep = "[" + deep + "]";
+    const microjson::JsonValidationResult result = microjson::validateJson(tooDeep.data(), tooDeep.size());
+    EXPECT_EQ(result.error, microjson::JsonDepthLimitError);
+    EXPECT_EQ(result.offset, microjson::MaxValidationDepth);
+}
+
+TEST_F(MicrojsonDeserializationTest, IncrementalDocument) {
+    std::string filler;
+    for (int i = 0; i < 1000; ++i) {
+        filler += ",\"item" + std::to_string(i) + "\":[" + std::to_string(i) + ",{\"x\":\"y\"}]";
+    }
+    const std::string text = " {\"a\":{\"b\":[1,\"two\",{\"c\":true}],\"d\":\"text\"}" + filler + ",\"t~2\":1,\"e\":null} ";
+    microjson::JsonIncrementalDocument document(text);
+    ASSERT_TRUE(document.valid());
+
+    auto expectSameAsScan = [&document](const std::string &pointer) {
+        microjson::JsonProperty expected;
+        microjson::JsonProperty actual;
+        const bool found = microjson::findJsonValue(document.text().data(), document.text().size(), pointer, expected);
+        ASSERT_EQ(document.find(pointer, actual), found) << pointer;
+        if (found) {
+            EXPECT_EQ(actual.type, expected.type) << pointer;
+            EXPECT_EQ(actual.valueBegin, expected.valueBegin) << pointer;
+            EXPECT_EQ(actual.valueEnd, expected.valueEnd) << pointer;
+            if (expected.nameBegin != SIZE_MAX) {
+                EXPECT_EQ(actual.nameBegin, expected.nameBegin) << pointer;
+                EXPECT_EQ(actual.nameEnd, expected.nameEnd) << pointer;
+            }
+        }
+    };
+    const char *pointers[] = {"", "/a", "/a/b", "/a/b/1", "/a/b/2/c", "/a/d", "/item500/1/x", "/item999/0", "/e", "/missing", "/a/b/7"};
+    for (const char *pointer : pointers) {
+        expectSameAsScan(pointer);
+    }
+
+    //Pointers are decoded strictly, like by findJsonValue
+    microjson::JsonProperty property;
+    EXPECT_TRUE(document.find("/t~02", property));
+    const char *malformed[] = {"/t~2", "/a~", "/a/b/01", "/a/b/+1", "/a/b/ 1", "/a/b/1x"};
+    for (const char *pointer : malformed) {
+        EXPECT_FALSE(document.find(pointer, property)) << pointer;
+        expectSameAsScan(pointer);
+    }
+
+    //Edit inside of a string re-scans the string only
+    size_t offset = document.text().find("\"two\"") + 2;
+    ASSERT_TRUE(document.edit(offset, 1, "hree and mo"));
+    EXPECT_EQ(document.lastScanSize(), strlen("\"three and moo\""));
+    ASSERT_TRUE(document.find("/a/b/1", property));
+    EXPECT_EQ(document.text().substr(property.valueBegin, property.valueSize()), "three and moo");
+
+    //Edit that changes structure re-scans the enclosing array
+    offset = document.text().find("{\"c\":true}");
+    ASSERT_TRUE(document.edit(offset, 0, "42,"));
+    EXPECT_EQ(document.lastScanSize(), strlen("[1,\"three and moo\",42,{\"c\":true}]"));
+    ASSERT_TRUE(document.find("/a/b/2", property));
+    EXPECT_EQ(document.text().substr(property.valueBegin, property.valueSize()), "42");
+
+    //Edit of a property name re-scans the enclosing object
+    offset = document.text().find("\"d\"") + 1;
+    ASSERT_TRUE(document.edit(offset, 1, "dd"));
+    EXPECT_LT(document.lastScanSize(), 100);
+    expectSameAsScan("/a/dd");
+
+    for (const char *pointer : pointers) {
+        expectSameAsScan(pointer);
+    }
+
+    //Broken edit invalidates the index, next edit re-scans the whole document
+    offset = document.text().find("[500");
+    EXPECT_FALSE(document.edit(offset, 1, "{"));
+    EXPECT_FALSE(document.valid());
+    EXPECT_FALSE(document.find("/e", property));
+    EXPECT_TRUE(document.edit(offset, 1, "["));
+    EXPECT_TRUE(document.valid());
+    EXPECT_EQ(document.lastScanSize(), document.text().size());
+    for (const char *pointer : pointers) {
+        expectSameAsScan(pointer);
+    }
+
+    EXPECT_FALSE(document.edit(document.text().size() + 1, 0, "x"));
+}
+
+TEST_F(MicrojsonDeserializationTest, DocumentImage) {
+    const std::string buffer1 = " {\"name\":\"a\\\"b\",\"list\":[1, true, null, {\"x~y\":[]}],\"z\":{},\"a\":-1.5e3,\"a\":2} ";
+    std::string image;
+    ASSERT_TRUE(microjson::buildJsonImage(buffer1.data(), buffer1.size(), image, 42));
+    EXPECT_FALSE(microjson::buildJsonImage("{\"a\":", 5, image));
+    ASSERT_TRUE(microjson::buildJsonImage(buffer1.data(), buffer1.size(), image, 42));
+
+    microjson::JsonImage loaded;
+    ASSERT_TRUE(loaded.load(image.data(), image.size()));
+    EXPECT_EQ(loaded.sourceSize(), buffer1.size());
+    EXPECT_EQ(loaded.sourceStamp(), 42);
+
+    microjson::JsonImageRef root = loaded.root();
+    ASSERT_EQ(root.type(), microjson::JsonObjectType);
+    ASSERT_EQ(root.size(), 4);
+    size_t nameSize = 0;
+    EXPECT_EQ(std::string(root.name(0, nameSize), 1), "a");
+    EXPECT_EQ(root.find("a").toString(), "2");
+    EXPECT_EQ(root.find("name").toString(), "a\\\"b");
+    EXPECT_EQ(root.find("name").type(), microjson::JsonStringType);
+    EXPECT_EQ(root.find("z").size(), 0);
+    EXPECT_EQ(root.find("missing").type(), microjson::JsonInvalidType);
+
+    microjson::JsonImageRef list = root.at("/list");
+    ASSERT_EQ(list.size(), 4);
+    EXPECT_EQ(list.toString(), "[1, true, null, {\"x~y\":[]}]");
+    EXPECT_EQ(list[1].type(), microjson::JsonBoolType);
+    EXPECT_TRUE(list[2].isNull());
+    EXPECT_EQ(list[4].type(), microjson::JsonInvalidType);
+    EXPECT_EQ(root.at("/list/3/x~0y").type(), microjson::JsonArrayType);
+    EXPECT_EQ(root.at("/list/01").type(), microjson::JsonInvalidType);
+    EXPECT_EQ(root.at("").toString(), buffer1.substr(1, buffer1.size() - 2));
+
+    std::string corrupted = image;
+    corrupted[corrupted.size() - 8] ^= 1;
+    EXPECT_FALSE(loaded.load(corrupted.data(), corrupted.size()));
+    EXPECT_TRUE(loaded.load(corrupted.data(), corrupted.size(), false));
+    EXPECT_FALSE(loaded.load(image.data(), image.size() - 4));
+    corrupted = image;
+    corrupted[40] ^= 1;
+    EXPECT_FALSE(loaded.load(corrupted.data(), corrupted.size()));
+
+    //Source text is not hashed, offsets of records are checked on access
+    corrupted = image;
+    corrupted[56 + 10] = 'x';
+    ASSERT_TRUE(loaded.load(corrupted.data(), corrupted.size()));
+    EXPECT_EQ(loaded.root().at("/name").toString(), "x\\\"b");
+    uint32_t rootOffset = 0;
+    memcpy(&rootOffset, image.data() + 48, sizeof(rootOffset));
+    const uint32_t outside = static_cast<uint32_t>(image.size());
+    memcpy(&corrupted[rootOffset + 12], &outside, sizeof(outside));
+    ASSERT_TRUE(loaded.load(corrupted.data(), corrupted.size(), false));
+    EXPECT_EQ(loaded.root().type(), microjson::JsonObjectType);
+    EXPECT_EQ(loaded.root().size(), 0);
+    EXPECT_EQ(loaded.root()[0].type(), microjson::JsonInvalidType);
+    memcpy(&corrupted[rootOffset + 4], &outside, sizeof(outside));
+    EXPECT_EQ(loaded.root().data(), nullptr);
+    EXPECT_EQ(loaded.root().toString(), "");
+    ASSERT_TRUE(loaded.load(image.data(), image.size()));
+
+    char directory[] = "/tmp/microjson_imageXXXXXX";
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    const std::string sourcePath = std::string(directory) + "/config.json";
+    const std::string imagePath = std::string(directory) + "/config.image";
+    FILE *file = fopen(sourcePath.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    fwrite(buffer1.data(), 1, buffer1.size(), file);
+    fclose(file);
+    {
+        microjson::JsonImageFile imageFile(imagePath, sourcePath);
+        ASSERT_TRUE(imageFile.valid());
+        EXPECT_TRUE(imageFile.rebuilt());
+        EXPECT_EQ(imageFile.root().at("/list/0").toString(), "1");
+    }
+    {
+        microjson::JsonImageFile imageFile(imagePath, sourcePath);
+        ASSERT_TRUE(imageFile.valid());
+        EXPECT_FALSE(imageFile.rebuilt());
+        EXPECT_EQ(imageFile.root().find("a").toValue().value, "2");
+    }
+
+    file = fopen(sourcePath.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    fwrite("[3]", 1, 3, file);
+    fclose(file);
+    {
+        microjson::JsonImageFile imageFile(imagePath, sourcePath);
+        ASSERT_TRUE(imageFile.valid());
+        EXPECT_TRUE(imageFile.rebuilt());
+        EXPECT_EQ(imageFile.root()[0].toString(), "3");
+    }
+
+    unlink(sourcePath.c_str());
+    EXPECT_TRUE(microjson::JsonImageFile(imagePath, sourcePath).valid());
+    unlink(imagePath.c_str());
+    EXPECT_FALSE(microjson::JsonImageFile(imagePath, sourcePath).valid());
+    rmdir(directory);
+}
+
+TEST_F(MicrojsonDeserializationTest, ShredColumns) {
+    const std::string lines = "{\"id\":1,\"score\":0.5,\"ok\":true,\"name\":\"a\\nb\",\"skip\":{\"x\":[1]}}\n"
+                              "\n"
+                              "  {\"name\":\"c\",\"id\":2,\"ok\":false,\"score\":3}\r\n"
+                              "{\"id\":\"3\",\"score\":null,\"extra\":1}";
+    std::vector<microjson::JsonColumnField> fields = microjson::inferJsonColumns(lines.data(), lines.size());
+    ASSERT_EQ(fields.size(), 4);
+    EXPECT_EQ(fields[0].name, "score");
+    EXPECT_EQ(fields[0].type, microjson::JsonColumnDouble);
+    EXPECT_EQ(fields[1].name, "ok");
+    EXPECT_EQ(fields[2].name, "name");
+    EXPECT_EQ(fields[2].type, microjson::JsonColumnString);
+    EXPECT_EQ(fields[3].name, "extra");
+
+    fields = {{"id", microjson::JsonColumnInt64}, {"score", microjson::JsonColumnDouble},
+              {"ok", microjson::JsonColumnBool}, {"name", microjson::JsonColumnString}};
+    std::vector<microjson::JsonColumn> columns;
+    ASSERT_TRUE(microjson::shredJsonRows(lines.data(), lines.size(), fields, columns, 1));
+    ASSERT_EQ(columns.size(), 4);
+    for (const auto &column : columns) {
+        EXPECT_EQ(column.size(), 3);
+        EXPECT_EQ(column.validity().size(), 1);
+    }
+    EXPECT_EQ(columns[0].int64At(1), 2);
+    EXPECT_TRUE(columns[0].isNull(2));
+    EXPECT_EQ(columns[0].nullCount(), 1);
+    EXPECT_EQ(columns[1].doubleAt(0), 0.5);
+    EXPECT_EQ(columns[1].doubleAt(1), 3);
+    EXPECT_TRUE(columns[1].isNull(2));
+    EXPECT_TRUE(columns[2].boolAt(0));
+    EXPECT_FALSE(columns[2].boolAt(1));
+    EXPECT_FALSE(columns[2].isNull(1));
+    EXPECT_EQ(columns[3].stringAt(0), "a\nb");
+    EXPECT_EQ(columns[3].stringAt(1), "c");
+    EXPECT_TRUE(columns[3].isNull(2));
+    EXPECT_EQ(columns[3].offsets(), std::vector<int32_t>({0, 3, 4, 4}));
+
+    EXPECT_FALSE(microjson::shredJsonRows("{\"id\":1}\n[1]", 12, fields, columns));
+    EXPECT_TRUE(columns.empty());
+    ASSERT_TRUE(microjson::shredJsonRows(" [ ] ", 5, fields, columns));
+    EXPECT_EQ(columns[0].size(), 0);
+    const std::string duplicated = "{\"id\":1,\"name\":\"a\",\"id\":5}\n{\"id\":2,\"id\":\"x\"}";
+    ASSERT_TRUE(microjson::shredJsonRows(duplicated.data(), duplicated.size(), fields, columns));
+    EXPECT_EQ(columns[0].int64At(0), 5);
+    EXPECT_TRUE(columns[0].isNull(1));
+    EXPECT_EQ(columns[3].stringAt(0), "a");
+
+    //Array input split into chunks on threads
+    std::string array = "[";
+    for (int i = 0; i < 20005; ++i) {
+        array += "{\"name\":\"n" + std::to_string(i) + (i % 7 == 0 ? "\"}," : "\",\"id\":" + std::to_string(i) + ",\"s\":\"],[\"},");
+    }
+    array.back() = ']';
+    ASSERT_TRUE(microjson::shredJsonRows(array.data(), array.size(), fields, columns, 3));
+    ASSERT_EQ(columns[0].size(), 20005);
+    EXPECT_EQ(columns[0].nullCount(), 20005 / 7 + 1);
+    EXPECT_EQ(columns[2].nullCount(), 20005);
+    for (size_t i = 0; i < 20005; ++i) {
+        ASSERT_EQ(columns[0].isNull(i), i % 7 == 0) << i;
+        if (i % 7 != 0) {
+            ASSERT_EQ(columns[0].int64At(i), int64_t(i));
+        }
+        ASSERT_EQ(columns[3].stringAt(i), "n" + std::to_string(i));
+    }
+}
@@ -0,0 +1,455 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Alexey Edelev <semlanik@gmail.com>
+ *
+ * This file is part of microjson project https://git.semlanik.org/semlanik/microjson
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this
+ * software and associated documentation files (the "Software"), to deal in the Software
+ * without restriction, including without limitation the rights to use, copy, modify,
+ * merge, publish, distribute, sublicense, and/or sell copies of the Software, and
+ * to permit persons to whom the Software is furnished to do so, subject to the following
+ * conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies
+ * or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR
+ * PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE
+ * FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "microjson.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Prints NDJSON records that match all field predicates, records are printed unchanged and in
+//input order. Files are mapped into memory and split into chunks at line boundaries, chunks are
+//matched on worker threads while the main thread writes results of finished chunks in order.
+namespace {
+enum Operator {
+    Exists,
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual
+};
+
+enum Operand {
+    NumberOperand,
+    StringOperand,
+    LiteralOperand//true, false and null are compared as raw text
+};
+
+struct Predicate {
+    std::string pointer;
+    Operator op;
+    Operand operand;
+    std::string text;
+    double number;
+};
+
+const size_t ChunkSize = 4 * 1024 * 1024;
+
+void usage() {
+    fprintf(stderr, "Usage: microjson-grep [-c] [-v] [-m count] [-t threads] [-e] EXPR [-e EXPR]... [FILE]...\n"
+                    "EXPR is PATH, PATH==VALUE, PATH!=VALUE, PATH<VALUE, PATH<=VALUE, PATH>VALUE or PATH>=VALUE.\n"
+                    "PATH is a JSON pointer like /a/b/0 or dotted path like a.b.0, all expressions must match.\n"
+                    "VALUE is a number, \"quoted string\", true, false, null or unquoted string.\n"
+                    "  -c  print only count of matching records\n"
+                    "  -v  print records that don't match\n"
+                    "  -m  stop after count matching records\n"
+                    "  -t  number of matching threads, hardware concurrency by default\n");
+}
+
+bool parsePredicate(const std::string &expression, Predicate &predicate) {
+    static const struct {
+        const char *text;
+        Operator op;
+    } operators[] = {{"==", Equal}, {"!=", NotEqual}, {"<=", LessEqual}, {">=", GreaterEqual}, {"<", Less}, {">", Greater}};
+
+    size_t position = std::string::npos;
+    size_t operatorSize = 0;
+    predicate.op = Exists;
+    for (const auto &candidate : operators) {
+        const size_t found = expression.find(candidate.text);
+        if (found != std::string::npos && (found < position || (found == position && strlen(candidate.text) > operatorSize))) {
+            position = found;
+            operatorSize = strlen(candidate.text);
+            predicate.op = candidate.op;
+        }
+    }
+
+    //Single '=' is a typo of '==' rather than a part of the path
+    const std::string path = expression.substr(0, position);
+    if (path.empty() || path.find('=') != std::string::npos) {
+        return false;
+    }
+
+    //Dotted path is converted to JSON pointer
+    predicate.pointer.clear();
+    if (path[0] == '/') {
+        predicate.pointer = path;
+    } else {
+        predicate.pointer = "/";
+        for (const char byte : path) {
+            if (byte == '.') {
+                predicate.pointer += '/';
+            } else if (byte == '~') {
+                predicate.pointer += "~0";
+            } else if (byte == '/') {
+                predicate.pointer += "~1";
+            } else {
+                predicate.pointer += byte;
+            }
+        }
+    }
+
+    if (predicate.op == Exists) {
+        return true;
+    }
+
+    const std::string value = expression.substr(position + operatorSize);
+    if (value.empty()) {
+        return false;
+    }
+
+    predicate.text.clear();
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        predicate.operand = StringOperand;
+        return microjson::unescapeJsonString(value.data() + 1, value.size() - 2, predicate.text);
+    }
+
+    if (microjson::parseJsonNumber(value.data(), value.size(), predicate.number)) {
+        predicate.operand = NumberOperand;
+    } else if (value == "true" || value == "false" || value == "null") {
+        predicate.operand = LiteralOperand;
+        predicate.text = value;
+        return predicate.op == Equal || predicate.op == NotEqual;
+    } else {
+        predicate.operand = StringOperand;
+        predicate.text = value;
+    }
+    return true;
+}
+
+template<typename T>
+bool compare(Operator op, const T &value, const T &expected) {
+    switch (op) {
+    case Equal: return value == expected;
+    case NotEqual: return !(value == expected);
+    case Less: return value < expected;
+    case LessEqual: return !(expected < value);
+    case Greater: return expected < value;
+    case GreaterEqual: return !(value < expected);
+    default: return true;
+    }
+}
+
+//Records without the field or with value of other type don't match
+bool matches(const char *record, size_t size, const Predicate &predicate, std::string &scratch) {
+    microjson::JsonProperty property;
+    if (!microjson::findJsonValue(record, size, predicate.pointer, property)) {
+        return false;
+    }
+    if (predicate.op == Exists) {
+        return true;
+    }
+
+    const char *value = record + property.valueBegin;
+    const size_t valueSize = property.valueSize();
+    switch (predicate.operand) {
+    case NumberOperand: {
+        double number = 0;
+        return property.type == microjson::JsonNumberType && microjson::parseJsonNumber(value, valueSize, number)
+                && compare(predicate.op, number, predicate.number);
+    }
+    case LiteralOperand:
+        return property.type != microjson::JsonStringType
+                && compare(predicate.op, std::string(value, valueSize), predicate.text);
+    case StringOperand:
+        if (property.type != microjson::JsonStringType) {
+            return false;
+        }
+        scratch.clear();
+        if (memchr(value, '\\', valueSize) == nullptr) {
+            scratch.assign(value, valueSize);
+        } else if (!microjson::unescapeJsonString(value, valueSize, scratch)) {
+            return false;
+        }
+        return compare(predicate.op, scratch, predicate.text);
+    }
+    return false;
+}
+
+struct Chunk {
+    const char *begin;
+    const char *end;
+    std::vector<std::pair<size_t, size_t>> lines;//Offsets and sizes of matching lines
+    bool done;
+};
+
+class Grep {
+public:
+    Grep(const std::vector<Predicate> &predicates, bool invert, size_t threads, size_t maxCount, bool countOnly) :
+        m_predicates(predicates)
+      , m_invert(invert)
+      , m_threads(threads)
+      , m_maxCount(maxCount)
+      , m_countOnly(countOnly)
+      , m_count(0) {}
+
+    void run(const char *data, size_t size) {
+        std::vector<Chunk> chunks;
+        for (const char *begin = data, *end = data + size; begin < end;) {
+            const char *chunkEnd = begin + ChunkSize < end ? begin + ChunkSize : end;
+            const char *newLine = static_cast<const char *>(memchr(chunkEnd, '\n', end - chunkEnd));
+            chunkEnd = newLine != nullptr ? newLine + 1 : end;
+            chunks.push_back({begin, chunkEnd, {}, false});
+            begin = chunkEnd;
+        }
+
+        //Workers run at most window chunks ahead of the writer
+        const size_t window = m_threads * 4;
+        std::atomic<size_t> next(0);
+        std::atomic<bool> stopped(false);
+        size_t written = 0;
+        std::mutex mutex;
+        std::condition_variable condition;
+        auto worker = [&]() {
+            std::string scratch;
+            for (;;) {
+                const size_t index = next.fetch_add(1);
+                if (index >= chunks.size()) {
+                    return;
+                }
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [&] { return index < written + window || stopped.load(); });
+                }
+                if (stopped.load()) {
+                    return;
+                }
+
+                Chunk &chunk = chunks[index];
+                match(chunk, scratch);
+                std::lock_guard<std::mutex> lock(mutex);
+                chunk.done = true;
+                condition.notify_all();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < m_threads; ++i) {
+            workers.push_back(std::thread(worker));
+        }
+
+        for (; written < chunks.size() && !stopped.load();) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&] { return chunks[written].done; });
+            }
+            if (!write(chunks[written])) {
+                stopped.store(true);
+            }
+            chunks[written].lines = std::vector<std::pair<size_t, size_t>>();
+            std::lock_guard<std::mutex> lock(mutex);
+            ++written;
+            condition.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopped.store(true);
+            condition.notify_all();
+        }
+        for (auto &thread : workers) {
+            thread.join();
+        }
+    }
+
+    bool finished() const {
+        return m_maxCount != 0 && m_count >= m_maxCount;
+    }
+
+    size_t count() const {
+        return m_count;
+    }
+
+private:
+    void match(Chunk &chunk, std::string &scratch) const {
+        for (const char *line = chunk.begin; line < chunk.end;) {
+            const char *newLine = static_cast<const char *>(memchr(line, '\n', chunk.end - line));
+            const char *lineEnd = newLine != nullptr ? newLine : chunk.end;
+            const size_t size = lineEnd - line;
+            if (size > 0) {
+                bool matched = true;
+                for (const auto &predicate : m_predicates) {
+                    if (!matches(line, size, predicate, scratch)) {
+                        matched = false;
+                        break;
+                    }
+                }
+                if (matched != m_invert) {
+                    chunk.lines.push_back({size_t(line - chunk.begin), size});
+                }
+            }
+            line = lineEnd + 1;
+        }
+    }
+
+    //Returns false once enough records are written
+    bool write(const Chunk &chunk) {
+        for (const auto &line : chunk.lines) {
+            if (finished()) {
+                return false;
+            }
+            ++m_count;
+            if (!m_countOnly) {
+                fwrite(chunk.begin + line.first, 1, line.second, stdout);
+                fputc('\n', stdout);
+            }
+        }
+        return !finished();
+    }
+
+    const std::vector<Predicate> &m_predicates;
+    bool m_invert;
+    size_t m_threads;
+    size_t m_maxCount;
+    bool m_countOnly;
+    size_t m_count;
+};
+
+bool grepFile(Grep &grep, const char *path) {
+    if (strcmp(path, "-") == 0) {
+        std::string input;
+        char buffer[64 * 1024];
+        size_t read = 0;
+        while ((read = fread(buffer, 1, sizeof(buffer), stdin)) > 0) {
+            input.append(buffer, read);
+        }
+        grep.run(input.data(), input.size());
+        return true;
+    }
+
+    const int descriptor = open(path, O_RDONLY);
+    struct stat fileStat;
+    if (descriptor < 0 || fstat(descriptor, &fileStat) != 0) {
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+        fprintf(stderr, "microjson-grep: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(fileStat.st_size);
+    if (size == 0) {
+        close(descriptor);
+        return true;
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    close(descriptor);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "microjson-grep: %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    grep.run(static_cast<const char *>(mapping), size);
+    munmap(mapping, size);
+    return true;
+}
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<Predicate> predicates;
+    std::vector<const char *> files;
+    bool countOnly = false;
+    bool invert = false;
+    size_t maxCount = 0;
+    size_t threads = std::thread::hardware_concurrency();
+    bool options = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        const bool hasValue = i + 1 < argc;
+        Predicate predicate;
+        if (options && argument == "--") {
+            options = false;
+        } else if (options && argument == "-c") {
+            countOnly = true;
+        } else if (options && argument == "-v") {
+            invert = true;
+        } else if (options && argument == "-m" && hasValue) {
+            maxCount = strtoull(argv[++i], nullptr, 10);
+        } else if (options && argument == "-t" && hasValue) {
+            threads = strtoull(argv[++i], nullptr, 10);
+        } else if (options && argument == "-e" && hasValue) {
+            if (!parsePredicate(argv[++i], predicate)) {
+                fprintf(stderr, "microjson-grep: invalid expression %s\n", argv[i]);
+                return 2;
+            }
+            predicates.push_back(predicate);
+        } else if (options && argument.size() > 1 && argument[0] == '-') {
+            usage();
+            return 2;
+        } else if (predicates.empty()) {
+            if (!parsePredicate(argument, predicate)) {
+                fprintf(stderr, "microjson-grep: invalid expression %s\n", argument.c_str());
+                return 2;
+            }
+            predicates.push_back(predicate);
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (predicates.empty()) {
+        usage();
+        return 2;
+    }
+    if (files.empty()) {
+        files.push_back("-");
+    }
+    if (threads == 0) {
+        threads = 1;
+    }
+
+    static char outputBuffer[1024 * 1024];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+    Grep grep(predicates, invert, threads, maxCount, countOnly);
+    bool failed = false;
+    for (const char *file : files) {
+        failed = !grepFile(grep, file) || failed;
+        if (grep.finished()) {
+            break;
+        }
+    }
+
+    if (countOnly) {
+        printf("%zu\n", grep.count());
+    }
+    fflush(stdout);
+    return failed ? 2 : (grep.count() > 0 ? 0 : 1);
+}